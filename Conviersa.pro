@@ -13,8 +13,19 @@ HEADERS += inc/FastDelegate.h \
     inc/cv/qext.h \
     inc/cv/Connection.h \
     inc/cv/ChannelUser.h \
+    inc/cv/NetworkState.h \
+    inc/cv/NotifyList.h \
+    inc/cv/IgnoreList.h \
+    inc/cv/CtcpLimiter.h \
+    inc/cv/WordMatcher.h \
     inc/cv/Session.h \
+    inc/cv/NumericRegistry.h \
+    inc/cv/ChannelListStore.h \
+    inc/cv/EventProfiler.h \
+    inc/cv/Mask.h \
     inc/cv/Parser.h \
+    inc/cv/Plugin.h \
+    inc/cv/PluginManager.h \
     inc/cv/ConfigManager.h \
     inc/cv/gui/definitions.h \
     inc/cv/gui/Client.h \
@@ -31,6 +42,8 @@ HEADERS += inc/FastDelegate.h \
     inc/cv/gui/ChannelWindow.h \
     inc/cv/gui/ChannelTopicDelegate.h \
     inc/cv/gui/ChannelListWindow.h \
+    inc/cv/gui/ChannelListModel.h \
+    inc/cv/gui/ChannelUserModel.h \
     inc/cv/EventManager.h \
     inc/cv/gui/InputOutputWindow.h \
     inc/cv/gui/OutputControl.h \
@@ -43,8 +56,18 @@ SOURCES += \
     src/cv/qext.cpp \
     src/cv/Connection.cpp \
     src/cv/ChannelUser.cpp \
+    src/cv/NetworkState.cpp \
+    src/cv/NotifyList.cpp \
+    src/cv/IgnoreList.cpp \
+    src/cv/CtcpLimiter.cpp \
+    src/cv/WordMatcher.cpp \
     src/cv/Parser.cpp \
+    src/cv/PluginManager.cpp \
     src/cv/Session.cpp \
+    src/cv/NumericRegistry.cpp \
+    src/cv/ChannelListStore.cpp \
+    src/cv/EventProfiler.cpp \
+    src/cv/Mask.cpp \
     src/cv/ConfigManager.cpp \
     src/cv/gui/Client.cpp \
     src/cv/gui/Window.cpp \
@@ -60,6 +83,8 @@ SOURCES += \
     src/cv/gui/ChannelWindow.cpp \
     src/cv/gui/ChannelTopicDelegate.cpp \
     src/cv/gui/ChannelListWindow.cpp \
+    src/cv/gui/ChannelListModel.cpp \
+    src/cv/gui/ChannelUserModel.cpp \
     src/cv/EventManager.cpp \
     src/cv/gui/InputOutputWindow.cpp \
     src/cv/gui/OutputControl.cpp \
@@ -0,0 +1,39 @@
+// Copyright (c) 2011 Conviersa Project. Use of this source code
+// is governed by the MIT License.
+//
+//
+// ChannelListStore holds the channels received in reply to a LIST
+// request. The data is kept in columns (one array each for names,
+// user counts and topics) rather than as one object per channel,
+// since a large network can send hundreds of thousands of rows and
+// appending one is then only three amortized array appends.
+//
+// Each Session owns one, which is filled in between the 321 and
+// 323 numerics; rows are only ever appended until it is cleared.
+
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+namespace cv {
+
+class ChannelListStore
+{
+    QVector<QString>    m_names;
+    QVector<int>        m_numUsers;
+    QVector<QString>    m_topics;
+
+public:
+    void clear();
+    void append(const QString &name, int numUsers, const QString &topic);
+
+    // Returns the number of channels in the store.
+    int size() const { return m_names.size(); }
+
+    const QString &getName(int row) const { return m_names[row]; }
+    int getNumUsers(int row) const { return m_numUsers[row]; }
+    const QString &getTopic(int row) const { return m_topics[row]; }
+};
+
+} // End namespace
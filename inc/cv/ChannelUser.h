@@ -2,12 +2,19 @@
 // is governed by the MIT License.
 //
 //
-// ChannelUser holds information about a user within an IRC channel,
-// and is used by ChannelWindow.
+// ChannelUser is a user's membership in an IRC channel: the interned
+// IrcUser, and the prefixes the user has in that channel. Memberships
+// are owned by the Session's NetworkState, and displayed by ChannelWindow.
+//
+// The prefixes are kept as a bitmask, where bit N is set if the user
+// has the prefix of rank N in the server's PREFIX rules (see
+// Session::getPrefixRank()); the nicknames with prefixes are only
+// built when they're asked for.
 
 #pragma once
 
 #include <QString>
+#include "cv/NetworkState.h"
 
 namespace cv {
 
@@ -16,31 +23,30 @@ class Session;
 class ChannelUser
 {
     Session *   m_pSession;
+    IrcUser *   m_pUser;
+    quint32     m_prefixBits;
 
-    // Message prefix: nick!user@host
-    QString     m_nickname;
-    QString     m_prefixes;
-    QString     m_user;
-    QString     m_host;
-
-    // Priority of the nickname for tab-completion.
+    // Priority of the nickname for tab-completion; nicknames with
+    // a higher priority are completed first.
     int         m_priority;
 
 public:
-    ChannelUser(Session *pSession, const QString &nick);
+    ChannelUser(Session *pSession, IrcUser *pUser, const QString &prefixes = QString());
 
     void addPrefix(const QChar &prefix);
     void removePrefix(const QChar &prefix);
 
-    // These functions only manipulate the nickname, without any prefixes.
-    void setNickname(const QString &nick) { m_nickname = nick; }
-    QString getNickname() { return m_nickname; }
+    IrcUser *getUser() const { return m_pUser; }
+
+    // Returns the nickname, without any prefixes.
+    QString getNickname() const { return m_pUser->getNick(); }
 
-    QString getProperNickname();
-    QString getFullNickname();
-    QChar getPrefix();
+    QString getProperNickname() const;
+    QString getFullNickname() const;
+    QChar getPrefix() const;
+    int getPrefixRank() const;
     void setPriority(int p) { m_priority = p; }
-    int getPriority() { return m_priority; }
+    int getPriority() const { return m_priority; }
 };
 
 } // End namespace
@@ -0,0 +1,69 @@
+// Copyright (c) 2011 Conviersa Project. Use of this source code
+// is governed by the MIT License.
+//
+//
+// CtcpLimiter decides whether a CTCP request should be replied to, so
+// that a flood of requests can't get us disconnected for flooding the
+// server with replies. Each Session owns one.
+//
+// Replies are limited by token buckets: one for each source (by host),
+// and one for all of them together. A reply takes a token from both,
+// and the buckets fill back up over time; when either is empty, the
+// request is dropped rather than queued, and is only counted, so that
+// all the requests which were dropped can be shown as a single line.
+//
+// Requests which don't get a reply (such as PING) don't take reply
+// tokens, but a flood of them would still print a line each; they
+// go through a second, separate set of buckets, and those over the
+// limit are summed up with the rest.
+
+#pragma once
+
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QTime>
+
+namespace cv {
+
+class CtcpLimiter
+{
+    struct TokenBucket
+    {
+        double  tokens;
+        int     lastMsec;
+    };
+
+    QTime                       m_clock;
+
+    // The buckets for replies, and for requests which are only shown;
+    // those of sources are indexed by the case-folded host.
+    TokenBucket                 m_globalBucket;
+    QHash<QString, TokenBucket> m_sourceBuckets;
+    TokenBucket                 m_globalDisplayBucket;
+    QHash<QString, TokenBucket> m_sourceDisplayBuckets;
+
+    // The requests dropped since takeDropped() was last called.
+    int                         m_numDropped;
+    QSet<QString>               m_droppedSources;
+    QSet<QString>               m_droppedTypes;
+
+public:
+    CtcpLimiter();
+
+    bool allowReply(const QString &prefix, const QString &type);
+    bool allowDisplay(const QString &prefix, const QString &type);
+
+    int getNumDropped() const { return m_numDropped; }
+    int takeDropped(int &numSources, QStringList &types);
+
+private:
+    bool takeToken(QHash<QString, TokenBucket> &sourceBuckets, TokenBucket &globalBucket,
+                   const QString &prefix, const QString &type);
+    void addDropped(const QString &source, const QString &type);
+    void refill(TokenBucket &bucket, double capacity, int refillMsec, int now);
+    void pruneSourceBuckets(QHash<QString, TokenBucket> &sourceBuckets, int now);
+};
+
+} // End namespace
@@ -31,6 +31,52 @@
 //     whenever any config option is changed; the string holds the config option
 //     that was modified
 //
+// Instance events can also be hooked for a target within the instance, such
+// as a channel within a Session; when the event is fired for that target,
+// only the callbacks for the target are executed, followed by the callbacks
+// for the instance as a whole. This means a message for one channel is given
+// straight to its window, rather than to every window which then has to check
+// whether the message is meant for it.
+//
+// Callbacks are hooked with a priority, and those with a higher priority
+// are executed first, across the target, instance and global callbacks;
+// callbacks with the same priority are executed with the target's first
+// and then the instance's, and the most recently hooked ones go first.
+// A callback can return a CallbackReturnType instead of void, in which
+// case EVENT_HANDLED stops the rest of the callbacks from being executed
+// (such as an ignore filter dropping a message before any window sees it).
+//
+// Every event is registered once with createEvent(), which returns an
+// integer ID for it; the callbacks for an event are then found with a
+// single array index, so code that fires an event frequently should hold
+// onto its ID. The functions which take the name of the event instead
+// are kept for convenience, but they have to look up the ID every time.
+//
+// Events are typed: each event is created with the class of the object
+// it passes to its callbacks, and callbacks take a const reference to
+// that class. The object is normally allocated on the stack by whoever
+// fires the event. Hooking returns an EventHandle, which is used to
+// unhook the callback again; once the last callback for an instance,
+// target or string is unhooked, its entry in the event is removed too.
+//
+// Plugins can also hook an event with hookPluginEvent(); their callbacks
+// are executed before (PRE_HOOK) or after (POST_HOOK) all of the other
+// callbacks, and a pre-hook can return EVENT_HANDLED to stop the event's
+// default handling. An event that no plugin has hooked only pays for
+// checking that its lists of plugin callbacks are empty.
+//
+// When profiling is turned on, the time spent firing each event and
+// executing each callback is recorded by an EventProfiler; otherwise
+// the only cost is checking whether it's on.
+//
+// The EventManager can be used from any thread. Every callback belongs
+// to the thread that hooked it; when an event is fired on that thread,
+// the callback is executed straight away, and otherwise the event is
+// copied and queued for that thread, which then executes the callback
+// from its event loop. Everything queued for a thread is delivered
+// together, with a single wakeup. Plugin callbacks are always executed
+// on the thread that fires the event, since they can stop it.
+//
 // More information:
 // http://code.google.com/p/conviersa/wiki/Event_System
 
@@ -38,30 +84,33 @@
 
 #include <QHash>
 #include <QList>
+#include <QVector>
+#include <QVarLengthArray>
+#include <QtAlgorithms>
+#include <QMutex>
+#include <QThread>
+#include <QObject>
+#include <QEvent>
 #include <stdint.h>
 #include "FastDelegate.h"
+#include "cv/EventProfiler.h"
 
-#define DCAST(eventType, var) dynamic_cast<eventType *>(var)
-
-// If [var] is NULL, then it prints a message using qDebug() and
-// returns from the current scope.
-#define EM_DEBUG_CHECK(var, func, evtName, evtType, reason) \
-    if(var == NULL) \
-    { \
-        qDebug("[EM::%sEvent] Attempted to %s %s event \"%s\" which %s", func, func, evtType, evtName, reason); \
-        return; \
-    }
+#define DCAST(type, var) dynamic_cast<type *>(var)
 
 using namespace fastdelegate;
 
 namespace cv {
 
-// Event interface
+// Base class of every type of event. Events are not polymorphic; the
+// EventManager keeps track of the type that each event passes.
+//
+// An event that is queued for another thread is copied, so an event
+// which refers to data owned by whoever fires it has to copy that data
+// in its copy constructor.
 class Event
 {
 public:
     Event() { }
-    virtual ~Event() { }
 };
 
 //-----------------------------------//
@@ -74,6 +123,39 @@ enum CallbackReturnType
 
 //-----------------------------------//
 
+// Callbacks with a higher priority are executed first; any
+// value in between these can be used as well.
+enum CallbackPriority
+{
+    PRIORITY_LOW    = -100,
+    PRIORITY_NORMAL = 0,
+    PRIORITY_HIGH   = 100,
+
+    // For callbacks which drop events, like ignore filters.
+    PRIORITY_FILTER = 200
+};
+
+//-----------------------------------//
+
+// Callbacks either return nothing, or a CallbackReturnType; this
+// is left undefined for anything else so that it doesn't compile.
+template<class R>
+struct CallbackResult;
+
+template<>
+struct CallbackResult<void>
+{
+    static const bool returnsResult = false;
+};
+
+template<>
+struct CallbackResult<CallbackReturnType>
+{
+    static const bool returnsResult = true;
+};
+
+//-----------------------------------//
+
 enum EventType
 {
     INSTANCE_EVENT,
@@ -90,160 +172,819 @@ enum HookType
 
 //-----------------------------------//
 
-typedef FastDelegate1<Event *> EventCallback;
-class EventManager;
+// Identifies the type of an event without RTTI; there is exactly
+// one tag for every type that getEventTypeTag() is called with.
+typedef const void * EventTypeTag;
+
+template<class T>
+EventTypeTag getEventTypeTag()
+{
+    static const char s_tag = 0;
+    return &s_tag;
+}
+
+//-----------------------------------//
+
+// Refers to a hooked callback, so that it can be unhooked.
+class EventHandle
+{
+    friend class EventManager;
+
+    int         m_slot;
+    quint32     m_serial;
+
+    EventHandle(int slot, quint32 serial)
+      : m_slot(slot),
+        m_serial(serial)
+    { }
+
+public:
+    EventHandle()
+      : m_slot(-1),
+        m_serial(0)
+    { }
+
+    bool isValid() const { return (m_slot >= 0); }
+};
+
+typedef QList<EventHandle> EventHandleList;
+
+//-----------------------------------//
+
+enum EventKeyType
+{
+    NO_KEY,
+    INSTANCE_KEY,
+    TARGET_KEY,
+    STRING_KEY
+};
+
+//-----------------------------------//
+
+// The event and the key (an instance, a target within an instance,
+// or a string) that a callback was hooked for. Callbacks hooked to a
+// global event or as plugin callbacks have no key.
+struct EventSlotOwner
+{
+    int             evtId;
+    EventKeyType    keyType;
+    uintptr_t       instance;
+
+    // The target or the string.
+    QString         str;
+
+    EventSlotOwner()
+      : evtId(-1),
+        keyType(NO_KEY),
+        instance(0)
+    { }
+
+    EventSlotOwner(int ownerEvtId, EventKeyType ownerKeyType, uintptr_t ownerInstance,
+                   const QString &ownerStr = QString())
+      : evtId(ownerEvtId),
+        keyType(ownerKeyType),
+        instance(ownerInstance),
+        str(ownerStr)
+    { }
+};
+
+//-----------------------------------//
+
+// A callback which is hooked into an event, stored without its type.
+// [serial] is different for every hook, and is 0 while the slot is
+// not being used.
+struct EventSlot
+{
+    DelegateMemento callback;
+    quint32         serial;
+
+    // True if the callback returns a CallbackReturnType.
+    bool            returnsResult;
+
+    // The thread that hooked the callback, which it's executed on.
+    QThread *       pThread;
+
+    // Where the callback was hooked, so that the EventInfo for its key
+    // can be removed once the callback is unhooked and it's empty.
+    EventSlotOwner  owner;
+
+    EventSlot()
+      : serial(0),
+        returnsResult(false),
+        pThread(NULL)
+    { }
+};
+
+//-----------------------------------//
+
+// Refers to an EventSlot from an EventInfo. If the serials no longer
+// match, then the callback has been unhooked since.
+struct EventSlotRef
+{
+    int         slot;
+    quint32     serial;
+    int         priority;
+
+    bool operator<(const EventSlotRef &other) const { return (priority < other.priority); }
+};
+
+//-----------------------------------//
 
 struct EventInfo
 {
-    QList<EventCallback>    callbacks;
-    bool                    firingEvent;
-    QList<EventCallback>    callbacksToAdd;
-    QList<EventCallback>    callbacksToRemove;
+    // Callbacks are kept in order of priority and then the order they
+    // were hooked, and executed in reverse.
+    QVarLengthArray<EventSlotRef, 4>    slotRefs;
+
+    // Unhooked callbacks are only removed from [slotRefs] when the
+    // event isn't firing, and callbacks hooked while it's firing are
+    // appended and only put in order afterwards.
+    int                                 firingDepth;
+    bool                                hasUnhooked;
+    bool                                needsSort;
 
     EventInfo()
-      : firingEvent(false)
+      : firingDepth(0),
+        hasUnhooked(false),
+        needsSort(false)
+    { }
+};
+
+//-----------------------------------//
+
+// Identifies a target (such as a channel or nickname) within an
+// instance; the target is expected to already be case-folded.
+struct EventTarget
+{
+    uintptr_t   instance;
+    QString     target;
+
+    EventTarget(uintptr_t evtInstance, const QString &evtTarget)
+      : instance(evtInstance),
+        target(evtTarget)
+    { }
+
+    bool operator==(const EventTarget &other) const
+    {
+        return (instance == other.instance && target == other.target);
+    }
+};
+
+inline uint qHash(const EventTarget &key)
+{
+    return ::qHash(key.instance) ^ ::qHash(key.target);
+}
+
+//-----------------------------------//
+
+// Holds all the callbacks for a single event.
+struct EventTable
+{
+    QString                         name;
+    EventType                       type;
+    EventTypeTag                    typeTag;
+
+    // Callbacks which are executed whenever the event is
+    // fired, regardless of the instance or string.
+    EventInfo                       global;
+
+    // Plugin callbacks, which are executed before and after
+    // all of the other callbacks.
+    EventInfo                       preHooks;
+    EventInfo                       postHooks;
+
+    // Only one of these is used, depending on [type]; instance
+    // events can also have callbacks for targets.
+    QHash<uintptr_t, EventInfo *>   instances;
+    QHash<EventTarget, EventInfo *> targets;
+    QHash<QString, EventInfo *>     strings;
+
+    EventTable(const QString &evtName, EventType evtType, EventTypeTag evtTypeTag)
+      : name(evtName),
+        type(evtType),
+        typeTag(evtTypeTag)
+    { }
+    ~EventTable()
+    {
+        qDeleteAll(instances);
+        qDeleteAll(targets);
+        qDeleteAll(strings);
+    }
+};
+
+//-----------------------------------//
+
+// A copy of a fired event, waiting to be delivered to the
+// callbacks in [slotRefs], which belong to [pThread].
+class QueuedEvent
+{
+public:
+    int                                 evtId;
+    QThread *                           pThread;
+    QVarLengthArray<EventSlotRef, 4>    slotRefs;
+
+    QueuedEvent(int queuedEvtId, QThread *pQueuedThread)
+      : evtId(queuedEvtId),
+        pThread(pQueuedThread)
+    { }
+    virtual ~QueuedEvent() { }
+
+    virtual void execute(const DelegateMemento &callback, bool returnsResult) const = 0;
+};
+
+template<class T>
+class TypedQueuedEvent : public QueuedEvent
+{
+    T   m_evt;
+
+public:
+    TypedQueuedEvent(int queuedEvtId, QThread *pQueuedThread, const T &evt)
+      : QueuedEvent(queuedEvtId, pQueuedThread),
+        m_evt(evt)
+    { }
+
+    // The result of a callback on another thread is ignored, since
+    // the event has already been handled by the time it's executed.
+    void execute(const DelegateMemento &callback, bool returnsResult) const
+    {
+        if(returnsResult)
+        {
+            FastDelegate1<const T &, CallbackReturnType> typedCallback;
+            typedCallback.SetMemento(callback);
+            typedCallback(m_evt);
+        }
+        else
+        {
+            FastDelegate1<const T &> typedCallback;
+            typedCallback.SetMemento(callback);
+            typedCallback(m_evt);
+        }
+    }
+};
+
+// The events queued while firing a single event; there is
+// usually no more than one other thread to queue it for.
+typedef QVarLengthArray<QueuedEvent *, 2> QueuedEventList;
+
+//-----------------------------------//
+
+class EventManager;
+
+// Lives in a thread which has hooked callbacks, and delivers the
+// events that have been queued for that thread.
+class EventDispatcher : public QObject
+{
+    EventManager *  m_pEvtManager;
+
+public:
+    EventDispatcher(EventManager *pEvtManager)
+      : m_pEvtManager(pEvtManager)
     { }
+
+protected:
+    void customEvent(QEvent *pEvent);
+};
+
+//-----------------------------------//
+
+struct EventThreadQueue
+{
+    QList<QueuedEvent *>    queuedEvts;
+    EventDispatcher *       pDispatcher;
 };
 
 //-----------------------------------//
 
+const int INVALID_EVENT_ID = -1;
+
 class EventManager
 {
-    // Separate hashes are used for each event type.
-    QHash<QString, QHash<uintptr_t, EventInfo> >    m_instanceEvents;
-    QHash<QString, QHash<QString, EventInfo> >      m_stringEvents;
+    friend class EventDispatcher;
+
+    // Guards everything below; it's never held while a callback
+    // is being executed.
+    mutable QMutex                  m_mutex;
+
+    // Event IDs are indices into [m_events].
+    QHash<QString, int>             m_eventIds;
+    QVector<EventTable *>           m_events;
+
+    // Every hooked callback occupies a slot, which an EventHandle
+    // refers to; unused slots are reused.
+    QVector<EventSlot>              m_slots;
+    QVector<int>                    m_freeSlots;
+    quint32                         m_nextSerial;
+
+    // The events that each instance or string has callbacks for,
+    // so that unhookAllEvents() doesn't have to check every event.
+    QHash<uintptr_t, QList<int> >   m_instanceEventIds;
+    QHash<EventTarget, QList<int> > m_targetEventIds;
+    QHash<QString, QList<int> >     m_stringEventIds;
+
+    // [m_pProfiler] points to [m_profiler] while profiling is on,
+    // and is NULL otherwise.
+    EventProfiler                   m_profiler;
+    EventProfiler *                 m_pProfiler;
+
+    // The events waiting to be delivered to each thread.
+    QHash<QThread *, EventThreadQueue *> m_threadQueues;
 
 public:
+    EventManager();
     ~EventManager();
 
-    void createEvent(const QString &evtName, EventType type = INSTANCE_EVENT);
+    // Registers the event [evtName], which passes a T to its callbacks.
+    template<class T>
+    int createEvent(const QString &evtName, EventType type = INSTANCE_EVENT)
+    {
+        return createEvent(evtName, type, getEventTypeTag<T>());
+    }
 
-    void hookGlobalEvent(const QString &evtName, EventType type, EventCallback callback);
-    void hookEvent(const QString &evtName, void *pEvtInstance, EventCallback callback);
-    void hookEvent(const QString &evtName, const QString &evtString, EventCallback callback);
+    int getEventId(const QString &evtName) const;
+    QString getEventName(int evtId) const;
 
-    void fireEvent(const QString &evtName, void *pEvtInstance, Event *pEvent);
-    void fireEvent(const QString &evtName, const QString &evtString, Event *pEvent);
+    // Turns the recording of latencies on or off; the samples recorded
+    // so far are kept until the profiler is cleared.
+    void setProfiling(bool enabled);
+    bool isProfiling() const;
 
-    void unhookGlobalEvent(const QString &evtName, EventType type, EventCallback callback);
-    void unhookEvent(const QString &evtName, void *pEvtInstance, EventCallback callback);
-    void unhookEvent(const QString &evtName, const QString &evtString, EventCallback callback);
+    // Returns a copy of the samples recorded so far.
+    EventProfiler getProfiler() const;
+    void clearProfiler();
 
-    void unhookAllEvents(void *pEvtInstance);
-    void unhookAllEvents(const QString &evtString);
+    // Attaches a [callback] function to the global event [evtId].
+    template<class T, class R>
+    EventHandle hookGlobalEvent(int evtId, FastDelegate1<const T &, R> callback, int priority = PRIORITY_NORMAL)
+    {
+        QMutexLocker locker(&m_mutex);
+        EventTable *pTable = getEventTable("hook", evtId, getEventTypeTag<T>());
+        if(pTable == NULL)
+            return EventHandle();
 
-protected:
+        return addCallback(&pTable->global, callback.GetMemento(), CallbackResult<R>::returnsResult, priority);
+    }
+
+    // Attaches a [callback] function to the event [evtId] for the instance
+    // [pEvtInstance]. A NULL instance attaches it to the global event.
+    template<class T, class R>
+    EventHandle hookEvent(int evtId, void *pEvtInstance, FastDelegate1<const T &, R> callback, int priority = PRIORITY_NORMAL)
+    {
+        QMutexLocker locker(&m_mutex);
+        EventTable *pTable = getEventTable("hook", evtId, INSTANCE_EVENT, getEventTypeTag<T>());
+        if(pTable == NULL)
+            return EventHandle();
+
+        EventInfo *pEvtInfo = &pTable->global;
+        EventSlotOwner owner;
+        if(pEvtInstance != NULL)
+        {
+            pEvtInfo = createEventInfo(evtId, &pTable->instances, &m_instanceEventIds, (uintptr_t) pEvtInstance);
+            owner = EventSlotOwner(evtId, INSTANCE_KEY, (uintptr_t) pEvtInstance);
+        }
+        return addCallback(pEvtInfo, callback.GetMemento(), CallbackResult<R>::returnsResult, priority, owner);
+    }
+
+    // Attaches a [callback] function to the event [evtId] for [target]
+    // within the instance [pEvtInstance], which must be case-folded.
+    template<class T, class R>
+    EventHandle hookEvent(int evtId, void *pEvtInstance, const QString &target,
+                          FastDelegate1<const T &, R> callback, int priority = PRIORITY_NORMAL)
+    {
+        if(target.isEmpty())
+            return hookEvent(evtId, pEvtInstance, callback, priority);
+
+        QMutexLocker locker(&m_mutex);
+        EventTable *pTable = getEventTable("hook", evtId, INSTANCE_EVENT, getEventTypeTag<T>());
+        if(pTable == NULL)
+            return EventHandle();
+
+        EventInfo *pEvtInfo = createEventInfo(evtId, &pTable->targets, &m_targetEventIds,
+                                              EventTarget((uintptr_t) pEvtInstance, target));
+        return addCallback(pEvtInfo, callback.GetMemento(), CallbackResult<R>::returnsResult, priority,
+                           EventSlotOwner(evtId, TARGET_KEY, (uintptr_t) pEvtInstance, target));
+    }
+
+    // Attaches a [callback] function to the event [evtId] for the string
+    // [evtString]. An empty string attaches it to the global event.
+    template<class T, class R>
+    EventHandle hookEvent(int evtId, const QString &evtString, FastDelegate1<const T &, R> callback, int priority = PRIORITY_NORMAL)
+    {
+        QMutexLocker locker(&m_mutex);
+        EventTable *pTable = getEventTable("hook", evtId, STRING_EVENT, getEventTypeTag<T>());
+        if(pTable == NULL)
+            return EventHandle();
+
+        EventInfo *pEvtInfo = &pTable->global;
+        EventSlotOwner owner;
+        if(!evtString.isEmpty())
+        {
+            pEvtInfo = createEventInfo(evtId, &pTable->strings, &m_stringEventIds, evtString);
+            owner = EventSlotOwner(evtId, STRING_KEY, 0, evtString);
+        }
+        return addCallback(pEvtInfo, callback.GetMemento(), CallbackResult<R>::returnsResult, priority, owner);
+    }
+
+    // Attaches a plugin [callback] function to the event [evtId]; see
+    // the description at the top for how [type] and the callback's
+    // return value are used.
     template<class T>
-    void hookEvent(QHash<T, EventInfo> *pEventsHash, const T &evtTypeId, EventCallback callback)
+    EventHandle hookPluginEvent(int evtId, HookType type, FastDelegate1<const T &, CallbackReturnType> callback)
     {
-        EventInfo *pEvtInfo = getEventInfo(pEventsHash, evtTypeId);
-        if(pEvtInfo == NULL)
+        QMutexLocker locker(&m_mutex);
+        EventTable *pTable = getEventTable("hook", evtId, getEventTypeTag<T>());
+        if(pTable == NULL)
+            return EventHandle();
+
+        return addCallback(type == PRE_HOOK ? &pTable->preHooks : &pTable->postHooks,
+                           callback.GetMemento(), true, PRIORITY_NORMAL);
+    }
+
+    template<class T>
+    void fireEvent(int evtId, void *pEvtInstance, const T &evt)
+    {
+        QMutexLocker locker(&m_mutex);
+        EventTable *pTable = getEventTable("fire", evtId, INSTANCE_EVENT, getEventTypeTag<T>());
+        if(pTable == NULL)
+            return;
+
+        fireEvent(evtId, pTable, &pTable->instances, &m_instanceEventIds, (uintptr_t) pEvtInstance, evt);
+    }
+
+    // Fires the event [evtId] for [target] (which must be case-folded)
+    // within the instance [pEvtInstance], and then for the instance.
+    template<class T>
+    void fireEvent(int evtId, void *pEvtInstance, const QString &target, const T &evt)
+    {
+        QMutexLocker locker(&m_mutex);
+        EventTable *pTable = getEventTable("fire", evtId, INSTANCE_EVENT, getEventTypeTag<T>());
+        if(pTable == NULL)
+            return;
+
+        QueuedEventList queuedEvts;
         {
-            EventInfo evtInfo;
-            pEventsHash->insert(evtTypeId, evtInfo);
-            pEvtInfo = getEventInfo(pEventsHash, evtTypeId);
+            ProfileTimer timer(m_pProfiler, evtId);
+            if(execPluginCallbacks(evtId, &pTable->preHooks, evt) == EVENT_CONTINUE)
+            {
+                EventTarget evtTarget((uintptr_t) pEvtInstance, target);
+                EventInfo *pEvtInfos[] = {
+                    target.isEmpty() ? NULL : findEventInfo(&pTable->targets, evtTarget),
+                    findEventInfo(&pTable->instances, (uintptr_t) pEvtInstance),
+                    &pTable->global
+                };
+                executeCallbacks(evtId, pEvtInfos, 3, evt, queuedEvts);
+
+                removeEventInfoIfEmpty(evtId, &pTable->targets, &m_targetEventIds, evtTarget, pEvtInfos[0]);
+                removeEventInfoIfEmpty(evtId, &pTable->instances, &m_instanceEventIds, (uintptr_t) pEvtInstance, pEvtInfos[1]);
+            }
+
+            execPluginCallbacks(evtId, &pTable->postHooks, evt);
         }
 
-        // If we're currently firing the event, then add the callback
-        // to a temporary list which will get added after the entire list
-        // of callbacks has been iterated.
-        if(pEvtInfo->firingEvent)
-            pEvtInfo->callbacksToAdd.append(callback);
-        else
-            // New callbacks get prepended so that the most recently attached
-            // callbacks get executed first.
-            pEvtInfo->callbacks.prepend(callback);
+        postQueuedEvents(queuedEvts);
     }
 
     template<class T>
-    void fireEvent(QHash<T, EventInfo> *pEventsHash, const T &evtTypeId, Event *pEvent)
+    void fireEvent(int evtId, const QString &evtString, const T &evt)
     {
-        EventInfo *pEvtInfo = getEventInfo(pEventsHash, evtTypeId);
-        if(pEvtInfo == NULL)
-            // There are currently no callbacks hooked into this event, so exit normally.
+        QMutexLocker locker(&m_mutex);
+        EventTable *pTable = getEventTable("fire", evtId, STRING_EVENT, getEventTypeTag<T>());
+        if(pTable == NULL)
             return;
 
-        // Fire the event.
-        pEvtInfo->firingEvent = true;
+        fireEvent(evtId, pTable, &pTable->strings, &m_stringEventIds, evtString, evt);
+    }
+
+    // These look up the event by name, and then call the
+    // corresponding functions above.
+    template<class T, class R>
+    EventHandle hookGlobalEvent(const QString &evtName, FastDelegate1<const T &, R> callback, int priority = PRIORITY_NORMAL)
+    {
+        return hookGlobalEvent(lookupEventId("hook", evtName), callback, priority);
+    }
+
+    template<class T, class R>
+    EventHandle hookEvent(const QString &evtName, void *pEvtInstance, FastDelegate1<const T &, R> callback, int priority = PRIORITY_NORMAL)
+    {
+        return hookEvent(lookupEventId("hook", evtName), pEvtInstance, callback, priority);
+    }
 
-        CallbackReturnType returnType = execPluginCallbacks(pEvent, PRE_HOOK);
+    template<class T, class R>
+    EventHandle hookEvent(const QString &evtName, void *pEvtInstance, const QString &target,
+                          FastDelegate1<const T &, R> callback, int priority = PRIORITY_NORMAL)
+    {
+        return hookEvent(lookupEventId("hook", evtName), pEvtInstance, target, callback, priority);
+    }
+
+    template<class T, class R>
+    EventHandle hookEvent(const QString &evtName, const QString &evtString, FastDelegate1<const T &, R> callback, int priority = PRIORITY_NORMAL)
+    {
+        return hookEvent(lookupEventId("hook", evtName), evtString, callback, priority);
+    }
+
+    template<class T>
+    EventHandle hookPluginEvent(const QString &evtName, HookType type, FastDelegate1<const T &, CallbackReturnType> callback)
+    {
+        return hookPluginEvent(lookupEventId("hook", evtName), type, callback);
+    }
+
+    template<class T>
+    void fireEvent(const QString &evtName, void *pEvtInstance, const T &evt)
+    {
+        fireEvent(lookupEventId("fire", evtName), pEvtInstance, evt);
+    }
 
-        if(returnType == EVENT_CONTINUE)
+    template<class T>
+    void fireEvent(const QString &evtName, const QString &evtString, const T &evt)
+    {
+        fireEvent(lookupEventId("fire", evtName), evtString, evt);
+    }
+
+    void unhookEvent(EventHandle &handle);
+    void unhookEvents(EventHandleList &handles);
+
+    void unhookAllEvents(void *pEvtInstance);
+    void unhookAllEvents(const QString &evtString);
+
+protected:
+    int createEvent(const QString &evtName, EventType type, EventTypeTag typeTag);
+    int lookupEventId(const char *func, const QString &evtName) const;
+    EventTable *getEventTable(const char *func, int evtId, EventTypeTag typeTag);
+    EventTable *getEventTable(const char *func, int evtId, EventType type, EventTypeTag typeTag);
+
+    EventHandle addCallback(EventInfo *pEvtInfo, const DelegateMemento &callback, bool returnsResult,
+                            int priority, const EventSlotOwner &owner = EventSlotOwner());
+    void postQueuedEvents(const QueuedEventList &queuedEvts);
+    void dispatchQueuedEvents();
+    void releaseSlot(int slot);
+    void removeOwnerIfEmpty(const EventSlotOwner &owner);
+    void sortCallbacks(EventInfo *pEvtInfo);
+    void removeUnhooked(EventInfo *pEvtInfo);
+    bool hasCallbacks(EventInfo *pEvtInfo);
+
+    // Fires the event [evtId] for [key] (an instance or a string), and
+    // then for the global event. [m_mutex] must be locked.
+    template<class K, class T>
+    void fireEvent(int evtId, EventTable *pTable, QHash<K, EventInfo *> *pEventsHash,
+                   QHash<K, QList<int> > *pEventIdsHash, const K &key, const T &evt)
+    {
+        QueuedEventList queuedEvts;
         {
-            // Callbacks which provide default functionality.
-            QList<EventCallback>::iterator callbackIter = pEvtInfo->callbacks.begin();
-            while(callbackIter != pEvtInfo->callbacks.end())
+            ProfileTimer timer(m_pProfiler, evtId);
+            if(execPluginCallbacks(evtId, &pTable->preHooks, evt) == EVENT_CONTINUE)
             {
-                (*callbackIter)(pEvent);
-                ++callbackIter;
+                // Callbacks which provide default functionality.
+                EventInfo *pEvtInfos[] = { findEventInfo(pEventsHash, key), &pTable->global };
+                executeCallbacks(evtId, pEvtInfos, 2, evt, queuedEvts);
+
+                removeEventInfoIfEmpty(evtId, pEventsHash, pEventIdsHash, key, pEvtInfos[0]);
             }
+
+            execPluginCallbacks(evtId, &pTable->postHooks, evt);
         }
 
-        execPluginCallbacks(pEvent, POST_HOOK);
+        postQueuedEvents(queuedEvts);
+    }
+
+    // Executes the callbacks in [pEvtInfos] (any of which can be NULL)
+    // in order of priority, until one of them returns EVENT_HANDLED.
+    // Callbacks which belong to other threads are added to [queuedEvts]
+    // instead.
+    template<class T>
+    CallbackReturnType executeCallbacks(int evtId, EventInfo **pEvtInfos, int numEvtInfos,
+                                        const T &evt, QueuedEventList &queuedEvts)
+    {
+        // Callbacks hooked while firing are appended, so they
+        // won't be executed until the next time it's fired.
+        QVarLengthArray<int, 3> indices(numEvtInfos);
+        for(int i = 0; i < numEvtInfos; ++i)
+        {
+            indices[i] = -1;
+            if(pEvtInfos[i] == NULL)
+                continue;
+
+            if(pEvtInfos[i]->needsSort && pEvtInfos[i]->firingDepth == 0)
+                sortCallbacks(pEvtInfos[i]);
+            ++pEvtInfos[i]->firingDepth;
+            indices[i] = pEvtInfos[i]->slotRefs.size() - 1;
+        }
 
-        // Prepend all the callbacks that were added with hookEvent() calls
-        // while it was firing.
-        pEvtInfo->firingEvent = false;
-        while(!pEvtInfo->callbacksToAdd.isEmpty())
+        QThread *pCurrentThread = QThread::currentThread();
+        CallbackReturnType ret = EVENT_CONTINUE;
+        while(ret == EVENT_CONTINUE)
         {
-            pEvtInfo->callbacks.prepend(pEvtInfo->callbacksToAdd.takeFirst());
+            // Each list is in order, so the next callback is the one with
+            // the highest priority at the end of a list; ties go to the
+            // earlier list.
+            int next = -1;
+            for(int i = 0; i < numEvtInfos; ++i)
+            {
+                if(indices[i] >= 0 && (next < 0 || pEvtInfos[i]->slotRefs[indices[i]].priority
+                                                    > pEvtInfos[next]->slotRefs[indices[next]].priority))
+                    next = i;
+            }
+            if(next < 0)
+                break;
+
+            EventSlotRef slotRef = pEvtInfos[next]->slotRefs[indices[next]--];
+            const EventSlot &slot = m_slots[slotRef.slot];
+            if(slot.serial != slotRef.serial)
+                pEvtInfos[next]->hasUnhooked = true;
+            else if(slot.pThread != pCurrentThread)
+                queueCallback(evtId, slot.pThread, slotRef, evt, queuedEvts);
+            else
+                ret = executeCallback(evtId, slotRef, evt);
         }
 
-        // Remove all the callbacks that were added with unhookEvent() calls
-        // while it was firing.
-        while(!pEvtInfo->callbacksToRemove.isEmpty())
+        for(int i = 0; i < numEvtInfos; ++i)
         {
-            EventCallback callback = pEvtInfo->callbacksToRemove.takeFirst();
-            int callbackIdx = pEvtInfo->callbacks.indexOf(callback);
-            if(callbackIdx >= 0)
-                pEvtInfo->callbacks.removeAt(callbackIdx);
+            EventInfo *pEvtInfo = pEvtInfos[i];
+            if(pEvtInfo == NULL)
+                continue;
+
+            --pEvtInfo->firingDepth;
+            if(pEvtInfo->firingDepth == 0 && pEvtInfo->hasUnhooked)
+                removeUnhooked(pEvtInfo);
         }
 
-        // If it's empty, then we can go ahead and remove the type id's entry.
-        if(pEvtInfo->callbacks.isEmpty())
-            pEventsHash->remove(evtTypeId);
+        return ret;
     }
 
+    // Executes a single callback, with [m_mutex] unlocked.
     template<class T>
-    void unhookEvent(const QString &evtName, QHash<T, EventInfo> *pEventsHash, const T &evtTypeId, EventCallback callback)
+    CallbackReturnType executeCallback(int evtId, const EventSlotRef &slotRef, const T &evt)
     {
-        EventInfo *pEvtInfo = getEventInfo(pEventsHash, evtTypeId);
-        EM_DEBUG_CHECK(pEvtInfo, "unhook", evtName.toLatin1().constData(), "an", "wasn't being hooked")
+        const EventSlot &slot = m_slots[slotRef.slot];
+        ProfileTimer timer(m_pProfiler, evtId, slotRef.serial, slot.callback);
 
-        // If we're currently firing the event, then add the callback
-        // to a temporary list which will get removed after the event is
-        // done being fired.
-        if(pEvtInfo->firingEvent)
+        CallbackReturnType ret = EVENT_CONTINUE;
+        if(slot.returnsResult)
         {
-            pEvtInfo->callbacksToRemove.append(callback);
+            FastDelegate1<const T &, CallbackReturnType> callback;
+            callback.SetMemento(slot.callback);
+            m_mutex.unlock();
+            ret = callback(evt);
+            m_mutex.lock();
         }
         else
         {
-            int callbackIdx = pEvtInfo->callbacks.indexOf(callback);
-            if(callbackIdx >= 0)
-                pEvtInfo->callbacks.removeAt(callbackIdx);
+            FastDelegate1<const T &> callback;
+            callback.SetMemento(slot.callback);
+            m_mutex.unlock();
+            callback(evt);
+            m_mutex.lock();
         }
 
-        // If it's empty, then we can go ahead and remove the instance's entry.
-        if(pEvtInfo->callbacks.isEmpty())
-            pEventsHash->remove(evtTypeId);
+        return ret;
     }
 
+    // Adds the callback [slotRef] to the copy of the event
+    // in [queuedEvts] for [pThread], making one if needed.
     template<class T>
-    EventInfo *getEventInfo(QHash<T, EventInfo> *pEventsHash, const T &evtTypeId)
+    void queueCallback(int evtId, QThread *pThread, const EventSlotRef &slotRef, const T &evt,
+                       QueuedEventList &queuedEvts)
     {
-        typename QHash<T, EventInfo>::iterator eventsIter = pEventsHash->find(evtTypeId);
-        if(eventsIter == pEventsHash->end())
+        QueuedEvent *pQueuedEvt = NULL;
+        for(int i = 0; i < queuedEvts.size() && pQueuedEvt == NULL; ++i)
+            if(queuedEvts[i]->pThread == pThread)
+                pQueuedEvt = queuedEvts[i];
+
+        if(pQueuedEvt == NULL)
+        {
+            pQueuedEvt = new TypedQueuedEvent<T>(evtId, pThread, evt);
+            queuedEvts.append(pQueuedEvt);
+        }
+
+        pQueuedEvt->slotRefs.append(slotRef);
+    }
+
+    template<class K>
+    EventInfo *findEventInfo(QHash<K, EventInfo *> *pEventsHash, const K &key)
+    {
+        if(pEventsHash->isEmpty())
             return NULL;
 
-        return &(*eventsIter);
+        return pEventsHash->value(key, NULL);
     }
 
-    QHash<uintptr_t, EventInfo> *getInstancesHash(const QString &evtName);
-    QHash<QString, EventInfo> *getStringsHash(const QString &evtName);
+    // Returns the entry for [key], making one if needed.
+    template<class K>
+    EventInfo *createEventInfo(int evtId, QHash<K, EventInfo *> *pEventsHash,
+                               QHash<K, QList<int> > *pEventIdsHash, const K &key)
+    {
+        EventInfo *&pEvtInfo = (*pEventsHash)[key];
+        if(pEvtInfo == NULL)
+            pEvtInfo = new EventInfo;
+
+        // If unhookAllEvents() ran while the event was being fired for
+        // [key], the entry is still here but its ID was already taken
+        // out of [pEventIdsHash], so it has to be added again.
+        QList<int> &evtIds = (*pEventIdsHash)[key];
+        if(!evtIds.contains(evtId))
+            evtIds.append(evtId);
+
+        return pEvtInfo;
+    }
 
-    // TODO (seand): Implement with the plugin API.
-    CallbackReturnType execPluginCallbacks(Event *pEvent, HookType type);
+    // Removes [pEvtInfo], the entry for [key], if it has no callbacks
+    // left and isn't being fired.
+    template<class K>
+    void removeEventInfoIfEmpty(int evtId, QHash<K, EventInfo *> *pEventsHash,
+                                QHash<K, QList<int> > *pEventIdsHash, const K &key, EventInfo *pEvtInfo)
+    {
+        if(pEvtInfo != NULL && pEvtInfo->firingDepth == 0 && pEvtInfo->slotRefs.isEmpty())
+            removeEventInfo(evtId, pEventsHash, pEventIdsHash, key);
+    }
+
+    // Removes the unhooked callbacks from the entry for [key], and then
+    // the entry itself if it's empty. Nothing is done while it's being
+    // fired, since it's cleaned up once that's done.
+    template<class K>
+    void removeEventInfoIfUnhooked(int evtId, QHash<K, EventInfo *> *pEventsHash,
+                                   QHash<K, QList<int> > *pEventIdsHash, const K &key)
+    {
+        EventInfo *pEvtInfo = findEventInfo(pEventsHash, key);
+        if(pEvtInfo == NULL || pEvtInfo->firingDepth > 0)
+            return;
+
+        removeUnhooked(pEvtInfo);
+        removeEventInfoIfEmpty(evtId, pEventsHash, pEventIdsHash, key, pEvtInfo);
+    }
+
+    template<class K>
+    void removeEventInfo(int evtId, QHash<K, EventInfo *> *pEventsHash,
+                         QHash<K, QList<int> > *pEventIdsHash, const K &key)
+    {
+        delete pEventsHash->take(key);
+
+        typename QHash<K, QList<int> >::iterator idsIter = pEventIdsHash->find(key);
+        if(idsIter != pEventIdsHash->end())
+        {
+            idsIter->removeOne(evtId);
+            if(idsIter->isEmpty())
+                pEventIdsHash->erase(idsIter);
+        }
+    }
+
+    // Unhooks every callback for [key] (an instance or a string).
+    template<class K>
+    void unhookAllEvents(QHash<K, QList<int> > *pEventIdsHash, const K &key)
+    {
+        QList<int> evtIds = pEventIdsHash->take(key);
+        for(int i = 0; i < evtIds.size(); ++i)
+        {
+            EventTable *pTable = m_events[evtIds[i]];
+            QHash<K, EventInfo *> *pEventsHash = getEventsHash(pTable, key);
+
+            EventInfo *pEvtInfo = pEventsHash->value(key, NULL);
+            if(pEvtInfo == NULL)
+                continue;
+
+            for(int j = 0; j < pEvtInfo->slotRefs.size(); ++j)
+            {
+                EventSlotRef slotRef = pEvtInfo->slotRefs[j];
+                if(m_slots[slotRef.slot].serial == slotRef.serial)
+                    releaseSlot(slotRef.slot);
+            }
+
+            // If the event is being fired for this key right now,
+            // it gets removed once it's done.
+            if(pEvtInfo->firingDepth > 0)
+                pEvtInfo->hasUnhooked = true;
+            else
+                delete pEventsHash->take(key);
+        }
+    }
+
+    QHash<uintptr_t, EventInfo *> *getEventsHash(EventTable *pTable, uintptr_t) { return &pTable->instances; }
+    QHash<EventTarget, EventInfo *> *getEventsHash(EventTable *pTable, const EventTarget &) { return &pTable->targets; }
+    QHash<QString, EventInfo *> *getEventsHash(EventTable *pTable, const QString &) { return &pTable->strings; }
+
+    // Executes the plugin callbacks in [pHooks] until one of them
+    // returns EVENT_HANDLED.
+    template<class T>
+    CallbackReturnType execPluginCallbacks(int evtId, EventInfo *pHooks, const T &evt)
+    {
+        if(pHooks->slotRefs.isEmpty())
+            return EVENT_CONTINUE;
+
+        ++pHooks->firingDepth;
+
+        CallbackReturnType ret = EVENT_CONTINUE;
+        for(int i = pHooks->slotRefs.size() - 1; i >= 0 && ret == EVENT_CONTINUE; --i)
+        {
+            EventSlotRef slotRef = pHooks->slotRefs[i];
+            if(m_slots[slotRef.slot].serial != slotRef.serial)
+                pHooks->hasUnhooked = true;
+            else
+                ret = executeCallback(evtId, slotRef, evt);
+        }
+
+        --pHooks->firingDepth;
+        if(pHooks->firingDepth == 0 && pHooks->hasUnhooked)
+            removeUnhooked(pHooks);
+
+        return ret;
+    }
 };
 
 extern EventManager *g_pEvtManager;
@@ -0,0 +1,135 @@
+// Copyright (c) 2011 Conviersa Project. Use of this source code
+// is governed by the MIT License.
+//
+//
+// EventProfiler records how long events take to fire, and how long
+// each hooked callback takes to execute, while the EventManager has
+// profiling turned on. For every event and every callback it keeps
+// the number of samples, the total and maximum latency, and a
+// histogram with power-of-two buckets (in microseconds).
+//
+// A callback's latency includes any events it fires itself. Callbacks
+// are identified by the serial of the hook, along with the object
+// they're bound to.
+//
+// ProfileTimer measures a single sample; when profiling is off it
+// costs a single check of a NULL pointer.
+
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QElapsedTimer>
+#include "FastDelegate.h"
+
+using namespace fastdelegate;
+
+namespace cv {
+
+class EventManager;
+
+// Bucket 0 holds latencies under 1us, bucket i holds [2^(i-1), 2^i)us,
+// and the last bucket holds everything above that.
+const int NUM_LATENCY_BUCKETS = 16;
+
+struct LatencyStats
+{
+    quint64     count;
+    qint64      totalNsecs;
+    qint64      maxNsecs;
+    quint32     buckets[NUM_LATENCY_BUCKETS];
+
+    LatencyStats();
+    void addSample(qint64 nsecs);
+    QVariantMap toVariant() const;
+};
+
+//-----------------------------------//
+
+struct CallbackStats
+{
+    const void *    pObject;
+    LatencyStats    latency;
+};
+
+//-----------------------------------//
+
+class EventProfiler
+{
+    // Samples for firing each event, by event ID.
+    QHash<int, LatencyStats>                    m_eventStats;
+
+    // Samples for each callback, by event ID and then hook serial.
+    QHash<int, QHash<quint32, CallbackStats> >  m_callbackStats;
+
+public:
+    void addEventSample(int evtId, qint64 nsecs);
+    void addCallbackSample(int evtId, quint32 serial, const void *pObject, qint64 nsecs);
+    void clear();
+
+    bool isEmpty() const { return m_eventStats.isEmpty(); }
+
+    QStringList getSummary(const EventManager &evtManager, int maxCallbacks = 3) const;
+    QVariant toVariant(const EventManager &evtManager) const;
+};
+
+//-----------------------------------//
+
+// Returns the object that [callback] is bound to, or NULL
+// if it's a static function.
+const void *getCallbackObject(const DelegateMemento &callback);
+
+//-----------------------------------//
+
+// Measures the time from its construction to its destruction, and
+// adds it to [pProfiler] (if it isn't NULL), either for firing the
+// whole event or for executing a single callback.
+class ProfileTimer
+{
+    EventProfiler * m_pProfiler;
+    int             m_evtId;
+    quint32         m_serial;
+    const void *    m_pObject;
+    QElapsedTimer   m_timer;
+
+public:
+    ProfileTimer(EventProfiler *pProfiler, int evtId)
+      : m_pProfiler(pProfiler)
+    {
+        if(m_pProfiler != NULL)
+        {
+            m_evtId = evtId;
+            m_serial = 0;
+            m_pObject = NULL;
+            m_timer.start();
+        }
+    }
+
+    // The callback's object is looked up here, since the callback
+    // may unhook itself (and its slot may be reused) before it returns.
+    ProfileTimer(EventProfiler *pProfiler, int evtId, quint32 serial, const DelegateMemento &callback)
+      : m_pProfiler(pProfiler)
+    {
+        if(m_pProfiler != NULL)
+        {
+            m_evtId = evtId;
+            m_serial = serial;
+            m_pObject = getCallbackObject(callback);
+            m_timer.start();
+        }
+    }
+    ~ProfileTimer()
+    {
+        if(m_pProfiler != NULL)
+        {
+            if(m_serial == 0)
+                m_pProfiler->addEventSample(m_evtId, m_timer.nsecsElapsed());
+            else
+                m_pProfiler->addCallbackSample(m_evtId, m_serial, m_pObject, m_timer.nsecsElapsed());
+        }
+    }
+};
+
+} // End namespace
@@ -0,0 +1,107 @@
+// Copyright (c) 2011 Conviersa Project. Use of this source code
+// is governed by the MIT License.
+//
+//
+// IgnoreList holds the hostmasks the user has chosen to ignore, each
+// with the kinds of messages to ignore from it. Each Session owns one,
+// and checks the prefix of each PRIVMSG and NOTICE against it before
+// the line is parsed or fired as any event. Joins, parts and quits
+// can't be dropped that early without the userlists losing track of
+// who is in each channel, so windows only skip displaying them.
+//
+// All of the masks are compiled into one automaton, so checking a
+// prefix takes one step per character no matter how many masks there
+// are. Each mask becomes a chain of states in an NFA ("*" loops on
+// itself), and the DFA states (sets of NFA states) are only built the
+// first time a prefix reaches them, then cached; the characters which
+// don't appear in any mask all lead to the same place, so they share
+// one transition. The cache is thrown away if it grows too large.
+
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+namespace cv {
+
+enum IgnoreType
+{
+    IgnoreMessages  = 0x01,
+    IgnoreNotices   = 0x02,
+    IgnoreCtcp      = 0x04,
+    IgnoreJoins     = 0x08,     // also parts and quits
+    IgnoreAll       = 0x0F
+};
+
+struct IgnoreRule
+{
+    QString     mask;
+    int         types;
+};
+
+//-----------------------------------//
+
+class IgnoreList
+{
+    enum NfaStateKind
+    {
+        NfaStateChar,
+        NfaStateAnyOne,
+        NfaStateAnyMany,
+        NfaStateAccept
+    };
+
+    struct NfaState
+    {
+        NfaStateKind    kind;
+        QChar           c;          // for NfaStateChar
+        int             types;      // for NfaStateAccept
+    };
+
+    struct DfaState
+    {
+        QVector<int>        nfaStates;
+        int                 types;
+
+        // The DFA state reached with each character which is in
+        // a mask, and with all the others; -1 until it's known.
+        QHash<ushort, int>  transitions;
+        int                 otherTransition;
+    };
+
+    QList<IgnoreRule>       m_rules;
+
+    QVector<NfaState>       m_nfa;
+    QVector<int>            m_startStates;
+    QSet<ushort>            m_maskChars;
+
+    QVector<DfaState>       m_dfa;
+    QHash<QByteArray, int>  m_dfaIndex;
+    int                     m_startDfaIdx;
+
+public:
+    IgnoreList();
+
+    void setRules(const QList<IgnoreRule> &rules);
+    const QList<IgnoreRule> &getRules() const { return m_rules; }
+    bool isEmpty() const { return m_rules.isEmpty(); }
+
+    int match(const QString &prefix);
+    bool isIgnored(const QString &prefix, IgnoreType type) { return !isEmpty() && (match(prefix) & type); }
+
+    static int parseTypes(const QString &types);
+    static QString typesToString(int types);
+
+private:
+    void compile();
+    void resetDfa();
+    int findDfaState(QVector<int> nfaStates);
+    int step(int dfaIdx, QChar c);
+    void addClosure(QVector<int> &nfaStates, int nfaIdx) const;
+};
+
+} // End namespace
@@ -0,0 +1,94 @@
+// Copyright (c) 2011 Conviersa Project. Use of this source code
+// is governed by the MIT License.
+//
+//
+// Mask is a compiled wildcard mask, as used for bans, exceptions and
+// invite exceptions. It follows the mask grammar in ragel/irc.rl: "*"
+// matches any number of characters, "?" matches any one character,
+// and either may be escaped with "\" to match itself.
+//
+// A mask is compiled once, case-folded (after its escapes have been
+// read, since "\" itself folds to "|") and split at each "*" into
+// pieces; the first and last pieces are anchored to the ends of the
+// string being matched, and the ones in between are found left to
+// right. So matching costs about one pass over the string, and a
+// string which is too short, or which has the wrong start or end,
+// is turned down straight away.
+//
+// Masks for users are matched against "nick!user@host", and are
+// completed the way servers complete them ("nick" is "nick!*@*").
+// The "$a:account" and "~a:account" extended bans are matched against
+// the user's account instead; other extended bans never match, since
+// there's no way to tell who they affect.
+
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+namespace cv {
+
+enum MaskTokenKind
+{
+    MaskTokenChar,
+    MaskTokenAnyOne,
+    MaskTokenAnyMany
+};
+
+// One character of a mask, as read by Mask::tokenize().
+struct MaskToken
+{
+    MaskTokenKind   kind;
+    QChar           c;          // for MaskTokenChar, case-folded
+};
+
+//-----------------------------------//
+
+class Mask
+{
+    enum MaskType
+    {
+        MaskTypeHost,
+        MaskTypeAccount,
+        MaskTypeUnsupported
+    };
+
+    // A run of the mask between two "*"s. Unescaped "?"s are
+    // stored as '\0', which can't be in a nickname or host.
+    struct MaskPiece
+    {
+        QString     text;
+        bool        hasWildOne;
+    };
+
+    QString             m_mask;
+    MaskType            m_type;
+    QVector<MaskPiece>  m_pieces;
+
+    // The length of all the pieces put together; no shorter
+    // string can match.
+    int                 m_minLength;
+
+public:
+    Mask();
+    Mask(const QString &mask);
+
+    static QString complete(const QString &mask);
+    static QVector<MaskToken> tokenize(const QString &mask);
+
+    const QString &getMask() const { return m_mask; }
+    bool isEmpty() const { return m_mask.isEmpty(); }
+
+    // [hostmask] is "nick!user@host" and [account] is the user's
+    // account (empty if they aren't logged in); both must already
+    // be case-folded.
+    bool matches(const QString &hostmask, const QString &account) const;
+    bool matches(const QString &str) const;
+
+private:
+    void compile(const QVector<MaskToken> &tokens);
+    static bool matchesAt(const QString &str, int pos, const MaskPiece &piece);
+    static int indexOf(const QString &str, int from, int to, const MaskPiece &piece);
+};
+
+} // End namespace
@@ -0,0 +1,169 @@
+// Copyright (c) 2011 Conviersa Project. Use of this source code
+// is governed by the MIT License.
+//
+//
+// NetworkState is the Session's model of the IRC network: the channels
+// we're in, and the users we share them with. Every user is interned,
+// so there is one IrcUser for a user no matter how many channels they
+// are in, and each channel holds a ChannelUser (the membership, with
+// its prefixes) for each of its users. Each user also keeps the list
+// of channels it's in, so a QUIT or NICK only has to visit those.
+// Windows only display what's in the model; the Session is the only
+// one which changes it.
+//
+// Users and channels are looked up by their case-folded names.
+//
+// The user, host, account and away status of each user are filled in
+// by the Session as the server reports them (WHO replies, and the
+// away-notify, account-notify and chghost capabilities), so anything
+// which needs them should read them from here rather than asking
+// the server.
+//
+// Each channel also caches its ban, exception and invite exception
+// lists, once the server has sent them (367/368, 348/349 and 346/347),
+// and the Session keeps them up to date with MODE changes after that.
+// The masks in them are compiled, so finding the members a mask
+// affects only takes one pass over the channel.
+
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include "cv/Mask.h"
+
+namespace cv {
+
+class Session;
+class ChannelUser;
+class IrcChannel;
+
+class IrcUser
+{
+    friend class NetworkState;
+
+    QString     m_nick;
+    QString     m_user;
+    QString     m_host;
+    QString     m_account;
+    bool        m_isAway;
+
+    // The channels the user is in; the user is removed
+    // from the model when this becomes empty.
+    QList<IrcChannel *> m_channels;
+
+public:
+    IrcUser(const QString &nick)
+      : m_nick(nick),
+        m_isAway(false)
+    { }
+
+    const QString &getNick() const { return m_nick; }
+    const QString &getUser() const { return m_user; }
+    const QString &getHost() const { return m_host; }
+    const QString &getAccount() const { return m_account; }
+    bool isAway() const { return m_isAway; }
+    const QList<IrcChannel *> &getChannels() const { return m_channels; }
+    int getChannelCount() const { return m_channels.size(); }
+};
+
+//-----------------------------------//
+
+enum ChannelListType
+{
+    ChannelListBan,
+    ChannelListExcept,
+    ChannelListInvite,
+    NUM_CHANNEL_LISTS
+};
+
+// An entry in one of a channel's lists.
+struct ChannelListEntry
+{
+    Mask        mask;
+    QString     setBy;
+    uint        setAt;
+};
+
+//-----------------------------------//
+
+class IrcChannel
+{
+    friend class NetworkState;
+
+    QString                         m_name;
+    QHash<IrcUser *, ChannelUser *> m_members;
+
+    // The lists we've received from the server, and the ones
+    // being received.
+    QList<ChannelListEntry>         m_lists[NUM_CHANNEL_LISTS];
+    QList<ChannelListEntry>         m_pendingLists[NUM_CHANNEL_LISTS];
+    bool                            m_hasList[NUM_CHANNEL_LISTS];
+
+public:
+    IrcChannel(const QString &name)
+      : m_name(name)
+    {
+        for(int i = 0; i < NUM_CHANNEL_LISTS; ++i)
+            m_hasList[i] = false;
+    }
+
+    const QString &getName() const { return m_name; }
+    int getMemberCount() const { return m_members.size(); }
+    ChannelUser *getMember(IrcUser *pUser) const { return m_members.value(pUser, NULL); }
+    QList<ChannelUser *> getMembers() const { return m_members.values(); }
+
+    // Returns true if the server has sent the list of type [type].
+    bool hasList(ChannelListType type) const { return m_hasList[type]; }
+    const QList<ChannelListEntry> &getList(ChannelListType type) const { return m_lists[type]; }
+};
+
+//-----------------------------------//
+
+class NetworkState
+{
+    Session *                       m_pSession;
+
+    // Indexed by the case-folded nickname or channel name.
+    QHash<QString, IrcUser *>       m_users;
+    QHash<QString, IrcChannel *>    m_channels;
+
+public:
+    NetworkState(Session *pSession);
+    ~NetworkState();
+
+    IrcUser *findUser(const QString &nick) const;
+    IrcChannel *findChannel(const QString &name) const;
+    ChannelUser *findMember(const QString &channel, const QString &nick) const;
+
+    // Returns the nickname in [name], without any prefixes or user/host.
+    QString parseNick(const QString &name) const;
+
+    IrcChannel *addChannel(const QString &name);
+    void removeChannel(const QString &name);
+    ChannelUser *addMember(const QString &channel, const QString &name);
+    void removeMember(const QString &channel, const QString &nick);
+    void removeUser(const QString &nick);
+    void renameUser(const QString &oldNick, const QString &newNick);
+    void setUserHost(const QString &nick, const QString &user, const QString &host);
+    void setUserAway(const QString &nick, bool isAway);
+    void setUserAccount(const QString &nick, const QString &account);
+    void clear();
+
+    void addListEntry(const QString &channel, ChannelListType type, const QString &mask,
+                      const QString &setBy = QString(), uint setAt = 0);
+    void endList(const QString &channel, ChannelListType type);
+    void addMask(const QString &channel, ChannelListType type, const QString &mask, const QString &setBy);
+    void removeMask(const QString &channel, ChannelListType type, const QString &mask);
+    QList<ChannelUser *> findMatchingMembers(const QString &channel, const Mask &mask) const;
+    QList<int> countMatchingMembers(const QString &channel, ChannelListType type) const;
+
+    int getUserCount() const { return m_users.size(); }
+    int getChannelCount() const { return m_channels.size(); }
+    QList<IrcChannel *> getChannels() const { return m_channels.values(); }
+
+private:
+    void removeMember(IrcChannel *pChannel, IrcUser *pUser);
+};
+
+} // End namespace
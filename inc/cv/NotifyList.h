@@ -0,0 +1,134 @@
+// Copyright (c) 2011 Conviersa Project. Use of this source code
+// is governed by the MIT License.
+//
+//
+// NotifyList keeps track of whether the nicknames on the user's notify
+// list are online. Each Session owns one, which is started once the
+// Session has registered with the server.
+//
+// If the server supports MONITOR (from the 005 numeric), the nicknames
+// are added to the server's monitor list, and the server tells us when
+// they come online or go offline. Otherwise, or for the nicknames which
+// don't fit in the server's monitor list, they are polled with ISON: a
+// single ISON message, packed with as many nicknames as fit in a line,
+// is sent every poll interval, going around the list in turn. So the
+// cost of polling stays the same no matter how long the list is; only
+// the time it takes to notice a change grows.
+//
+// The Session tells the NotifyList about every ISON it sends, so that
+// the replies to the user's own ISONs (which come back in the same
+// order) aren't taken for replies to the polls. A poll which hasn't
+// been replied to within two poll intervals is given up on.
+//
+// Events:
+//
+// NotifyEvent is used for the "notifyOnline" and "notifyOffline" events,
+// which are only fired when a nickname changes between the two. Nobody
+// is announced as offline when the list is first checked.
+
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QQueue>
+#include <QStringList>
+#include <QTime>
+#include <QTimer>
+#include "cv/EventManager.h"
+
+namespace cv {
+
+class Session;
+struct Message;
+
+class NotifyEvent : public Event
+{
+    QString     m_nick;
+
+public:
+    NotifyEvent(const QString &nick)
+      : m_nick(nick)
+    { }
+
+    const QString &getNick() const { return m_nick; }
+};
+
+//-----------------------------------//
+
+class NotifyList : public QObject
+{
+    Q_OBJECT
+
+    enum NotifyState
+    {
+        NotifyStateUnknown,
+        NotifyStateOnline,
+        NotifyStateOffline
+    };
+
+    struct NotifyEntry
+    {
+        QString         nick;
+        NotifyState     state;
+        bool            isMonitored;
+    };
+
+    Session *                       m_pSession;
+
+    // Indexed by case-folded nickname.
+    QHash<QString, NotifyEntry>     m_entries;
+
+    // Case-folded nicknames which are polled with ISON, in the order
+    // they're polled; [m_pollIdx] is the next one to be polled.
+    QStringList                     m_pollList;
+    int                             m_pollIdx;
+
+    // Each ISON message which hasn't been replied to yet, in the order
+    // they were sent; [isPoll] is false for the user's own, and
+    // [nicks] holds the case-folded nicknames in each poll.
+    struct PendingIson
+    {
+        QStringList     nicks;
+        bool            isPoll;
+        QTime           time;
+    };
+    QQueue<PendingIson>             m_pendingIsons;
+    bool                            m_isSendingPoll;
+    QTimer                          m_pollTimer;
+
+    // The most nicknames the server lets us monitor, or 0 if
+    // the server doesn't support MONITOR.
+    int                             m_monitorLimit;
+    bool                            m_isStarted;
+
+    int                             m_onlineEvt;
+    int                             m_offlineEvt;
+
+public:
+    NotifyList(Session *pSession);
+
+    void setNicks(const QStringList &nicks);
+    QStringList getNicks() const;
+    void setPollInterval(int msec) { m_pollTimer.setInterval(msec); }
+    void setMonitorLimit(int limit) { m_monitorLimit = limit; }
+    bool isOnline(const QString &nick) const;
+
+    void start();
+    void stop();
+
+    void addSentIson();
+    bool handleIsonReply(const Message &msg);
+    void handleMonitorOnline(const Message &msg);
+    void handleMonitorOffline(const Message &msg);
+    void handleMonitorListFull(const Message &msg);
+
+private:
+    void setState(const QString &nick, NotifyState state);
+    void expirePendingIsons();
+    void sendPacked(const QString &command, const QStringList &nicks, const QChar &separator);
+
+private slots:
+    void poll();
+};
+
+} // End namespace
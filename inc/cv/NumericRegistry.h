@@ -0,0 +1,45 @@
+// Copyright (c) 2011 Conviersa Project. Use of this source code
+// is governed by the MIT License.
+//
+//
+// NumericRegistry maps numeric replies (001-999) to the callbacks
+// that handle them. Each Session owns one, and handlers subscribe
+// only to the numerics they care about; dispatching a numeric is
+// a single index into a fixed table of MAX_NUMERIC slots, so a
+// numeric that nobody handles costs nothing beyond that lookup.
+//
+// Callbacks within a slot are executed in the order they were hooked.
+
+#pragma once
+
+#include <QList>
+#include "FastDelegate.h"
+#include "cv/Parser.h"
+
+using namespace fastdelegate;
+
+namespace cv {
+
+// Numerics are three digits, so 000-999.
+const int MAX_NUMERIC = 1000;
+
+typedef FastDelegate1<const Message &> NumericCallback;
+
+class NumericRegistry
+{
+    QList<NumericCallback>  m_callbacks[MAX_NUMERIC];
+
+public:
+    void hookNumeric(int numeric, NumericCallback callback);
+    void unhookNumeric(int numeric, NumericCallback callback);
+
+    // Returns true if at least one callback is hooked into [numeric].
+    bool isHooked(int numeric) const { return isValid(numeric) && !m_callbacks[numeric].isEmpty(); }
+
+    bool dispatch(const Message &msg);
+
+private:
+    static bool isValid(int numeric) { return (numeric >= 0 && numeric < MAX_NUMERIC); }
+};
+
+} // End namespace
@@ -68,6 +68,10 @@ enum
     IRC_COMMAND_UNKNOWN,
 
     // Alphabetical order
+    IRC_COMMAND_ACCOUNT,
+    IRC_COMMAND_AWAY,
+    IRC_COMMAND_CAP,
+    IRC_COMMAND_CHGHOST,
     IRC_COMMAND_ERROR,
     IRC_COMMAND_INVITE,
     IRC_COMMAND_JOIN,
@@ -81,7 +85,10 @@ enum
     IRC_COMMAND_PRIVMSG,
     IRC_COMMAND_QUIT,
     IRC_COMMAND_TOPIC,
-    IRC_COMMAND_WALLOPS
+    IRC_COMMAND_WALLOPS,
+
+    // Number of commands; this must stay last.
+    NUM_IRC_COMMANDS
 };
 
 //-----------------------------------//
@@ -98,6 +105,7 @@ struct Message
 //-----------------------------------//
 
 Message parseData(const QString &data);
+bool parseListReply(const QString &data, QString &channel, int &numUsers, QString &topic);
 
 // Message-specific parsing
 QString getNetworkNameFrom001(const Message &msg);
@@ -107,6 +115,7 @@ QString stripCodes(const QString &text);
 QString getHtmlColor(int number);
 
 ChanModeType getChanModeType(const QString &chanModes, const QChar &letter);
+QList<ChannelMode> parseChannelModes(const QString &chanModes, const Message &msg, int modeNum = 0);
 QString getPrefixRules(const QString &param);
 CtcpRequestType getCtcpRequestType(const Message &msg);
 QString getNumericText(const Message &msg);
@@ -114,5 +123,7 @@ QString parseMsgPrefix(const QString &prefix, MsgPrefixPart part);
 QString getDate(QString strUnixTime);
 QString getTime(QString strUnixTime);
 bool isChannel(const QString &str);
+QString foldCase(const QString &name);
+QChar foldCaseChar(QChar c);
 
 } // End namespace
@@ -0,0 +1,45 @@
+// Copyright (c) 2011 Conviersa Project. Use of this source code
+// is governed by the MIT License.
+//
+//
+// Plugin is the interface implemented by native plugins, which are
+// shared libraries loaded by the PluginManager on startup. A plugin
+// is a QObject that implements this interface, and is exported with
+// Q_EXPORT_PLUGIN2:
+//
+//   class MyPlugin : public QObject, public cv::Plugin
+//   {
+//       Q_OBJECT
+//       Q_INTERFACES(cv::Plugin)
+//       ...
+//   };
+//
+// When it's loaded, a plugin hooks whichever events it's interested in
+// using EventManager::hookPluginEvent() (or any of the regular hook
+// functions), and it must unhook all of them again when it's unloaded.
+
+#pragma once
+
+#include <QString>
+#include <QtPlugin>
+
+namespace cv {
+
+class EventManager;
+
+class Plugin
+{
+public:
+    virtual ~Plugin() { }
+
+    virtual QString getName() const = 0;
+
+    // Returns false if the plugin failed to load, in which
+    // case unload() won't be called.
+    virtual bool load(EventManager *pEvtManager) = 0;
+    virtual void unload(EventManager *pEvtManager) = 0;
+};
+
+} // End namespace
+
+Q_DECLARE_INTERFACE(cv::Plugin, "org.conviersa.Plugin/1.0")
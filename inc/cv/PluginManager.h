@@ -0,0 +1,36 @@
+// Copyright (c) 2011 Conviersa Project. Use of this source code
+// is governed by the MIT License.
+//
+//
+// PluginManager loads the native plugins from a directory and keeps
+// them loaded until it is destroyed, at which point every plugin is
+// unloaded. See Plugin.h for how plugins are written.
+
+#pragma once
+
+#include <QList>
+#include <QString>
+
+class QPluginLoader;
+
+namespace cv {
+
+class Plugin;
+
+class PluginManager
+{
+    QList<QPluginLoader *>  m_loaders;
+    QList<Plugin *>         m_plugins;
+
+public:
+    ~PluginManager();
+
+    void loadPlugins(const QString &dirPath);
+    bool loadPlugin(const QString &filename);
+    void unloadPlugins();
+
+    // Returns the number of plugins currently loaded.
+    int getPluginCount() const { return m_plugins.size(); }
+};
+
+} // End namespace
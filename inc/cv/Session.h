@@ -15,71 +15,209 @@
 // DataEvent is used for the "receivedData" event, which is fired whenever the
 // Session receives any data from the server.
 //
+// ChannelListEvent is used for the "channelListBatch" event, which is fired
+// whenever a batch of channels has been added to the Session's channel list
+// during a LIST request. The 322 replies which make up the list bypass the
+// "receivedData" event and the numeric dispatch entirely; they are appended
+// to the ChannelListStore as they arrive, and handed on in batches.
+//
 // MessageEvent is used for all the events that end in "Message", which are fired
 // for successfully parsing received data into a Message object.
+//
+// NetsplitEvent is used for the "netsplit" and "netjoin" events. Servers which
+// don't support BATCH send a netsplit as one QUIT per user, with the names of
+// the two servers as the reason; the Session collects these until a short while
+// after the last one, and fires a single "netsplit" event instead of a
+// "quitMessage" for each. Likewise, the JOINs of those users when the servers
+// link again are collected into a single "netjoin" event.
+//
+// Numerics are not fired as events; instead they are dispatched through the
+// Session's NumericRegistry to the callbacks hooked into each specific numeric
+// (see hookNumeric()). The "numericMessage" event is only fired for numerics
+// which have no callbacks hooked into them.
+//
+// The Session keeps its NetworkState up to date with the channels and
+// users it sees. Joins, nick and mode changes are applied before their
+// events are fired, while parts, kicks and quits are applied afterwards,
+// so that handlers can still look up the users who are leaving.
+//
+// To fill in the user, host, account and away status of the users in
+// the network state, the Session sweeps each channel it joins with WHO
+// (using WHOX when the server supports it). Sweeps are sent one at a
+// time, with a delay between them, and the replies to them are not
+// passed on; replies to any other WHO (such as the user's own) are
+// handled like other numerics. Replies come back in the order the
+// WHOs were sent, which is how the two are told apart. A sweep which
+// isn't answered (the server may refuse it with RPL_TRYAGAIN) is
+// given up on after a while, and the next channel is swept.
+// The Session also requests the away-notify, account-notify and chghost
+// capabilities, which keep the state up to date without further sweeps;
+// without away-notify, channels are swept again every few minutes.
+//
+// The Session also owns the NotifyList, which is started at the end of
+// the MOTD (once the 005 numeric has said whether MONITOR is supported).
+// The replies to its own ISON polls are not passed on.
+//
+// PRIVMSGs and NOTICEs from users on the IgnoreList are dropped as soon
+// as their prefix is read, before they're parsed or fired as any event
+// (including "receivedData").
+//
+// Messages are checked for highlights against a WordMatcher built from
+// the user's nick, alternate nicks and highlight words, which is only
+// rebuilt when one of those changes.
 
 #pragma once
 
+#include <QHash>
 #include <QObject>
 #include <QString>
 #include <QSharedData>
 #include <QTime>
+#include <QTimer>
+#include <QQueue>
 #include "cv/Connection.h"
 #include "cv/Parser.h"
 #include "cv/EventManager.h"
+#include "cv/NumericRegistry.h"
+#include "cv/ChannelListStore.h"
+#include "cv/NetworkState.h"
+#include "cv/NotifyList.h"
+#include "cv/IgnoreList.h"
+#include "cv/CtcpLimiter.h"
+#include "cv/WordMatcher.h"
 
 namespace cv {
 
 class ConnectionEvent : public Event
 {
-    QString *   m_pHost;
-    quint16     m_port;
+    const QString & m_host;
+    quint16         m_port;
 
     // Only relevant for the "connectFailed" event.
     QAbstractSocket::SocketError m_error;
 
+    // Only used by copies of the event (see Event).
+    QString         m_hostCopy;
+
 public:
-    ConnectionEvent(QString &host, quint16 port)
-      : m_pHost(&host),
-        m_port(port)
+    ConnectionEvent(const QString &host, quint16 port)
+      : m_host(host),
+        m_port(port),
+        m_error(QAbstractSocket::UnknownSocketError)
     { }
-    ConnectionEvent(QString &host, quint16 port, QAbstractSocket::SocketError error)
-      : m_pHost(&host),
+    ConnectionEvent(const QString &host, quint16 port, QAbstractSocket::SocketError error)
+      : m_host(host),
         m_port(port),
         m_error(error)
     { }
+    ConnectionEvent(const ConnectionEvent &other)
+      : Event(),
+        m_host(m_hostCopy),
+        m_port(other.m_port),
+        m_error(other.m_error),
+        m_hostCopy(other.m_host)
+    { }
 
-    QString getHost() { return *m_pHost; }
-    quint16 getPort() { return m_port; }
-    QAbstractSocket::SocketError error() { return m_error; }
+    const QString &getHost() const { return m_host; }
+    quint16 getPort() const { return m_port; }
+    QAbstractSocket::SocketError error() const { return m_error; }
 };
 
 //-----------------------------------//
 
 class MessageEvent : public Event
 {
-    Message m_msg;
+    const Message & m_msg;
+
+    // Only used by copies of the event (see Event).
+    Message         m_msgCopy;
 
 public:
     MessageEvent(const Message &msg)
       : m_msg(msg)
     { }
+    MessageEvent(const MessageEvent &other)
+      : Event(),
+        m_msg(m_msgCopy),
+        m_msgCopy(other.m_msg)
+    { }
 
-    Message getMessage() { return m_msg; }
+    const Message &getMessage() const { return m_msg; }
 };
 
 //-----------------------------------//
 
 class DataEvent : public Event
 {
-    QString m_data;
+    const QString & m_data;
+
+    // Only used by copies of the event (see Event).
+    QString         m_dataCopy;
 
 public:
     DataEvent(const QString &data)
       : m_data(data)
     { }
+    DataEvent(const DataEvent &other)
+      : Event(),
+        m_data(m_dataCopy),
+        m_dataCopy(other.m_data)
+    { }
+
+    const QString &getData() const { return m_data; }
+};
+
+//-----------------------------------//
+
+class NetsplitEvent : public Event
+{
+    QString                         m_servers;
+    QHash<QString, QStringList>     m_channels;
+    QStringList                     m_nicks;
+
+public:
+    NetsplitEvent(const QString &servers,
+                  const QHash<QString, QStringList> &channels,
+                  const QStringList &nicks)
+      : m_servers(servers),
+        m_channels(channels),
+        m_nicks(nicks)
+    { }
+
+    // The two servers which split or linked again.
+    QString getServer1() const { return m_servers.section(' ', 0, 0); }
+    QString getServer2() const { return m_servers.section(' ', 1, 1); }
+
+    // The users who quit or joined in each channel, by the
+    // channel's case-folded name.
+    const QHash<QString, QStringList> &getChannels() const { return m_channels; }
 
-    QString getData() { return m_data; }
+    // All the users who quit or joined.
+    const QStringList &getNicks() const { return m_nicks; }
+};
+
+//-----------------------------------//
+
+// The store belongs to the Session, so this event can only be
+// handled on the Session's thread.
+class ChannelListEvent : public Event
+{
+    const ChannelListStore *    m_pStore;
+    int                         m_first;
+    int                         m_count;
+
+public:
+    ChannelListEvent(const ChannelListStore *pStore, int first, int count)
+      : m_pStore(pStore),
+        m_first(first),
+        m_count(count)
+    { }
+
+    const ChannelListStore *getStore() const { return m_pStore; }
+
+    // The batch is made up of rows [first, first + count) of the store.
+    int getFirst() const { return m_first; }
+    int getCount() const { return m_count; }
 };
 
 //-----------------------------------//
@@ -127,6 +265,105 @@ private:
     // then parsed.
     QString             m_prevData;
 
+    // Callbacks for specific numerics, indexed by the numeric.
+    NumericRegistry     m_numerics;
+
+    // IDs of the events fired by the Session. The "<command>Message"
+    // events are indexed by the IRC_COMMAND_* value which fires them.
+    int                 m_connectingEvt;
+    int                 m_connectFailedEvt;
+    int                 m_connectedEvt;
+    int                 m_disconnectedEvt;
+    int                 m_sendDataEvt;
+    int                 m_receivedDataEvt;
+    int                 m_channelListBatchEvt;
+    int                 m_numericMessageEvt;
+    int                 m_commandEvts[NUM_IRC_COMMANDS];
+
+    // Channels received from the last LIST request. While
+    // [m_listActive] is true (between the 321 and 323 numerics),
+    // [m_listBatchStart] is the first row which has not yet been
+    // handed on through the "channelListBatch" event.
+    ChannelListStore    m_channelList;
+    bool                m_listActive;
+    int                 m_listBatchStart;
+    QTime               m_listBatchTime;
+
+    // The channels we're in, and the users in them.
+    NetworkState        m_state;
+
+    // Capabilities which the server has acknowledged, and the ones
+    // it has offered so far while a CAP LS reply is being received.
+    QStringList         m_caps;
+    QStringList         m_offeredCaps;
+
+    // This comes from the 005 numeric, WHOX, which means the server
+    // lets us pick the fields of WHO replies.
+    bool                m_hasWhox;
+
+    // Case-folded names of the channels waiting to be swept with WHO,
+    // and of the one being swept right now (empty if there is none).
+    QQueue<QString>     m_whoQueue;
+    QString             m_whoChannel;
+    QTimer              m_whoTimer;
+    QTimer              m_whoRefreshTimer;
+    QTimer              m_whoTimeoutTimer;
+
+    // The WHOs which haven't been answered yet, in the order they were
+    // sent, by case-folded mask; [isSweep] is false for the user's own.
+    struct PendingWho
+    {
+        QString     mask;
+        bool        isSweep;
+    };
+    QList<PendingWho>   m_pendingWhos;
+
+    // The nicknames the user wants to know about.
+    NotifyList          m_notifyList;
+
+    // The hostmasks the user doesn't want to hear from.
+    IgnoreList          m_ignoreList;
+
+    // Limits the replies to CTCP requests.
+    CtcpLimiter         m_ctcpLimiter;
+
+    // The words which highlight a message: the user's nick,
+    // followed by [m_altNicks] and [m_highlightWords].
+    QStringList         m_altNicks;
+    QStringList         m_highlightWords;
+    WordMatcher         m_highlighter;
+
+    enum SplitType
+    {
+        SplitTypeNone,
+        SplitTypeQuit,
+        SplitTypeJoin
+    };
+
+    // The netsplit or netjoin being collected, if [m_splitType] isn't
+    // SplitTypeNone; [m_splitServers] is the QUIT reason it was detected
+    // by, and [m_splitChannels] holds the users in each channel, by its
+    // case-folded name. It is fired once [m_splitTimer] runs out.
+    SplitType                   m_splitType;
+    QString                     m_splitServers;
+    QHash<QString, QStringList> m_splitChannels;
+    QStringList                 m_splitNicks;
+    QTimer                      m_splitTimer;
+
+    // Users who quit in a recent netsplit, by case-folded nickname;
+    // their JOINs make up the netjoin when the servers link again.
+    // Each is forgotten [expireMsec] after [time], which is restarted
+    // (with a much shorter expiry) once the user's netjoin is fired.
+    struct SplitUser
+    {
+        QString     servers;
+        QTime       time;
+        int         expireMsec;
+    };
+    QHash<QString, SplitUser>   m_splitUsers;
+    int                         m_netsplitEvt;
+    int                         m_netjoinEvt;
+
 public:
     Session(const QString& nick);
     ~Session();
@@ -138,14 +375,14 @@ public:
 
     // Exposed functions for sending messages.
     void sendData(const QString &data);
-    void onSendData(Event *pEvt);
+    void onSendData(const DataEvent &evt);
     void sendPrivmsg(const QString &target, const QString &msg);
     void sendAction(const QString &target, const QString &msg);
 
     void setHost(const QString &host) { m_host = host; }
     QString getHost() { return m_host; }
     int getPort() { return m_port; }
-    void setNick(const QString &nick) { m_nick = nick; }
+    void setNick(const QString &nick);
     QString getNick() { return m_nick; }
     bool isMyNick(const QString &nick) { return (m_nick.compare(nick, Qt::CaseSensitive) == 0); }
 
@@ -156,11 +393,67 @@ public:
     int getModeNum() { return m_modeNum; }
 
     int compareNickPrefixes(const QChar &prefix1, const QChar &prefix2);
+    int getPrefixRank(const QChar &prefix);
+    QChar getNickPrefix(int rank);
     QChar getPrefixRule(const QChar &match);
     bool isNickPrefix(const QChar &prefix);
 
+    // Numeric callbacks are executed in the order they were hooked.
+    void hookNumeric(int numeric, NumericCallback callback) { m_numerics.hookNumeric(numeric, callback); }
+    void unhookNumeric(int numeric, NumericCallback callback) { m_numerics.unhookNumeric(numeric, callback); }
+
+    ChannelListStore *getChannelList() { return &m_channelList; }
+    bool isListActive() { return m_listActive; }
+
+    bool hasCap(const QString &cap) { return m_caps.contains(cap, Qt::CaseInsensitive); }
+    void queueWho(const QString &channel);
+
+    NetworkState *getNetworkState() { return &m_state; }
+    NotifyList *getNotifyList() { return &m_notifyList; }
+    IgnoreList *getIgnoreList() { return &m_ignoreList; }
+    CtcpLimiter *getCtcpLimiter() { return &m_ctcpLimiter; }
+
+    void setAltNicks(const QStringList &altNicks);
+    void setHighlightWords(const QStringList &words);
+
+    // Returns true if [text] contains the user's nick or
+    // one of the highlight words, false otherwise.
+    bool isHighlight(const QString &text) const { return m_highlighter.contains(text); }
+
     void processMessage(const Message &msg);
 
+private:
+    QString getMessageTarget(const Message &msg);
+    bool isIgnoredLine(const QString &data);
+    void updateHighlighter();
+    void flushChannelList(bool force);
+    void updateNetworkState(const Message &msg);
+    void pruneNetworkState(const Message &msg);
+    void handleCap(const Message &msg);
+    SplitType getSplitType(const Message &msg, QString &servers);
+    void collectSplit(const Message &msg, SplitType type, const QString &servers);
+    int findPendingWho(const QString &mask);
+    bool isWhoSweepReply(const QString &channel);
+
+    // Numeric messages
+    void handle001Numeric(const Message &msg);
+    void handle002Numeric(const Message &msg);
+    void handle005Numeric(const Message &msg);
+    void handle303Numeric(const Message &msg);
+    void handle321Numeric(const Message &msg);
+    void handle322Numeric(const Message &msg);
+    void handle315Numeric(const Message &msg);
+    void handle323Numeric(const Message &msg);
+    void handle352Numeric(const Message &msg);
+    void handle353Numeric(const Message &msg);
+    void handle354Numeric(const Message &msg);
+    void handleListEntryNumeric(const Message &msg);
+    void handleEndOfListNumeric(const Message &msg);
+    void handle376Numeric(const Message &msg);
+    void handle730Numeric(const Message &msg);
+    void handle731Numeric(const Message &msg);
+    void handle734Numeric(const Message &msg);
+
 signals:
     void connectToHost(QString, quint16);
 
@@ -172,6 +465,12 @@ public slots:
     void onFailedConnect();
     void onDisconnect();
     void onReceiveData(const QString &data);
+
+private slots:
+    void sendNextWho();
+    void refreshWho();
+    void abandonWho();
+    void flushSplit();
 };
 
 } // End namespace
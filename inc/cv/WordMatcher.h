@@ -0,0 +1,73 @@
+// Copyright (c) 2011 Conviersa Project. Use of this source code
+// is governed by the MIT License.
+//
+//
+// WordMatcher finds whole-word occurrences of any of a set of words
+// within a line of text, ignoring case. A word only counts if the
+// characters on either side of it (if any) aren't letters or digits,
+// so "bob" is found in "bob: hi" but not in "bobby".
+//
+// The words are compiled into one Aho-Corasick automaton when they're
+// set, so a line is scanned in a single pass, one step per character,
+// no matter how many words there are; the Session keeps one for
+// highlights (the user's nicks and keywords), and each ChannelWindow
+// keeps one for the nicks of the users in the channel.
+
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+namespace cv {
+
+struct WordMatch
+{
+    int     start;
+    int     length;
+};
+
+//-----------------------------------//
+
+class WordMatcher
+{
+    struct Node
+    {
+        QHash<ushort, int>  next;
+
+        // The node for the longest proper suffix of this one which is
+        // also in the automaton, and the nearest node along that chain
+        // which ends a word (-1 if there is none).
+        int                 fail;
+        int                 output;
+
+        // The length of the word which ends at this node, or 0.
+        int                 length;
+
+        Node() : fail(0), output(-1), length(0) { }
+    };
+
+    QStringList     m_words;
+    QVector<Node>   m_nodes;
+
+public:
+    WordMatcher();
+
+    void setWords(const QStringList &words);
+    const QStringList &getWords() const { return m_words; }
+    bool isEmpty() const { return m_nodes.size() <= 1; }
+
+    // Returns true if any of the words is within [text].
+    bool contains(const QString &text) const { return scan(text, NULL); }
+    QList<WordMatch> findAll(const QString &text) const;
+
+private:
+    void compile();
+    bool scan(const QString &text, QList<WordMatch> *pMatches) const;
+
+    static bool isBoundary(const QString &text, int idx);
+};
+
+} // End namespace
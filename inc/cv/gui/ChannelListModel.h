@@ -0,0 +1,49 @@
+// Copyright (c) 2011 Conviersa Project. Use of this source code
+// is governed by the MIT License.
+//
+//
+// ChannelListModel is the model used by ChannelListWindow. It does
+// not copy any data; it presents the rows of the Session's
+// ChannelListStore directly, and only keeps track of how many of
+// those rows have been made visible to the view so far, so that
+// a whole batch of channels can be inserted with one notification.
+
+#pragma once
+
+#include <QAbstractTableModel>
+
+namespace cv {
+
+class ChannelListStore;
+
+namespace gui {
+
+class ChannelListModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+    const ChannelListStore *    m_pStore;
+    int                         m_numRows;
+
+    // If true, topics are displayed with their control codes;
+    // otherwise they are stripped and escaped.
+    bool                        m_displayCodes;
+
+public:
+    // Holds the topic without any control codes, for the topic column.
+    static const int StrippedTopicRole = Qt::UserRole;
+
+    ChannelListModel(const ChannelListStore *pStore, QObject *parent = NULL);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+    void appendRows(int count);
+    void clear();
+
+    void setDisplayCodes(bool displayCodes) { m_displayCodes = displayCodes; }
+};
+
+} } // End namespaces
@@ -11,7 +11,6 @@
 
 class QVBoxLayout;
 class QTreeView;
-class QStandardItemModel;
 class QModelIndex;
 class QWidget;
 class QPushButton;
@@ -24,9 +23,11 @@ class QSpinBox;
 namespace cv {
 
 class Session;
+class ChannelListStore;
 
 namespace gui {
 
+class ChannelListModel;
 class SearchBar;
 class CLineEdit;
 class ChannelTopicDelegate;
@@ -37,11 +38,14 @@ class ChannelListWindow : public Window
 
     Session *               m_pSession;
 
+    // The channels themselves are owned by the Session.
+    const ChannelListStore *m_pStore;
+
     // Main layout is vbox.
     QVBoxLayout *           m_pVLayout;
 
     QTreeView *             m_pView;
-    QStandardItemModel *    m_pModel;
+    ChannelListModel *      m_pModel;
     ChannelTopicDelegate *  m_pDelegate;
     bool                    m_populatingList;
 
@@ -86,7 +90,7 @@ public:
     void giveFocus();
 
     void beginPopulatingList();
-    void addChannel(const QString &channel, const QString &numUsers, const QString &topic);
+    void addChannels(int count);
     void endPopulatingList();
     void clearList();
 
@@ -0,0 +1,87 @@
+// Copyright (c) 2011 Conviersa Project. Use of this source code
+// is governed by the MIT License.
+//
+//
+// ChannelUserModel is the model for the userlist of a ChannelWindow.
+// It holds the channel's users as a vector sorted by the rank of each
+// user's most powerful prefix, then by case-folded nickname, along
+// with an index from case-folded nickname to row entry. The users
+// themselves belong to the Session's NetworkState, and the text of
+// each row is only built when the view asks for it.
+//
+// The rank and nickname a user was sorted by are copied into its
+// entry, so the vector stays sorted by them even after the Session
+// has changed the user; updateUser() then moves the user's row.
+//
+// The model also finds the nicknames for tab-completion, with the
+// users who have spoken most recently first.
+
+#pragma once
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QStringList>
+#include <QVector>
+
+namespace cv {
+
+class Session;
+class ChannelUser;
+
+namespace gui {
+
+struct UserListEntry
+{
+    ChannelUser *       pUser;
+    int                 rank;
+    QString             nick;
+};
+
+class ChannelUserModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+    Session *                       m_pSession;
+    QVector<UserListEntry>          m_users;
+    QHash<QString, UserListEntry>   m_userIndex;
+
+    // The users ordered by case-folded nickname, so that
+    // all the nicknames starting with a word are adjacent.
+    QMap<QString, ChannelUser *>    m_completionIndex;
+
+    // The number of messages spoken in the channel; each user's
+    // priority is set to this when they speak.
+    int                             m_numMessages;
+
+public:
+    // Holds the nickname without any prefixes.
+    static const int NicknameRole = Qt::UserRole;
+
+    ChannelUserModel(Session *pSession, QObject *parent = NULL);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+
+    ChannelUser *getUser(int row) const { return m_users[row].pUser; }
+    int getUserCount() const { return m_users.size(); }
+    bool hasUser(const QString &nick) const;
+
+    bool addUser(ChannelUser *pUser);
+    void addUsers(const QList<ChannelUser *> &users);
+    bool removeUser(const QString &nick);
+    void removeUsers(const QStringList &nicks);
+    void updateUser(const QString &oldNick, ChannelUser *pUser);
+    void clear();
+
+    QStringList findCompletions(const QString &word) const;
+    void setUserSpoke(ChannelUser *pUser);
+
+private:
+    UserListEntry createEntry(ChannelUser *pUser);
+    int findInsertionIndex(const UserListEntry &entry) const;
+    int findRow(const UserListEntry &entry) const;
+};
+
+} } // End namespaces
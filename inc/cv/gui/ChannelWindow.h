@@ -5,31 +5,46 @@
 // ChannelWindow is a Window that provides the user interface for
 // chatting within an IRC channel. It owns input and output
 // controls, as well as a list of users currently in the channel.
+// The users themselves belong to the Session's NetworkState; the
+// window only keeps them sorted for display, in a ChannelUserModel.
 //
 // QueuedOutputMessage represents a message that is to be displayed
 // after the channel is "officially" joined; in other words, when the
-// list of users is received from the server.
+// list of users is received from the server. The names in that list
+// are also held back until it ends, and then sorted all at once.
+//
+// With the smart filter on ("irc.channel.smartFilter"), the joins, parts
+// and quits of users who haven't spoken in the last few minutes are
+// dropped before they're formatted, as are those of ignored users.
+//
+// The nicks in the userlist are made into links in the output with a
+// WordMatcher, which is rebuilt (when a line is next printed) whenever
+// the userlist changes.
 
 #pragma once
 
 #include <QApplication>
+#include <QHash>
 #include <QString>
 #include <QQueue>
 #include "cv/ChannelUser.h"
+#include "cv/Parser.h"
+#include "cv/WordMatcher.h"
 #include "cv/gui/InputOutputWindow.h"
 
-class QListWidget;
-class QListWidgetItem;
+class QListView;
+class QModelIndex;
 class QSplitter;
 
 namespace cv {
 
 class Session;
+class ConnectionEvent;
+class NetsplitEvent;
 
 namespace gui {
 
-// This is subject to change.
-const unsigned int MAX_NICK_PRIORITY = 1;
+class ChannelUserModel;
 
 struct QueuedOutputMessage
 {
@@ -42,15 +57,14 @@ class ChannelWindow : public InputOutputWindow
     Q_OBJECT
 
 protected:
-    QListWidget *               m_pUserList;
+    QListView *                 m_pUserList;
+    ChannelUserModel *          m_pUserModel;
     QSplitter *                 m_pSplitter;
 
-    QList<ChannelUser *>        m_users;
-
     // These variables are used to keep track of
     // the set of nicks that are currently matches
     // against the autocomplete string.
-    QList<ChannelUser *>        m_autocompleteMatches;
+    QStringList                 m_autocompleteMatches;
     int                         m_matchesIdx;
     QString                     m_preAutocompleteStr;
     QString                     m_postAutocompleteStr;
@@ -62,6 +76,19 @@ protected:
     bool                        m_inChannel;
     QQueue<QueuedOutputMessage> m_messageQueue;
 
+    // Names received from 353 numerics (RPL_NAMREPLY) while
+    // joining, which are added to the userlist at 366.
+    QStringList                 m_pendingNames;
+
+    // When each user last spoke in the channel (in seconds since the
+    // epoch), by case-folded nickname; used by the smart filter.
+    QHash<QString, uint>        m_lastSpoke;
+
+    // Finds the nicks of the users in the channel within the output;
+    // [m_nickMatcherDirty] is set when the userlist changes.
+    WordMatcher                 m_nickMatcher;
+    bool                        m_nickMatcherDirty;
+
 public:
     ChannelWindow(Session *pSession,
                   QExplicitlySharedDataPointer<ServerConnectionPanel> pSharedServerConnPanel,
@@ -74,29 +101,35 @@ public:
     // Returns true if the user is in the channel, false otherwise.
     bool hasUser(const QString &user) { return (findUser(user) != NULL); }
 
-    bool addUser(const QString &user);
     bool removeUser(const QString &user);
     void changeUserNick(const QString &oldNick, const QString &newNick);
-    void addPrefixToUser(const QString &user, const QChar &prefixToAdd);
-    void removePrefixFromUser(const QString &user, const QChar &prefixToRemove);
     QString fetchProperNickname(const QString &user);
+    bool isFilteredUser(const QString &prefix);
 
     // Returns the number of users currently in the channel.
-    int getUserCount() { return m_users.size(); }
+    int getUserCount();
+
+    // Numeric messages
+    void handle332Numeric(const Message &msg);
+    void handle333Numeric(const Message &msg);
+    void handle353Numeric(const Message &msg);
+    void handle366Numeric(const Message &msg);
 
     // Event callbacks
-    void onNumericMessage(Event *pEvent);
-    void onJoinMessage(Event *pEvent);
-    void onKickMessage(Event *pEvent);
-    void onModeMessage(Event *pEvent);
-    void onNickMessage(Event *pEvent);
-    void onNoticeMessage(Event *pEvent);
-    void onPartMessage(Event *pEvent);
-    void onPrivmsgMessage(Event *pEvent);
-    void onTopicMessage(Event *pEvent);
-    void onOutput(Event *pEvent);
-    void onDoubleClickLink(Event *pEvent);
-    void onColorConfigChanged(Event *pEvent);
+    void onJoinMessage(const MessageEvent &evt);
+    void onKickMessage(const MessageEvent &evt);
+    void onModeMessage(const MessageEvent &evt);
+    void onNickMessage(const MessageEvent &evt);
+    void onNoticeMessage(const MessageEvent &evt);
+    void onPartMessage(const MessageEvent &evt);
+    void onPrivmsgMessage(const MessageEvent &evt);
+    void onTopicMessage(const MessageEvent &evt);
+    void onNetsplit(const NetsplitEvent &evt);
+    void onNetjoin(const NetsplitEvent &evt);
+    void onDisconnect(const ConnectionEvent &evt);
+    void onOutput(const OutputEvent &evt);
+    void onDoubleClickLink(const DoubleClickLinkEvent &evt);
+    void onColorConfigChanged(const ConfigEvent &evt);
 
     static void setupColorConfig(QMap<QString, ConfigOption> &defOptions);
 
@@ -115,8 +148,8 @@ protected:
     void closeEvent(QCloseEvent *event);
 
 private:
-    bool addUser(ChannelUser *pUser);
-    void removeUser(ChannelUser *pUser);
+    void addPendingUsers();
+    void setUserSpoke(const QString &nick);
     ChannelUser *findUser(const QString &user);
 
 signals:
@@ -125,7 +158,10 @@ signals:
     void chanWindowClosing(ChannelWindow *pWin);
 
 public slots:
-    void onUserDoubleClicked(QListWidgetItem *pItem);
+    void onUserDoubleClicked(const QModelIndex &index);
+
+private slots:
+    void invalidateNickMatcher();
 };
 
 } } // End namespaces
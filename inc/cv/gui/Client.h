@@ -3,7 +3,8 @@
 //
 //
 // Client is the main class of Conviersa. It is the main window of the client,
-// and constructs the EventManager and ConfigManager, and owns the WindowManager.
+// and constructs the EventManager and ConfigManager, and owns the WindowManager
+// and the PluginManager.
 
 #pragma once
 
@@ -19,6 +20,7 @@ class QTimer;
 namespace cv {
 
 struct ConfigOption;
+class PluginManager;
 
 namespace gui {
 
@@ -42,6 +44,8 @@ private:
     // that we can find the updated client size.
     QTimer *            m_pResizeTimer;
 
+    PluginManager *     m_pPluginManager;
+
 public:
     Client(const QString &title);
     ~Client();
@@ -9,7 +9,11 @@
 
 #include "cv/gui/OutputWindow.h"
 
-namespace cv { namespace gui {
+namespace cv {
+
+class DataEvent;
+
+namespace gui {
 
 class DebugWindow : public OutputWindow
 {
@@ -21,11 +25,11 @@ public:
 
     void giveFocus() { }
 
-    void onSendData(Event *pEvt);
-    void onReceivedData(Event *pEvt);
+    void onSendData(const DataEvent &evt);
+    void onReceivedData(const DataEvent &evt);
 
-    void onOutput(Event *pEvt);
-    void onDoubleClickLink(Event *pEvt);
+    void onOutput(const OutputEvent &evt);
+    void onDoubleClickLink(const DoubleClickLinkEvent &evt);
 };
 
 } } // End namespaces
@@ -16,6 +16,7 @@ class QPushButton;
 namespace cv {
 
 class Session;
+class MessageEvent;
 
 namespace gui {
 
@@ -36,9 +37,9 @@ public:
           m_input(input)
     { }
 
-    InputOutputWindow *getWindow() { return m_pWindow; }
-    Session *getSession() { return m_pSession; }
-    QString getInput() { return m_input; }
+    InputOutputWindow *getWindow() const { return m_pWindow; }
+    Session *getSession() const { return m_pSession; }
+    QString getInput() const { return m_input; }
 };
 
 class InputOutputWindow : public OutputWindow
@@ -61,10 +62,10 @@ public:
     void giveFocus();
 
     // Event callbacks
-    void onInput(Event *pEvent);
-    void onNoticeMessage(Event *pEvent);
+    void onInput(const InputEvent &evt);
+    void onNoticeMessage(const MessageEvent &evt);
 
-    void onColorConfigChanged(Event *pEvent);
+    void onColorConfigChanged(const ConfigEvent &evt);
 
     static void setupColorConfig(QMap<QString, ConfigOption> &defOptions);
 
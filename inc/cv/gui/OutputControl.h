@@ -65,6 +65,7 @@ class QMouseEvent;
 namespace cv {
 
 struct ConfigOption;
+class ConfigEvent;
 
 namespace gui {
 
@@ -77,8 +78,11 @@ struct LinkInfo {
 
 class OutputEvent : public Event
 {
-    QString         m_text;
-    QList<LinkInfo> m_linkInfoList;
+    QString                 m_text;
+
+    // Links are added by the callbacks while the event is
+    // being fired, so this is writable through a const event.
+    mutable QList<LinkInfo> m_linkInfoList;
 
 public:
     OutputEvent(const QString &text)
@@ -91,7 +95,7 @@ public:
     const QList<LinkInfo> &getLinkInfoList() const { return m_linkInfoList; }
 
     // Modifiers
-    void addLinkInfo(int startIdx, int endIdx)
+    void addLinkInfo(int startIdx, int endIdx) const
     {
         // Do bounds checking on indices.
         if(startIdx > endIdx || startIdx < 0 || endIdx >= m_text.length())
@@ -468,9 +472,12 @@ class OutputControl : public QAbstractScrollArea
     // large loops. Instead, we allocate a block and use
     // placement new.
     char                m_fmBlock[sizeof(QFontMetrics)];
-    char                m_evtBlock[sizeof(OutputEvent)];
     void *              m_pFM;
-    void *              m_pEvt;
+
+    // ID of the "output" event, which is fired for every line.
+    int                 m_outputEvt;
+
+    EventHandle         m_configChangedHandle;
 
 public:
     static const int    PADDING = 3;
@@ -487,7 +494,7 @@ public:
     void changeFont(const QFont &font);
 
     // Event callbacks
-    void onConfigChanged(Event *pEvent);
+    void onConfigChanged(const ConfigEvent &evt);
 
     static void setupColorConfig(QMap<QString, ConfigOption> &defOptions);
 
@@ -91,8 +91,9 @@ protected:
     // OutputControl's text.
     OutputWindowScrollBar * m_pScrollBar;
 
-    static QString          s_invalidNickPrefix;
-    static QString          s_invalidNickSuffix;
+    // Callbacks hooked by this window (and its subclasses),
+    // which are unhooked when it is destroyed.
+    EventHandleList         m_eventHandles;
 
 public:
     OutputWindow(const QString &title = tr("Untitled"),
@@ -110,8 +111,8 @@ public:
     bool containsNick(const QString &text);
     void focusedInTree();
 
-    virtual void onOutput(Event *pEvent) = 0;
-    virtual void onDoubleClickLink(Event *pEvent) = 0;
+    virtual void onOutput(const OutputEvent &evt) = 0;
+    virtual void onDoubleClickLink(const DoubleClickLinkEvent &evt) = 0;
 
 protected:
     // Imitates Google Chrome's search, with lines drawn in the scrollbar
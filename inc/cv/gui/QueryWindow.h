@@ -8,6 +8,8 @@
 #pragma once
 
 #include <QApplication>
+#include "cv/Parser.h"
+#include "cv/WordMatcher.h"
 #include "cv/gui/InputOutputWindow.h"
 
 namespace cv {
@@ -22,6 +24,10 @@ class QueryWindow : public InputOutputWindow
 
 private:
     QString     m_targetNick;
+    EventHandle m_privmsgHandle;
+
+    // Finds [m_targetNick] in the output, to make it a link.
+    WordMatcher m_nickMatcher;
 
 public:
     QueryWindow(Session *pSession,
@@ -33,16 +39,20 @@ public:
     QString getTargetNick();
     bool isTargetNick(const QString &nick) { return (m_targetNick.compare(nick, Qt::CaseSensitive) == 0); }
 
+    // Numeric messages
+    void handle401Numeric(const Message &msg);
+
     // Event callbacks
-    void onNumericMessage(Event *pEvent);
-    void onNickMessage(Event *pEvent);
-    void onNoticeMessage(Event *pEvent);
-    void onPrivmsgMessage(Event *pEvent);
+    void onNickMessage(const MessageEvent &evt);
+    void onNoticeMessage(const MessageEvent &evt);
+    void onPrivmsgMessage(const MessageEvent &evt);
 
-    void onOutput(Event *pEvent);
-    void onDoubleClickLink(Event *pEvent);
+    void onOutput(const OutputEvent &evt);
+    void onDoubleClickLink(const DoubleClickLinkEvent &evt);
 
 protected:
+    void hookTargetEvents();
+
     void handleSay(const QString &text);
     void handleAction(const QString &text);
     void handleTab();
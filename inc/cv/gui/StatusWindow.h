@@ -8,11 +8,20 @@
 
 #pragma once
 
+#include <QHash>
+#include <QTimer>
 #include "cv/Parser.h"
 #include "cv/gui/InputOutputWindow.h"
 #include "cv/gui/ServerConnectionPanel.h"
 
-namespace cv { namespace gui {
+namespace cv {
+
+class ConnectionEvent;
+class ChannelListEvent;
+class NetsplitEvent;
+class NotifyEvent;
+
+namespace gui {
 
 class ChannelListWindow;
 class ChannelWindow;
@@ -30,6 +39,13 @@ protected:
     QList<ChannelWindow *>  m_chanList;
     QList<QueryWindow *>    m_privList;
 
+    // Both kinds of child windows, by their case-folded names.
+    QHash<QString, OutputWindow *>  m_childWindows;
+
+    // Runs from the first CTCP request which wasn't replied to
+    // until they're all summed up.
+    QTimer                  m_ctcpSummaryTimer;
+
 public:
     StatusWindow(const QString &title = tr("Server Window"),
                  const QSize &size = QSize(500, 300));
@@ -45,26 +61,35 @@ public:
     QList<QueryWindow *> getPrivateMessages();
     void addChannelWindow(ChannelWindow *pChan);
     void addQueryWindow(QueryWindow *pPriv, bool giveFocus);
+    void renameQueryWindow(QueryWindow *pQueryWin, const QString &newNick);
 
     // Event callbacks
-    void onServerConnecting(Event *pEvent);
-    void onServerConnectFailed(Event *pEvent);
-    void onServerConnect(Event *pEvent);
-    void onServerDisconnect(Event *pEvent);
-    void onErrorMessage(Event *pEvent);
-    void onInviteMessage(Event *pEvent);
-    void onJoinMessage(Event *pEvent);
-    void onModeMessage(Event *pEvent);
-    void onNickMessage(Event *pEvent);
-    void onPongMessage(Event *pEvent);
-    void onPrivmsgMessage(Event *pEvent);
-    void onQuitMessage(Event *pEvent);
-    void onWallopsMessage(Event *pEvent);
-    void onNumericMessage(Event *pEvent);
-    void onUnknownMessage(Event *pEvent);
-
-    void onOutput(Event *pEvent);
-    void onDoubleClickLink(Event *pEvent);
+    void onServerConnecting(const ConnectionEvent &evt);
+    void onServerConnectFailed(const ConnectionEvent &evt);
+    void onServerConnect(const ConnectionEvent &evt);
+    void onServerDisconnect(const ConnectionEvent &evt);
+    void onChannelListBatch(const ChannelListEvent &evt);
+    void onErrorMessage(const MessageEvent &evt);
+    void onInviteMessage(const MessageEvent &evt);
+    void onJoinMessage(const MessageEvent &evt);
+    void onModeMessage(const MessageEvent &evt);
+    void onNickMessage(const MessageEvent &evt);
+    void onPongMessage(const MessageEvent &evt);
+    void onPrivmsgMessage(const MessageEvent &evt);
+    void onQuitMessage(const MessageEvent &evt);
+    void onWallopsMessage(const MessageEvent &evt);
+    void onNetsplit(const NetsplitEvent &evt);
+    void onNetjoin(const NetsplitEvent &evt);
+    void onNumericMessage(const MessageEvent &evt);
+    void onUnknownMessage(const MessageEvent &evt);
+    void onNotifyOnline(const NotifyEvent &evt);
+    void onNotifyOffline(const NotifyEvent &evt);
+    void onNotifyConfigChanged(const ConfigEvent &evt);
+    void onIgnoreConfigChanged(const ConfigEvent &evt);
+    void onHighlightConfigChanged(const ConfigEvent &evt);
+
+    void onOutput(const OutputEvent &evt);
+    void onDoubleClickLink(const DoubleClickLinkEvent &evt);
 
     static void setupServerConfig(QMap<QString, ConfigOption> &defOptions);
     static void setupIRCConfig(QMap<QString, ConfigOption> &defOptions);
@@ -77,12 +102,27 @@ protected:
     bool eventFilter(QObject *obj, QEvent *event);
 
 private:
+    void setupNotifyList();
+    void setupIgnoreList();
+    void setupHighlightWords();
+    static QStringList getAltNicks(const QString &altNick);
+
     // Numeric messages
+    void printNumeric(const Message &msg);
+    void handle001Numeric(const Message &msg);
+    void handle301Numeric(const Message &msg);
+    void handle317Numeric(const Message &msg);
     void handle321Numeric(const Message &msg);
-    void handle322Numeric(const Message &msg);
     void handle323Numeric(const Message &msg);
+    void handle330Numeric(const Message &msg);
+    void handle332Numeric(const Message &msg);
+    void handle333Numeric(const Message &msg);
     void handle353Numeric(const Message &msg);
     void handle366Numeric(const Message &msg);
+    void handle401Numeric(const Message &msg);
+
+private slots:
+    void printCtcpSummary();
 
 public slots:
     void removeChannelWindow(ChannelWindow *pChanWin);
@@ -12,14 +12,15 @@
 #include <QMouseEvent>
 #include <QMenu>
 #include <QList>
+#include "cv/EventManager.h"
 #include "cv/gui/definitions.h"
 
 class QMdiSubWindow;
-class Event;
 
 namespace cv {
 
 struct ConfigOption;
+class ConfigEvent;
 
 namespace gui {
 
@@ -41,6 +42,8 @@ private:
     QAction *           m_pActMoveNewCont;
     QList<QAction *>    m_actsMoveAltCont;
 
+    EventHandleList     m_eventHandles;
+
 public:
     WindowManager(QWidget *pParent, WindowContainer *pMainContainer);
     ~WindowManager();
@@ -77,8 +80,8 @@ protected:
     void setupColors();
     void setupContextMenu();
 
-    void onBackgroundColorChanged(Event *pEvent);
-    void onForegroundColorChanged(Event *pEvent);
+    void onBackgroundColorChanged(const ConfigEvent &evt);
+    void onForegroundColorChanged(const ConfigEvent &evt);
 
     void contextMenuEvent(QContextMenuEvent *event);
 };
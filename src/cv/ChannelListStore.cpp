@@ -0,0 +1,26 @@
+// Copyright (c) 2011 Conviersa Project. Use of this source code
+// is governed by the MIT License.
+
+#include "cv/ChannelListStore.h"
+
+namespace cv {
+
+// Removes every channel from the store.
+void ChannelListStore::clear()
+{
+    m_names.clear();
+    m_numUsers.clear();
+    m_topics.clear();
+}
+
+//-----------------------------------//
+
+// Adds a channel to the end of the store.
+void ChannelListStore::append(const QString &name, int numUsers, const QString &topic)
+{
+    m_names.append(name);
+    m_numUsers.append(numUsers);
+    m_topics.append(topic);
+}
+
+} // End namespace
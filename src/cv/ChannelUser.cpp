@@ -2,65 +2,37 @@
 // is governed by the MIT License.
 
 #include "cv/ChannelUser.h"
-#include "cv/Parser.h"
 #include "cv/Session.h"
 
 namespace cv {
 
-// Parses the input nick into nickname, and prefixes and user/host (if applicable).
-ChannelUser::ChannelUser(Session *pSession, const QString &nick)
-    : m_pSession(pSession)
-{
-    m_nickname = nick.section('!', 0, 0);
-
-    // Get the prefixes from the nickname (if any).
-    int numPrefixes = 0;
-    for(int i = 0; i < m_nickname.size() && m_pSession->isNickPrefix(m_nickname[i]); ++i)
-    {
-        m_prefixes += m_nickname[i];
-        ++numPrefixes;
-    }
+// The most prefixes a server can define that fit in the bitmask.
+const int MAX_NICK_PREFIXES = 32;
 
-    // Remove the prefixes from [m_nickname].
-    if(numPrefixes > 0)
-    {
-        m_nickname.remove(0, numPrefixes);
-    }
+//-----------------------------------//
 
-    // Get the user and host, if applicable.
-    if(nick.indexOf('!') >= 0)
-    {
-        QString userAndHost = nick.section('!', 1);
-        m_user = userAndHost.section('@', 0, 0);
-        m_host = userAndHost.section('@', 1);
-    }
+ChannelUser::ChannelUser(Session *pSession, IrcUser *pUser, const QString &prefixes/* = QString()*/)
+  : m_pSession(pSession),
+    m_pUser(pUser),
+    m_prefixBits(0),
+    m_priority(0)
+{
+    for(int i = 0; i < prefixes.size(); ++i)
+        addPrefix(prefixes[i]);
 }
 
 //-----------------------------------//
 
-// Adds the given prefix to the user, unless it's
-// already there or it isn't a valid prefix.
-void ChannelUser::addPrefix(const QChar &prefixToAdd)
+// Adds the given prefix to the user, unless it
+// isn't a valid prefix.
+void ChannelUser::addPrefix(const QChar &prefix)
 {
-    if(!m_pSession->isNickPrefix(prefixToAdd))
+    if(!m_pSession->isNickPrefix(prefix))
         return;
 
-    // Insert the prefix in the right spot.
-    for(int i = 0; i < m_prefixes.size(); ++i)
-    {
-        int compareVal = m_pSession->compareNickPrefixes(m_prefixes[i], prefixToAdd);
-        if(compareVal > 0)
-        {
-            m_prefixes.insert(i, prefixToAdd);
-            return;
-        }
-        else if(compareVal == 0)
-        {
-            return;
-        }
-    }
-
-    m_prefixes.append(prefixToAdd);
+    int rank = m_pSession->getPrefixRank(prefix);
+    if(rank < MAX_NICK_PREFIXES)
+        m_prefixBits |= (1u << rank);
 }
 
 //-----------------------------------//
@@ -68,37 +40,38 @@ void ChannelUser::addPrefix(const QChar &prefixToAdd)
 // Removes the given prefix from the user, if it exists.
 void ChannelUser::removePrefix(const QChar &prefix)
 {
-    m_prefixes.remove(prefix);
+    if(!m_pSession->isNickPrefix(prefix))
+        return;
+
+    int rank = m_pSession->getPrefixRank(prefix);
+    if(rank < MAX_NICK_PREFIXES)
+        m_prefixBits &= ~(1u << rank);
 }
 
 //-----------------------------------//
 
 // Returns the nickname with the most powerful prefix (if any) prepended to it.
-QString ChannelUser::getProperNickname()
+QString ChannelUser::getProperNickname() const
 {
-    QString name;
-
-    if(!m_prefixes.isEmpty())
-    {
-        name += m_prefixes[0];
-    }
-    name += m_nickname;
+    QChar prefix = getPrefix();
+    if(prefix == '\0')
+        return m_pUser->getNick();
 
-    return name;
+    return prefix + m_pUser->getNick();
 }
 
 //-----------------------------------//
 
 // Returns the nickname with all prefixes (if any) prepended to it.
-QString ChannelUser::getFullNickname()
+QString ChannelUser::getFullNickname() const
 {
     QString name;
-
-    if(!m_prefixes.isEmpty())
+    for(int rank = 0; rank < MAX_NICK_PREFIXES && (m_prefixBits >> rank) != 0; ++rank)
     {
-        name += m_prefixes;
+        if(m_prefixBits & (1u << rank))
+            name += m_pSession->getNickPrefix(rank);
     }
-    name += m_nickname;
+    name += m_pUser->getNick();
 
     return name;
 }
@@ -106,14 +79,29 @@ QString ChannelUser::getFullNickname()
 //-----------------------------------//
 
 // Returns the most powerful prefix of the nickname, or '\0' if there is none.
-QChar ChannelUser::getPrefix()
+QChar ChannelUser::getPrefix() const
 {
-    if(!m_prefixes.isEmpty())
-    {
-        return m_prefixes[0];
-    }
+    if(m_prefixBits == 0)
+        return '\0';
+
+    return m_pSession->getNickPrefix(getPrefixRank());
+}
+
+//-----------------------------------//
+
+// Returns the rank of the most powerful prefix of the nickname, or the
+// number of prefixes the server has if there is none, so that users
+// without a prefix rank after all the others.
+int ChannelUser::getPrefixRank() const
+{
+    if(m_prefixBits == 0)
+        return m_pSession->getPrefixRank('\0');
+
+    int rank = 0;
+    while(!(m_prefixBits & (1u << rank)))
+        ++rank;
 
-    return '\0';
+    return rank;
 }
 
 } // End namespace
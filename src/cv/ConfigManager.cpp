@@ -16,7 +16,7 @@ ConfigManager::ConfigManager(const QString &defaultFilename)
       m_newlineRegex("[\r\n]*"),
       m_defaultFilename(defaultFilename)
 {
-    g_pEvtManager->createEvent("configChanged", STRING_EVENT);
+    g_pEvtManager->createEvent<ConfigEvent>("configChanged", STRING_EVENT);
 }
 
 // This function puts options (and their values) into memory under
@@ -183,9 +183,8 @@ bool ConfigManager::setOptionValue(
                 opt.ensureTypeIsCorrect();
                 if(fireEvent)
                 {
-                    ConfigEvent *pEvent = new ConfigEvent(filename, optName, opt.value, opt.type);
-                    g_pEvtManager->fireEvent("configChanged", optName, pEvent);
-                    delete pEvent;
+                    ConfigEvent evt(filename, optName, opt.value, opt.type);
+                    g_pEvtManager->fireEvent("configChanged", optName, evt);
                 }
                 return true;
             }
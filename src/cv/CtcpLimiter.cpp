@@ -0,0 +1,161 @@
+// Copyright (c) 2011 Conviersa Project. Use of this source code
+// is governed by the MIT License.
+
+#include <QtGlobal>
+#include "cv/CtcpLimiter.h"
+#include "cv/Parser.h"
+
+namespace cv {
+
+// Each source may get this many replies in a row, then one
+// more every SOURCE_REFILL_MSEC milliseconds; the same goes
+// for the requests which are only shown.
+const double SOURCE_CAPACITY = 2;
+const int SOURCE_REFILL_MSEC = 10 * 1000;
+
+// All sources together may get this many replies in a row,
+// then one more every GLOBAL_REFILL_MSEC milliseconds.
+const double GLOBAL_CAPACITY = 5;
+const int GLOBAL_REFILL_MSEC = 2 * 1000;
+
+// The buckets of sources are only pruned once there are this many.
+const int MAX_SOURCE_BUCKETS = 256;
+
+//-----------------------------------//
+
+CtcpLimiter::CtcpLimiter()
+  : m_numDropped(0)
+{
+    m_clock.start();
+    m_globalBucket.tokens = GLOBAL_CAPACITY;
+    m_globalBucket.lastMsec = 0;
+    m_globalDisplayBucket = m_globalBucket;
+}
+
+//-----------------------------------//
+
+// Returns true if the CTCP request of type [type] from [prefix]
+// should be replied to, taking a token for it; otherwise the
+// request is counted as dropped.
+bool CtcpLimiter::allowReply(const QString &prefix, const QString &type)
+{
+    return takeToken(m_sourceBuckets, m_globalBucket, prefix, type);
+}
+
+//-----------------------------------//
+
+// Returns true if the CTCP request of type [type] from [prefix], which
+// doesn't get a reply, should be shown on a line of its own; otherwise
+// the request is counted as dropped.
+bool CtcpLimiter::allowDisplay(const QString &prefix, const QString &type)
+{
+    return takeToken(m_sourceDisplayBuckets, m_globalDisplayBucket, prefix, type);
+}
+
+//-----------------------------------//
+
+// Takes a token for the request from the bucket of its source in
+// [sourceBuckets] and from [globalBucket], if both have one.
+bool CtcpLimiter::takeToken(QHash<QString, TokenBucket> &sourceBuckets, TokenBucket &globalBucket,
+                            const QString &prefix, const QString &type)
+{
+    int now = m_clock.elapsed();
+
+    // Botnets change nicknames easily, so sources are told apart by host.
+    QString source = parseMsgPrefix(prefix, MsgPrefixHost);
+    if(source.isEmpty())
+        source = parseMsgPrefix(prefix, MsgPrefixName);
+    source = foldCase(source);
+
+    QHash<QString, TokenBucket>::iterator it = sourceBuckets.find(source);
+    if(it == sourceBuckets.end())
+    {
+        if(sourceBuckets.size() >= MAX_SOURCE_BUCKETS)
+            pruneSourceBuckets(sourceBuckets, now);
+
+        // If that many sources are still busy, this is a flood,
+        // and there's no point in keeping track of any more.
+        if(sourceBuckets.size() >= MAX_SOURCE_BUCKETS)
+        {
+            addDropped(source, type);
+            return false;
+        }
+
+        TokenBucket bucket;
+        bucket.tokens = SOURCE_CAPACITY;
+        bucket.lastMsec = now;
+        it = sourceBuckets.insert(source, bucket);
+    }
+
+    refill(*it, SOURCE_CAPACITY, SOURCE_REFILL_MSEC, now);
+    refill(globalBucket, GLOBAL_CAPACITY, GLOBAL_REFILL_MSEC, now);
+    if(it->tokens >= 1 && globalBucket.tokens >= 1)
+    {
+        it->tokens -= 1;
+        globalBucket.tokens -= 1;
+        return true;
+    }
+
+    addDropped(source, type);
+    return false;
+}
+
+//-----------------------------------//
+
+void CtcpLimiter::addDropped(const QString &source, const QString &type)
+{
+    ++m_numDropped;
+    m_droppedSources.insert(source);
+    m_droppedTypes.insert(type);
+}
+
+//-----------------------------------//
+
+// Returns the number of requests dropped since the last call, and
+// sets [numSources] and [types] to how many sources they came from
+// and which types they were; the counts then start over.
+int CtcpLimiter::takeDropped(int &numSources, QStringList &types)
+{
+    int numDropped = m_numDropped;
+    numSources = m_droppedSources.size();
+    types = m_droppedTypes.toList();
+    types.sort();
+
+    m_numDropped = 0;
+    m_droppedSources.clear();
+    m_droppedTypes.clear();
+    return numDropped;
+}
+
+//-----------------------------------//
+
+// Adds the tokens [bucket] has earned since it was last refilled.
+void CtcpLimiter::refill(TokenBucket &bucket, double capacity, int refillMsec, int now)
+{
+    // QTime wraps around after a day, so just fill it up then.
+    int elapsed = now - bucket.lastMsec;
+    if(elapsed < 0)
+        bucket.tokens = capacity;
+    else
+        bucket.tokens = qMin(capacity, bucket.tokens + (double) elapsed / refillMsec);
+    bucket.lastMsec = now;
+}
+
+//-----------------------------------//
+
+// Removes the buckets of sources which have filled back up, since
+// they're no different from the bucket a new source would get.
+void CtcpLimiter::pruneSourceBuckets(QHash<QString, TokenBucket> &sourceBuckets, int now)
+{
+    QHash<QString, TokenBucket>::iterator it = sourceBuckets.begin();
+    while(it != sourceBuckets.end())
+    {
+        refill(*it, SOURCE_CAPACITY, SOURCE_REFILL_MSEC, now);
+        if(it->tokens >= SOURCE_CAPACITY)
+            it = sourceBuckets.erase(it);
+        else
+            ++it;
+    }
+}
+
+} // End namespace
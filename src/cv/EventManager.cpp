@@ -2,22 +2,65 @@
 // is governed by the MIT License.
 
 #include <QObject>
+#include <QCoreApplication>
 #include "cv/EventManager.h"
 
 namespace cv {
 
+// Wakes up a thread's EventDispatcher to deliver its queued events.
+static const QEvent::Type s_dispatchEventType = (QEvent::Type) QEvent::registerEventType();
+
+//-----------------------------------//
+
+void EventDispatcher::customEvent(QEvent *pEvent)
+{
+    if(pEvent->type() == s_dispatchEventType)
+        m_pEvtManager->dispatchQueuedEvents();
+}
+
+//-----------------------------------//
+
+EventManager::EventManager()
+  : m_nextSerial(1),
+    m_pProfiler(NULL)
+{ }
+
+//-----------------------------------//
+
 EventManager::~EventManager()
 {
-    // Check the instance events.
-    QHash<QString, QHash<uintptr_t, EventInfo> >::iterator iIter = m_instanceEvents.begin();
     QString instanceEventStr;
-    while(iIter != m_instanceEvents.end())
+    QString stringEventStr;
+    for(int i = 0; i < m_events.size(); ++i)
     {
-        if(!iIter.value().isEmpty())
-            instanceEventStr += iIter.key() + ", ";
-        ++iIter;
+        EventTable *pTable = m_events[i];
+        bool isHooked = hasCallbacks(&pTable->global)
+                        || hasCallbacks(&pTable->preHooks)
+                        || hasCallbacks(&pTable->postHooks);
+        if(pTable->type == INSTANCE_EVENT)
+        {
+            QHash<uintptr_t, EventInfo *>::const_iterator iter = pTable->instances.constBegin();
+            for(; !isHooked && iter != pTable->instances.constEnd(); ++iter)
+                isHooked = hasCallbacks(*iter);
+            QHash<EventTarget, EventInfo *>::const_iterator targetIter = pTable->targets.constBegin();
+            for(; !isHooked && targetIter != pTable->targets.constEnd(); ++targetIter)
+                isHooked = hasCallbacks(*targetIter);
+            if(isHooked)
+                instanceEventStr += pTable->name + ", ";
+        }
+        else if(pTable->type == STRING_EVENT)
+        {
+            QHash<QString, EventInfo *>::const_iterator iter = pTable->strings.constBegin();
+            for(; !isHooked && iter != pTable->strings.constEnd(); ++iter)
+                isHooked = hasCallbacks(*iter);
+            if(isHooked)
+                stringEventStr += pTable->name + ", ";
+        }
+
+        delete pTable;
     }
 
+    // Check the instance events.
     if(!instanceEventStr.isEmpty())
     {
         instanceEventStr.remove(instanceEventStr.length() - 2, 2);
@@ -25,185 +68,411 @@ EventManager::~EventManager()
     }
 
     // Check the string events.
-    QHash<QString, QHash<QString, EventInfo> >::iterator sIter = m_stringEvents.begin();
-    QString stringEventStr;
-    while(sIter != m_stringEvents.end())
-    {
-        if(!sIter.value().isEmpty())
-            stringEventStr += sIter.key() + ", ";
-        ++sIter;
-    }
-
     if(!stringEventStr.isEmpty())
     {
         stringEventStr.remove(stringEventStr.length() - 2, 2);
         qDebug("[EM::~EM] String events still hooked: %s", stringEventStr.toLatin1().constData());
     }
+
+    // Any events that haven't been delivered yet are dropped.
+    QHash<QThread *, EventThreadQueue *>::const_iterator queueIter = m_threadQueues.constBegin();
+    for(; queueIter != m_threadQueues.constEnd(); ++queueIter)
+    {
+        qDeleteAll((*queueIter)->queuedEvts);
+        delete (*queueIter)->pDispatcher;
+        delete *queueIter;
+    }
 }
 
 //-----------------------------------//
 
-void EventManager::createEvent(const QString &evtName, EventType type/* = INSTANCE_EVENT*/)
+// Returns the ID of the event [evtName], or INVALID_EVENT_ID
+// if it hasn't been created.
+int EventManager::getEventId(const QString &evtName) const
 {
-    if(type == INSTANCE_EVENT)
-    {
-        if(m_instanceEvents.find(evtName) == m_instanceEvents.end())
-        {
-            QHash<uintptr_t, EventInfo> instancesHash;
-            m_instanceEvents.insert(evtName, instancesHash);
-        }
-    }
-    else if(type == STRING_EVENT)
+    QMutexLocker locker(&m_mutex);
+    return m_eventIds.value(evtName, INVALID_EVENT_ID);
+}
+
+//-----------------------------------//
+
+QString EventManager::getEventName(int evtId) const
+{
+    QMutexLocker locker(&m_mutex);
+    if(evtId < 0 || evtId >= m_events.size())
+        return QString("#%1").arg(evtId);
+
+    return m_events[evtId]->name;
+}
+
+//-----------------------------------//
+
+void EventManager::setProfiling(bool enabled)
+{
+    QMutexLocker locker(&m_mutex);
+    m_pProfiler = (enabled ? &m_profiler : NULL);
+}
+
+//-----------------------------------//
+
+bool EventManager::isProfiling() const
+{
+    QMutexLocker locker(&m_mutex);
+    return (m_pProfiler != NULL);
+}
+
+//-----------------------------------//
+
+EventProfiler EventManager::getProfiler() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_profiler;
+}
+
+//-----------------------------------//
+
+void EventManager::clearProfiler()
+{
+    QMutexLocker locker(&m_mutex);
+    m_profiler.clear();
+}
+
+//-----------------------------------//
+
+// Unhooks the callback referred to by [handle], and invalidates it.
+// Nothing happens if the callback has already been unhooked.
+void EventManager::unhookEvent(EventHandle &handle)
+{
+    QMutexLocker locker(&m_mutex);
+    if(handle.m_slot >= 0 && handle.m_slot < m_slots.size()
+        && m_slots[handle.m_slot].serial == handle.m_serial)
     {
-        if(m_stringEvents.find(evtName) == m_stringEvents.end())
-        {
-            QHash<QString, EventInfo> stringsHash;
-            m_stringEvents.insert(evtName, stringsHash);
-        }
+        EventSlotOwner owner = m_slots[handle.m_slot].owner;
+        releaseSlot(handle.m_slot);
+        removeOwnerIfEmpty(owner);
     }
+
+    handle = EventHandle();
 }
 
 //-----------------------------------//
 
-// Attaches a [callback] function to the global [type] event [evtName].
-void EventManager::hookGlobalEvent(const QString &evtName, EventType type, EventCallback callback)
+// Unhooks every callback in [handles], and clears the list.
+void EventManager::unhookEvents(EventHandleList &handles)
 {
-    // Global events are represented in the hashes of their respective types
-    // by a 0 for the pointer type and an empty string for the string type.
-    if(type == INSTANCE_EVENT)
-        hookEvent(evtName, (void *) 0, callback);
-    else if(type == STRING_EVENT)
-        hookEvent(evtName, QObject::tr(""), callback);
+    for(int i = 0; i < handles.size(); ++i)
+        unhookEvent(handles[i]);
+    handles.clear();
 }
 
 //-----------------------------------//
 
-// Attaches a [callback] function to the event [evtName] for the instance [pEvtInstance].
-void EventManager::hookEvent(const QString &evtName, void *pEvtInstance, EventCallback callback)
+// Unhooks every callback attached to an event for the instance [pEvtInstance].
+void EventManager::unhookAllEvents(void *pEvtInstance)
 {
-    QHash<uintptr_t, EventInfo> *pEventsHash = getInstancesHash(evtName);
-    EM_DEBUG_CHECK(pEventsHash, "hook", evtName.toLatin1().constData(), "instance", "doesn't exist")
+    QMutexLocker locker(&m_mutex);
+    unhookAllEvents(&m_instanceEventIds, (uintptr_t) pEvtInstance);
+
+    // This goes through the targets of every instance, but it's
+    // only done when an instance (like a Session) is destroyed.
+    QList<EventTarget> targets;
+    QHash<EventTarget, QList<int> >::const_iterator iter = m_targetEventIds.constBegin();
+    for(; iter != m_targetEventIds.constEnd(); ++iter)
+        if(iter.key().instance == (uintptr_t) pEvtInstance)
+            targets.append(iter.key());
+
+    for(int i = 0; i < targets.size(); ++i)
+        unhookAllEvents(&m_targetEventIds, targets[i]);
+}
 
-    hookEvent(pEventsHash, (uintptr_t) pEvtInstance, callback);
+//-----------------------------------//
+
+// Unhooks every callback attached to an event for the string [evtString].
+void EventManager::unhookAllEvents(const QString &evtString)
+{
+    QMutexLocker locker(&m_mutex);
+    unhookAllEvents(&m_stringEventIds, evtString);
 }
 
 //-----------------------------------//
 
-// Attaches a [callback] function to the event [evtName] for the string [evtString].
-void EventManager::hookEvent(const QString &evtName, const QString &evtString, EventCallback callback)
+// Registers the event [evtName], and returns its ID. If the event
+// already exists, then the existing ID is returned.
+int EventManager::createEvent(const QString &evtName, EventType type, EventTypeTag typeTag)
 {
-    QHash<QString, EventInfo> *pEventsHash = getStringsHash(evtName);
-    EM_DEBUG_CHECK(pEventsHash, "hook", evtName.toLatin1().constData(), "string", "doesn't exist")
+    QMutexLocker locker(&m_mutex);
+    QHash<QString, int>::const_iterator idIter = m_eventIds.constFind(evtName);
+    if(idIter != m_eventIds.constEnd())
+    {
+        EventTable *pTable = m_events[*idIter];
+        if(pTable->type != type || pTable->typeTag != typeTag)
+        {
+            qDebug("[EM::createEvent] Event \"%s\" already exists with a different type", evtName.toLatin1().constData());
+            return INVALID_EVENT_ID;
+        }
 
-    hookEvent(pEventsHash, evtString, callback);
+        return *idIter;
+    }
+
+    int evtId = m_events.size();
+    m_events.append(new EventTable(evtName, type, typeTag));
+    m_eventIds.insert(evtName, evtId);
+    return evtId;
 }
 
 //-----------------------------------//
 
-void EventManager::fireEvent(const QString &evtName, void *pEvtInstance, Event *pEvent)
+// Returns the ID of the event [evtName]. If it doesn't exist, then
+// it prints a message using qDebug() and returns INVALID_EVENT_ID.
+int EventManager::lookupEventId(const char *func, const QString &evtName) const
 {
-    QHash<uintptr_t, EventInfo> *pEventsHash = getInstancesHash(evtName);
-    EM_DEBUG_CHECK(pEventsHash, "fire", evtName.toLatin1().constData(), "instance", "doesn't exist")
+    int evtId = getEventId(evtName);
+    if(evtId == INVALID_EVENT_ID)
+        qDebug("[EM::%sEvent] Attempted to %s event \"%s\" which doesn't exist", func, func, evtName.toLatin1().constData());
 
-    fireEvent(pEventsHash, (uintptr_t) pEvtInstance, pEvent);
-
-    // Fire the global event.
-    fireEvent(pEventsHash, (uintptr_t) 0, pEvent);
+    return evtId;
 }
 
 //-----------------------------------//
 
-void EventManager::fireEvent(const QString &evtName, const QString &evtString, Event *pEvent)
+// Returns the event [evtId] if it passes the type identified by
+// [typeTag], NULL otherwise.
+EventTable *EventManager::getEventTable(const char *func, int evtId, EventTypeTag typeTag)
 {
-    QHash<QString, EventInfo> *pEventsHash = getStringsHash(evtName);
-    EM_DEBUG_CHECK(pEventsHash, "fire", evtName.toLatin1().constData(), "string", "doesn't exist")
+    // An invalid ID has already been reported where it came from.
+    if(evtId == INVALID_EVENT_ID)
+        return NULL;
 
-    fireEvent(pEventsHash, evtString, pEvent);
+    if(evtId < 0 || evtId >= m_events.size())
+    {
+        qDebug("[EM::%sEvent] Attempted to %s event %d which doesn't exist", func, func, evtId);
+        return NULL;
+    }
+
+    EventTable *pTable = m_events[evtId];
+    if(pTable->typeTag != typeTag)
+    {
+        qDebug("[EM::%sEvent] Attempted to %s event \"%s\" with the wrong type", func, func, pTable->name.toLatin1().constData());
+        return NULL;
+    }
 
-    // Fire the global event.
-    fireEvent(pEventsHash, QObject::tr(""), pEvent);
+    return pTable;
 }
 
 //-----------------------------------//
 
-void EventManager::unhookGlobalEvent(const QString &evtName, EventType type, EventCallback callback)
+// Returns the event [evtId] if it is a [type] event which passes the
+// type identified by [typeTag], NULL otherwise.
+EventTable *EventManager::getEventTable(const char *func, int evtId, EventType type, EventTypeTag typeTag)
 {
-    if(type == INSTANCE_EVENT)
-        unhookEvent(evtName, (void *) 0, callback);
-    else if(type == STRING_EVENT)
-        unhookEvent(evtName, QObject::tr(""), callback);
+    EventTable *pTable = getEventTable(func, evtId, typeTag);
+    if(pTable != NULL && pTable->type != type)
+    {
+        qDebug("[EM::%sEvent] Attempted to %s %s event \"%s\" which isn't one", func, func,
+               (type == INSTANCE_EVENT) ? "instance" : "string", pTable->name.toLatin1().constData());
+        return NULL;
+    }
+
+    return pTable;
 }
 
 //-----------------------------------//
 
-void EventManager::unhookEvent(const QString &evtName, void *pEvtInstance, EventCallback callback)
+// Stores [callback] in a free slot and adds it to [pEvtInfo], which
+// belongs to [owner].
+EventHandle EventManager::addCallback(EventInfo *pEvtInfo, const DelegateMemento &callback,
+                                      bool returnsResult, int priority,
+                                      const EventSlotOwner &owner/* = EventSlotOwner()*/)
 {
-    QHash<uintptr_t, EventInfo> *pEventsHash = getInstancesHash(evtName);
-    EM_DEBUG_CHECK(pEventsHash, "unhook", evtName.toLatin1().constData(), "instance", "doesn't exist")
+    // Clear out unhooked callbacks before the list has to grow, so
+    // that it doesn't keep growing for an event that is never fired.
+    if(pEvtInfo->firingDepth == 0 && pEvtInfo->slotRefs.size() == pEvtInfo->slotRefs.capacity())
+        removeUnhooked(pEvtInfo);
+
+    int slot;
+    if(!m_freeSlots.isEmpty())
+    {
+        slot = m_freeSlots.last();
+        m_freeSlots.pop_back();
+    }
+    else
+    {
+        slot = m_slots.size();
+        m_slots.append(EventSlot());
+    }
+
+    // 0 marks a free slot, so it's skipped when the serial wraps around.
+    quint32 serial = m_nextSerial++;
+    if(m_nextSerial == 0)
+        m_nextSerial = 1;
+
+    QThread *pThread = QThread::currentThread();
+    m_slots[slot].callback = callback;
+    m_slots[slot].serial = serial;
+    m_slots[slot].returnsResult = returnsResult;
+    m_slots[slot].pThread = pThread;
+    m_slots[slot].owner = owner;
+
+    // Events for this thread are delivered through its dispatcher,
+    // which has to be created on the thread itself.
+    if(!m_threadQueues.contains(pThread))
+    {
+        EventThreadQueue *pQueue = new EventThreadQueue;
+        pQueue->pDispatcher = new EventDispatcher(this);
+        m_threadQueues.insert(pThread, pQueue);
+    }
+
+    EventSlotRef slotRef;
+    slotRef.slot = slot;
+    slotRef.serial = serial;
+    slotRef.priority = priority;
+    pEvtInfo->slotRefs.append(slotRef);
 
-    unhookEvent(evtName, pEventsHash, (uintptr_t) pEvtInstance, callback);
+    // It can't be put in order while it's being fired.
+    int numSlotRefs = pEvtInfo->slotRefs.size();
+    if(numSlotRefs > 1 && pEvtInfo->slotRefs[numSlotRefs - 2].priority > priority)
+    {
+        if(pEvtInfo->firingDepth == 0)
+            sortCallbacks(pEvtInfo);
+        else
+            pEvtInfo->needsSort = true;
+    }
+
+    return EventHandle(slot, serial);
 }
 
 //-----------------------------------//
 
-void EventManager::unhookEvent(const QString &evtName, const QString &evtString, EventCallback callback)
+void EventManager::releaseSlot(int slot)
 {
-    QHash<QString, EventInfo> *pEventsHash = getStringsHash(evtName);
-    EM_DEBUG_CHECK(pEventsHash, "unhook", evtName.toLatin1().constData(), "string", "doesn't exist")
+    m_slots[slot].callback = DelegateMemento();
+    m_slots[slot].serial = 0;
+    m_slots[slot].returnsResult = false;
+    m_slots[slot].pThread = NULL;
+    m_slots[slot].owner = EventSlotOwner();
+    m_freeSlots.append(slot);
+}
+
+//-----------------------------------//
 
-    unhookEvent(evtName, pEventsHash, evtString, callback);
+// Removes the EventInfo that [owner] refers to if none of its
+// callbacks are hooked anymore, so that an instance, target or
+// string which is no longer used doesn't leave it behind.
+void EventManager::removeOwnerIfEmpty(const EventSlotOwner &owner)
+{
+    if(owner.keyType == NO_KEY)
+        return;
+
+    EventTable *pTable = m_events[owner.evtId];
+    switch(owner.keyType)
+    {
+        case INSTANCE_KEY:
+            removeEventInfoIfUnhooked(owner.evtId, &pTable->instances, &m_instanceEventIds, owner.instance);
+            break;
+        case TARGET_KEY:
+            removeEventInfoIfUnhooked(owner.evtId, &pTable->targets, &m_targetEventIds,
+                                      EventTarget(owner.instance, owner.str));
+            break;
+        case STRING_KEY:
+            removeEventInfoIfUnhooked(owner.evtId, &pTable->strings, &m_stringEventIds, owner.str);
+            break;
+        default:
+            break;
+    }
 }
 
 //-----------------------------------//
 
-void EventManager::unhookAllEvents(void *pEvtInstance)
+// Adds each event in [queuedEvts] to the queue of its thread, and wakes
+// up the thread if it doesn't already have events waiting.
+void EventManager::postQueuedEvents(const QueuedEventList &queuedEvts)
 {
-    QHash<QString, QHash<uintptr_t, EventInfo> >::iterator iter = m_instanceEvents.begin();
-    while(iter != m_instanceEvents.end())
+    for(int i = 0; i < queuedEvts.size(); ++i)
     {
-        (*iter).remove((uintptr_t) pEvtInstance);
-        ++iter;
+        EventThreadQueue *pQueue = m_threadQueues.value(queuedEvts[i]->pThread, NULL);
+        if(pQueue == NULL)
+        {
+            delete queuedEvts[i];
+            continue;
+        }
+
+        pQueue->queuedEvts.append(queuedEvts[i]);
+        if(pQueue->queuedEvts.size() == 1)
+            QCoreApplication::postEvent(pQueue->pDispatcher, new QEvent(s_dispatchEventType));
     }
 }
 
 //-----------------------------------//
 
-void EventManager::unhookAllEvents(const QString &evtString)
+// Delivers every event that has been queued for the current thread, to
+// the callbacks which are still hooked.
+void EventManager::dispatchQueuedEvents()
 {
-    QHash<QString, QHash<QString, EventInfo> >::iterator iter = m_stringEvents.begin();
-    while(iter != m_stringEvents.end())
+    QMutexLocker locker(&m_mutex);
+    EventThreadQueue *pQueue = m_threadQueues.value(QThread::currentThread(), NULL);
+    if(pQueue == NULL)
+        return;
+
+    QList<QueuedEvent *> queuedEvts = pQueue->queuedEvts;
+    pQueue->queuedEvts.clear();
+
+    for(int i = 0; i < queuedEvts.size(); ++i)
     {
-        (*iter).remove(evtString);
-        ++iter;
+        QueuedEvent *pQueuedEvt = queuedEvts[i];
+        for(int j = 0; j < pQueuedEvt->slotRefs.size(); ++j)
+        {
+            EventSlotRef slotRef = pQueuedEvt->slotRefs[j];
+            const EventSlot &slot = m_slots[slotRef.slot];
+            if(slot.serial != slotRef.serial)
+                continue;
+
+            ProfileTimer timer(m_pProfiler, pQueuedEvt->evtId, slotRef.serial, slot.callback);
+            DelegateMemento callback = slot.callback;
+            bool returnsResult = slot.returnsResult;
+            locker.unlock();
+            pQueuedEvt->execute(callback, returnsResult);
+            locker.relock();
+        }
+
+        delete pQueuedEvt;
     }
 }
 
 //-----------------------------------//
 
-CallbackReturnType EventManager::execPluginCallbacks(Event *, HookType)
+// Puts the callbacks in [pEvtInfo] in order of priority, keeping
+// the order they were hooked in otherwise.
+void EventManager::sortCallbacks(EventInfo *pEvtInfo)
 {
-    // TODO (seand): Implement.
-    return EVENT_CONTINUE;
+    qStableSort(pEvtInfo->slotRefs.data(), pEvtInfo->slotRefs.data() + pEvtInfo->slotRefs.size());
+    pEvtInfo->needsSort = false;
 }
 
 //-----------------------------------//
 
-QHash<uintptr_t, EventInfo> *EventManager::getInstancesHash(const QString &evtName)
+// Removes the callbacks which have been unhooked from [pEvtInfo],
+// keeping the rest in order.
+void EventManager::removeUnhooked(EventInfo *pEvtInfo)
 {
-    QHash<QString, QHash<uintptr_t, EventInfo> >::iterator eventsIter = m_instanceEvents.find(evtName);
-    if(eventsIter != m_instanceEvents.end())
-        return &(*eventsIter);
-    return NULL;
+    int numKept = 0;
+    for(int i = 0; i < pEvtInfo->slotRefs.size(); ++i)
+    {
+        EventSlotRef slotRef = pEvtInfo->slotRefs[i];
+        if(m_slots[slotRef.slot].serial == slotRef.serial)
+            pEvtInfo->slotRefs[numKept++] = slotRef;
+    }
+
+    pEvtInfo->slotRefs.resize(numKept);
+    pEvtInfo->hasUnhooked = false;
 }
 
 //-----------------------------------//
 
-QHash<QString, EventInfo> *EventManager::getStringsHash(const QString &evtName)
+// Returns true if [pEvtInfo] has any callbacks which haven't been unhooked.
+bool EventManager::hasCallbacks(EventInfo *pEvtInfo)
 {
-    QHash<QString, QHash<QString, EventInfo> >::iterator eventsIter = m_stringEvents.find(evtName);
-    if(eventsIter != m_stringEvents.end())
-        return &(*eventsIter);
-    return NULL;
+    removeUnhooked(pEvtInfo);
+    return !pEvtInfo->slotRefs.isEmpty();
 }
 
 } // End namespace
@@ -0,0 +1,194 @@
+// Copyright (c) 2011 Conviersa Project. Use of this source code
+// is governed by the MIT License.
+
+#include <QList>
+#include <QPair>
+#include <QtAlgorithms>
+#include "cv/EventManager.h"
+#include "cv/EventProfiler.h"
+
+namespace cv {
+
+LatencyStats::LatencyStats()
+  : count(0),
+    totalNsecs(0),
+    maxNsecs(0)
+{
+    for(int i = 0; i < NUM_LATENCY_BUCKETS; ++i)
+        buckets[i] = 0;
+}
+
+//-----------------------------------//
+
+// Adds a sample of [nsecs] nanoseconds.
+void LatencyStats::addSample(qint64 nsecs)
+{
+    ++count;
+    totalNsecs += nsecs;
+    if(nsecs > maxNsecs)
+        maxNsecs = nsecs;
+
+    int bucket = 0;
+    for(qint64 usecs = nsecs / 1000; usecs > 0 && bucket < NUM_LATENCY_BUCKETS - 1; usecs >>= 1)
+        ++bucket;
+    ++buckets[bucket];
+}
+
+//-----------------------------------//
+
+// Returns the stats as a map, so that they can be serialized.
+QVariantMap LatencyStats::toVariant() const
+{
+    QVariantList histogram;
+    for(int i = 0; i < NUM_LATENCY_BUCKETS; ++i)
+        histogram.append(buckets[i]);
+
+    QVariantMap map;
+    map["count"] = count;
+    map["totalNsecs"] = totalNsecs;
+    map["maxNsecs"] = maxNsecs;
+    map["histogram"] = histogram;
+    return map;
+}
+
+//-----------------------------------//
+
+// Exposes the object of a DelegateMemento, which is protected.
+class CallbackObjectMemento : public DelegateMemento
+{
+public:
+    CallbackObjectMemento(const DelegateMemento &callback)
+      : DelegateMemento(callback)
+    { }
+
+    const void *getObject() const { return m_pthis; }
+};
+
+const void *getCallbackObject(const DelegateMemento &callback)
+{
+    return CallbackObjectMemento(callback).getObject();
+}
+
+//-----------------------------------//
+
+void EventProfiler::addEventSample(int evtId, qint64 nsecs)
+{
+    m_eventStats[evtId].addSample(nsecs);
+}
+
+//-----------------------------------//
+
+void EventProfiler::addCallbackSample(int evtId, quint32 serial, const void *pObject, qint64 nsecs)
+{
+    CallbackStats &stats = m_callbackStats[evtId][serial];
+    stats.pObject = pObject;
+    stats.latency.addSample(nsecs);
+}
+
+//-----------------------------------//
+
+// Discards every sample.
+void EventProfiler::clear()
+{
+    m_eventStats.clear();
+    m_callbackStats.clear();
+}
+
+//-----------------------------------//
+
+// Formats [stats] as a single line, with latencies in microseconds.
+static QString formatStats(const LatencyStats &stats)
+{
+    QString histogram;
+    for(int i = 0; i < NUM_LATENCY_BUCKETS; ++i)
+    {
+        if(stats.buckets[i] == 0)
+            continue;
+
+        if(!histogram.isEmpty())
+            histogram += ' ';
+        if(i == NUM_LATENCY_BUCKETS - 1)
+            histogram += QString(">=%1us:%2").arg(1 << (i - 1)).arg(stats.buckets[i]);
+        else
+            histogram += QString("<%1us:%2").arg(1 << i).arg(stats.buckets[i]);
+    }
+
+    return QString("%1 calls, %2us total, %3us avg, %4us max [%5]")
+            .arg(stats.count)
+            .arg(stats.totalNsecs / 1000)
+            .arg(stats.totalNsecs / qMax<qint64>(stats.count, 1) / 1000)
+            .arg(stats.maxNsecs / 1000)
+            .arg(histogram);
+}
+
+//-----------------------------------//
+
+// Returns a line for every event that has been fired, ordered by the
+// total time spent firing it, each followed by up to [maxCallbacks]
+// of its slowest callbacks.
+QStringList EventProfiler::getSummary(const EventManager &evtManager, int maxCallbacks) const
+{
+    QList<QPair<qint64, int> > events;
+    QHash<int, LatencyStats>::const_iterator iter = m_eventStats.constBegin();
+    for(; iter != m_eventStats.constEnd(); ++iter)
+        events.append(qMakePair(iter->totalNsecs, iter.key()));
+    qSort(events.begin(), events.end(), qGreater<QPair<qint64, int> >());
+
+    QStringList lines;
+    for(int i = 0; i < events.size(); ++i)
+    {
+        int evtId = events[i].second;
+        lines.append(QString("%1: %2").arg(evtManager.getEventName(evtId))
+                                      .arg(formatStats(m_eventStats.value(evtId))));
+
+        const QHash<quint32, CallbackStats> callbacks = m_callbackStats.value(evtId);
+        QList<QPair<qint64, quint32> > serials;
+        QHash<quint32, CallbackStats>::const_iterator cbIter = callbacks.constBegin();
+        for(; cbIter != callbacks.constEnd(); ++cbIter)
+            serials.append(qMakePair(cbIter->latency.totalNsecs, cbIter.key()));
+        qSort(serials.begin(), serials.end(), qGreater<QPair<qint64, quint32> >());
+
+        for(int j = 0; j < serials.size() && j < maxCallbacks; ++j)
+        {
+            const CallbackStats &stats = callbacks[serials[j].second];
+            lines.append(QString("    callback #%1 (0x%2): %3")
+                         .arg(serials[j].second)
+                         .arg((quintptr) stats.pObject, 0, 16)
+                         .arg(formatStats(stats.latency)));
+        }
+    }
+
+    return lines;
+}
+
+//-----------------------------------//
+
+// Returns every sample as a list of events, so that they can be
+// serialized.
+QVariant EventProfiler::toVariant(const EventManager &evtManager) const
+{
+    QVariantList events;
+    QHash<int, LatencyStats>::const_iterator iter = m_eventStats.constBegin();
+    for(; iter != m_eventStats.constEnd(); ++iter)
+    {
+        QVariantList callbacks;
+        const QHash<quint32, CallbackStats> callbackStats = m_callbackStats.value(iter.key());
+        QHash<quint32, CallbackStats>::const_iterator cbIter = callbackStats.constBegin();
+        for(; cbIter != callbackStats.constEnd(); ++cbIter)
+        {
+            QVariantMap callback = cbIter->latency.toVariant();
+            callback["serial"] = cbIter.key();
+            callback["object"] = QString::number((quintptr) cbIter->pObject, 16);
+            callbacks.append(callback);
+        }
+
+        QVariantMap evt = iter->toVariant();
+        evt["name"] = evtManager.getEventName(iter.key());
+        evt["callbacks"] = callbacks;
+        events.append(evt);
+    }
+
+    return events;
+}
+
+} // End namespace
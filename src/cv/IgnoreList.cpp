@@ -0,0 +1,255 @@
+// Copyright (c) 2011 Conviersa Project. Use of this source code
+// is governed by the MIT License.
+
+#include <QStringList>
+#include <QtAlgorithms>
+#include "cv/IgnoreList.h"
+#include "cv/Mask.h"
+#include "cv/Parser.h"
+
+namespace cv {
+
+// The DFA is rebuilt from scratch once it has this many states,
+// which only happens with a lot of masks full of wildcards.
+const int MAX_DFA_STATES = 4096;
+
+// The DFA state with no NFA states in it, from which
+// nothing can match.
+const int DEAD_DFA_STATE = 0;
+
+//-----------------------------------//
+
+IgnoreList::IgnoreList()
+  : m_startDfaIdx(DEAD_DFA_STATE)
+{
+    compile();
+}
+
+//-----------------------------------//
+
+void IgnoreList::setRules(const QList<IgnoreRule> &rules)
+{
+    m_rules = rules;
+    compile();
+}
+
+//-----------------------------------//
+
+// Returns the types of messages to ignore from [prefix]
+// ("nick!user@host"), combined from every mask it matches.
+int IgnoreList::match(const QString &prefix)
+{
+    int dfaIdx = m_startDfaIdx;
+    for(int i = 0; i < prefix.size() && dfaIdx != DEAD_DFA_STATE; ++i)
+        dfaIdx = step(dfaIdx, foldCaseChar(prefix[i]));
+
+    return m_dfa[dfaIdx].types;
+}
+
+//-----------------------------------//
+
+// Parses a comma-separated list of the types of messages to ignore
+// ("msgs", "notices", "ctcp", "joins" or "all"); an empty list
+// means all of them.
+int IgnoreList::parseTypes(const QString &types)
+{
+    QStringList typeList = types.split(',', QString::SkipEmptyParts);
+    if(typeList.isEmpty())
+        return IgnoreAll;
+
+    int result = 0;
+    for(int i = 0; i < typeList.size(); ++i)
+    {
+        QString type = typeList[i].trimmed().toLower();
+        if(type == "msgs")
+            result |= IgnoreMessages;
+        else if(type == "notices")
+            result |= IgnoreNotices;
+        else if(type == "ctcp")
+            result |= IgnoreCtcp;
+        else if(type == "joins")
+            result |= IgnoreJoins;
+        else if(type == "all")
+            result |= IgnoreAll;
+    }
+
+    return result;
+}
+
+//-----------------------------------//
+
+QString IgnoreList::typesToString(int types)
+{
+    if((types & IgnoreAll) == IgnoreAll)
+        return "all";
+
+    QStringList typeList;
+    if(types & IgnoreMessages)
+        typeList.append("msgs");
+    if(types & IgnoreNotices)
+        typeList.append("notices");
+    if(types & IgnoreCtcp)
+        typeList.append("ctcp");
+    if(types & IgnoreJoins)
+        typeList.append("joins");
+    return typeList.join(",");
+}
+
+//-----------------------------------//
+
+// Builds the NFA for all the masks, one chain of states per mask.
+void IgnoreList::compile()
+{
+    m_nfa.clear();
+    m_startStates.clear();
+    m_maskChars.clear();
+
+    QVector<int> ruleStarts;
+    for(int i = 0; i < m_rules.size(); ++i)
+    {
+        if(m_rules[i].types == 0)
+            continue;
+
+        ruleStarts.append(m_nfa.size());
+
+        // The mask is read in the same way as a Mask.
+        QVector<MaskToken> tokens = Mask::tokenize(Mask::complete(m_rules[i].mask));
+        for(int j = 0; j < tokens.size(); ++j)
+        {
+            NfaState state;
+            state.types = 0;
+            if(tokens[j].kind == MaskTokenAnyOne)
+            {
+                state.kind = NfaStateAnyOne;
+            }
+            else if(tokens[j].kind == MaskTokenAnyMany)
+            {
+                state.kind = NfaStateAnyMany;
+            }
+            else
+            {
+                state.kind = NfaStateChar;
+                state.c = tokens[j].c;
+            }
+
+            if(state.kind == NfaStateChar)
+                m_maskChars.insert(state.c.unicode());
+            m_nfa.append(state);
+        }
+
+        NfaState acceptState;
+        acceptState.kind = NfaStateAccept;
+        acceptState.types = m_rules[i].types;
+        m_nfa.append(acceptState);
+    }
+
+    for(int i = 0; i < ruleStarts.size(); ++i)
+        addClosure(m_startStates, ruleStarts[i]);
+
+    resetDfa();
+}
+
+//-----------------------------------//
+
+void IgnoreList::resetDfa()
+{
+    m_dfa.clear();
+    m_dfaIndex.clear();
+
+    // Make sure the dead state comes first.
+    findDfaState(QVector<int>());
+    m_startDfaIdx = findDfaState(m_startStates);
+}
+
+//-----------------------------------//
+
+// Returns the index of the DFA state made up of [nfaStates],
+// adding it if it doesn't exist yet.
+int IgnoreList::findDfaState(QVector<int> nfaStates)
+{
+    qSort(nfaStates);
+
+    QByteArray key(reinterpret_cast<const char *>(nfaStates.constData()), nfaStates.size() * sizeof(int));
+    QHash<QByteArray, int>::const_iterator it = m_dfaIndex.constFind(key);
+    if(it != m_dfaIndex.constEnd())
+        return *it;
+
+    DfaState dfaState;
+    dfaState.nfaStates = nfaStates;
+    dfaState.types = 0;
+    dfaState.otherTransition = -1;
+    for(int i = 0; i < nfaStates.size(); ++i)
+    {
+        if(m_nfa[nfaStates[i]].kind == NfaStateAccept)
+            dfaState.types |= m_nfa[nfaStates[i]].types;
+    }
+
+    m_dfa.append(dfaState);
+    m_dfaIndex.insert(key, m_dfa.size() - 1);
+    return m_dfa.size() - 1;
+}
+
+//-----------------------------------//
+
+// Returns the DFA state reached from [dfaIdx] with the
+// (case-folded) character [c], building it if necessary.
+int IgnoreList::step(int dfaIdx, QChar c)
+{
+    bool isMaskChar = m_maskChars.contains(c.unicode());
+    if(isMaskChar)
+    {
+        QHash<ushort, int>::const_iterator it = m_dfa[dfaIdx].transitions.constFind(c.unicode());
+        if(it != m_dfa[dfaIdx].transitions.constEnd())
+            return *it;
+    }
+    else if(m_dfa[dfaIdx].otherTransition >= 0)
+    {
+        return m_dfa[dfaIdx].otherTransition;
+    }
+
+    if(m_dfa.size() >= MAX_DFA_STATES)
+    {
+        // Start over, keeping only the state we're in (and the
+        // start state, which resetDfa() adds).
+        QVector<int> nfaStates = m_dfa[dfaIdx].nfaStates;
+        resetDfa();
+        dfaIdx = findDfaState(nfaStates);
+    }
+
+    QVector<int> nextStates;
+    const QVector<int> &nfaStates = m_dfa[dfaIdx].nfaStates;
+    for(int i = 0; i < nfaStates.size(); ++i)
+    {
+        const NfaState &state = m_nfa[nfaStates[i]];
+        if(state.kind == NfaStateAnyMany)
+            addClosure(nextStates, nfaStates[i]);
+        else if(state.kind == NfaStateAnyOne || (state.kind == NfaStateChar && state.c == c))
+            addClosure(nextStates, nfaStates[i] + 1);
+    }
+
+    // [m_dfa] may grow, so look the state up again afterwards.
+    int nextIdx = findDfaState(nextStates);
+    if(isMaskChar)
+        m_dfa[dfaIdx].transitions.insert(c.unicode(), nextIdx);
+    else
+        m_dfa[dfaIdx].otherTransition = nextIdx;
+
+    return nextIdx;
+}
+
+//-----------------------------------//
+
+// Adds [nfaIdx] to [nfaStates], along with the states after any
+// "*"s it starts at, since those can match nothing at all.
+void IgnoreList::addClosure(QVector<int> &nfaStates, int nfaIdx) const
+{
+    while(!nfaStates.contains(nfaIdx))
+    {
+        nfaStates.append(nfaIdx);
+        if(nfaIdx >= m_nfa.size() || m_nfa[nfaIdx].kind != NfaStateAnyMany)
+            break;
+        ++nfaIdx;
+    }
+}
+
+} // End namespace
@@ -0,0 +1,221 @@
+// Copyright (c) 2011 Conviersa Project. Use of this source code
+// is governed by the MIT License.
+
+#include "cv/Mask.h"
+#include "cv/Parser.h"
+
+namespace cv {
+
+Mask::Mask()
+  : m_type(MaskTypeUnsupported),
+    m_minLength(0)
+{ }
+
+//-----------------------------------//
+
+Mask::Mask(const QString &mask)
+  : m_mask(mask),
+    m_type(MaskTypeHost),
+    m_minLength(0)
+{
+    QString pattern = mask;
+    if(pattern.startsWith('$') || pattern.startsWith('~'))
+    {
+        // "$a" alone matches anyone who is logged in.
+        if(pattern.mid(1, 1).compare("a", Qt::CaseInsensitive) != 0
+            || (pattern.size() > 2 && pattern[2] != ':'))
+        {
+            m_type = MaskTypeUnsupported;
+            return;
+        }
+
+        m_type = MaskTypeAccount;
+        pattern = (pattern.size() > 2) ? pattern.mid(3) : QString("?*");
+    }
+    else
+    {
+        pattern = complete(pattern);
+    }
+
+    compile(tokenize(pattern));
+}
+
+//-----------------------------------//
+
+// Returns [mask] completed to "nick!user@host" the way servers do,
+// so that "nick" becomes "nick!*@*" and "user@host" becomes
+// "*!user@host".
+QString Mask::complete(const QString &mask)
+{
+    if(!mask.contains('!'))
+    {
+        if(!mask.contains('@'))
+            return mask + "!*@*";
+        return "*!" + mask;
+    }
+    else if(!mask.contains('@'))
+    {
+        return mask + "@*";
+    }
+
+    return mask;
+}
+
+//-----------------------------------//
+
+// Reads [mask] one character at a time, turning escaped wildcards
+// into the characters themselves and case-folding the rest. This is
+// shared with IgnoreList, so that both read masks in the same way.
+QVector<MaskToken> Mask::tokenize(const QString &mask)
+{
+    QVector<MaskToken> tokens;
+    tokens.reserve(mask.size());
+    for(int i = 0; i < mask.size(); ++i)
+    {
+        MaskToken token;
+        QChar c = mask[i];
+        if(c == '\\' && i + 1 < mask.size() && (mask[i+1] == '*' || mask[i+1] == '?'))
+        {
+            token.kind = MaskTokenChar;
+            token.c = mask[++i];
+        }
+        else if(c == '?')
+        {
+            token.kind = MaskTokenAnyOne;
+        }
+        else if(c == '*')
+        {
+            token.kind = MaskTokenAnyMany;
+        }
+        else
+        {
+            token.kind = MaskTokenChar;
+            token.c = foldCaseChar(c);
+        }
+        tokens.append(token);
+    }
+
+    return tokens;
+}
+
+//-----------------------------------//
+
+bool Mask::matches(const QString &hostmask, const QString &account) const
+{
+    switch(m_type)
+    {
+        case MaskTypeHost:
+            return matches(hostmask);
+        case MaskTypeAccount:
+            return matches(account);
+        default:
+            return false;
+    }
+}
+
+//-----------------------------------//
+
+// Returns true if the whole of [str], which must already be
+// case-folded, is matched by the mask.
+bool Mask::matches(const QString &str) const
+{
+    if(m_pieces.isEmpty() || str.size() < m_minLength)
+        return false;
+
+    // Without any "*", the mask has to match the string exactly.
+    const MaskPiece &first = m_pieces.first();
+    if(m_pieces.size() == 1)
+        return (str.size() == first.text.size() && matchesAt(str, 0, first));
+
+    const MaskPiece &last = m_pieces.last();
+    int end = str.size() - last.text.size();
+    if(!matchesAt(str, 0, first) || !matchesAt(str, end, last))
+        return false;
+
+    // Each piece in between matches as early as it can,
+    // leaving the most room for the ones after it.
+    int pos = first.text.size();
+    for(int i = 1; i < m_pieces.size() - 1; ++i)
+    {
+        pos = indexOf(str, pos, end, m_pieces[i]);
+        if(pos < 0)
+            return false;
+        pos += m_pieces[i].text.size();
+    }
+
+    return true;
+}
+
+//-----------------------------------//
+
+// Splits [tokens] into the pieces between each "*".
+void Mask::compile(const QVector<MaskToken> &tokens)
+{
+    MaskPiece piece;
+    piece.hasWildOne = false;
+    for(int i = 0; i < tokens.size(); ++i)
+    {
+        if(tokens[i].kind == MaskTokenAnyOne)
+        {
+            piece.text += QChar('\0');
+            piece.hasWildOne = true;
+        }
+        else if(tokens[i].kind == MaskTokenAnyMany)
+        {
+            m_minLength += piece.text.size();
+            m_pieces.append(piece);
+            piece.text.clear();
+            piece.hasWildOne = false;
+        }
+        else
+        {
+            piece.text += tokens[i].c;
+        }
+    }
+
+    m_minLength += piece.text.size();
+    m_pieces.append(piece);
+}
+
+//-----------------------------------//
+
+// Returns true if [piece] matches [str] starting at [pos].
+bool Mask::matchesAt(const QString &str, int pos, const MaskPiece &piece)
+{
+    if(!piece.hasWildOne)
+        return (QStringRef(&str, pos, piece.text.size()) == piece.text);
+
+    const QChar *pStr = str.constData() + pos;
+    const QChar *pPiece = piece.text.constData();
+    for(int i = 0; i < piece.text.size(); ++i)
+    {
+        if(pPiece[i] != QChar('\0') && pPiece[i] != pStr[i])
+            return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------//
+
+// Returns the first position in [from, to] at which [piece]
+// matches [str], or -1 if there is none.
+int Mask::indexOf(const QString &str, int from, int to, const MaskPiece &piece)
+{
+    to -= piece.text.size();
+    if(!piece.hasWildOne)
+    {
+        int idx = str.indexOf(piece.text, from);
+        return (idx >= 0 && idx <= to) ? idx : -1;
+    }
+
+    for(int pos = from; pos <= to; ++pos)
+    {
+        if(matchesAt(str, pos, piece))
+            return pos;
+    }
+
+    return -1;
+}
+
+} // End namespace
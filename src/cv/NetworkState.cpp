@@ -0,0 +1,403 @@
+// Copyright (c) 2011 Conviersa Project. Use of this source code
+// is governed by the MIT License.
+
+#include <QDateTime>
+#include <QVector>
+#include <QtAlgorithms>
+#include <QtGlobal>
+#include "cv/NetworkState.h"
+#include "cv/ChannelUser.h"
+#include "cv/Parser.h"
+#include "cv/Session.h"
+
+namespace cv {
+
+NetworkState::NetworkState(Session *pSession)
+  : m_pSession(pSession)
+{ }
+
+//-----------------------------------//
+
+NetworkState::~NetworkState()
+{
+    clear();
+}
+
+//-----------------------------------//
+
+// Returns the user with the nickname [nick], or NULL if
+// we don't share any channels with the user.
+IrcUser *NetworkState::findUser(const QString &nick) const
+{
+    return m_users.value(foldCase(nick), NULL);
+}
+
+//-----------------------------------//
+
+// Returns the channel called [name], or NULL if we aren't in it.
+IrcChannel *NetworkState::findChannel(const QString &name) const
+{
+    return m_channels.value(foldCase(name), NULL);
+}
+
+//-----------------------------------//
+
+// Returns the membership of the user with the nickname [nick] in
+// [channel], or NULL if either doesn't exist.
+ChannelUser *NetworkState::findMember(const QString &channel, const QString &nick) const
+{
+    IrcChannel *pChannel = findChannel(channel);
+    if(pChannel == NULL)
+        return NULL;
+
+    IrcUser *pUser = findUser(nick);
+    if(pUser == NULL)
+        return NULL;
+
+    return pChannel->getMember(pUser);
+}
+
+//-----------------------------------//
+
+QString NetworkState::parseNick(const QString &name) const
+{
+    QString nick = name.section('!', 0, 0);
+
+    int numPrefixes = 0;
+    while(numPrefixes < nick.size() && m_pSession->isNickPrefix(nick[numPrefixes]))
+        ++numPrefixes;
+
+    return nick.mid(numPrefixes);
+}
+
+//-----------------------------------//
+
+// Adds the channel called [name], unless it's already there.
+IrcChannel *NetworkState::addChannel(const QString &name)
+{
+    QString key = foldCase(name);
+    IrcChannel *pChannel = m_channels.value(key, NULL);
+    if(pChannel == NULL)
+    {
+        pChannel = new IrcChannel(name);
+        m_channels.insert(key, pChannel);
+    }
+
+    return pChannel;
+}
+
+//-----------------------------------//
+
+// Removes the channel called [name] along with all its memberships;
+// users who are then in no other channel are removed as well.
+void NetworkState::removeChannel(const QString &name)
+{
+    IrcChannel *pChannel = m_channels.take(foldCase(name));
+    if(pChannel == NULL)
+        return;
+
+    while(!pChannel->m_members.isEmpty())
+        removeMember(pChannel, pChannel->m_members.begin().key());
+
+    delete pChannel;
+}
+
+//-----------------------------------//
+
+// Adds a user to [channel]. [name] holds the nickname, and can include
+// any number of prefixes, as well as the user and host. If the user is
+// already in the channel, the prefixes are added to the existing
+// membership instead.
+//
+// Returns the membership, or NULL if we aren't in [channel].
+ChannelUser *NetworkState::addMember(const QString &channel, const QString &name)
+{
+    IrcChannel *pChannel = findChannel(channel);
+    if(pChannel == NULL)
+    {
+        qDebug("[NS::addMember] Channel %s is not in the network state", channel.toLatin1().constData());
+        return NULL;
+    }
+
+    QString nick = parseNick(name);
+    if(nick.isEmpty())
+        return NULL;
+    QString prefixes = name.left(name.section('!', 0, 0).size() - nick.size());
+
+    QString key = foldCase(nick);
+    IrcUser *pUser = m_users.value(key, NULL);
+    if(pUser == NULL)
+    {
+        pUser = new IrcUser(nick);
+        m_users.insert(key, pUser);
+    }
+
+    // Fill in the user and host, if we've been given them.
+    if(name.indexOf('!') >= 0)
+    {
+        QString userAndHost = name.section('!', 1);
+        pUser->m_user = userAndHost.section('@', 0, 0);
+        pUser->m_host = userAndHost.section('@', 1);
+    }
+
+    ChannelUser *pMember = pChannel->m_members.value(pUser, NULL);
+    if(pMember != NULL)
+    {
+        for(int i = 0; i < prefixes.size(); ++i)
+            pMember->addPrefix(prefixes[i]);
+        return pMember;
+    }
+
+    pMember = new ChannelUser(m_pSession, pUser, prefixes);
+    pChannel->m_members.insert(pUser, pMember);
+    pUser->m_channels.append(pChannel);
+    return pMember;
+}
+
+//-----------------------------------//
+
+// Removes the user with the nickname [nick] from [channel].
+void NetworkState::removeMember(const QString &channel, const QString &nick)
+{
+    IrcChannel *pChannel = findChannel(channel);
+    IrcUser *pUser = findUser(nick);
+    if(pChannel == NULL || pUser == NULL)
+        return;
+
+    removeMember(pChannel, pUser);
+}
+
+//-----------------------------------//
+
+// Removes the user with the nickname [nick] from every channel.
+void NetworkState::removeUser(const QString &nick)
+{
+    IrcUser *pUser = findUser(nick);
+    if(pUser == NULL)
+        return;
+
+    // The user is deleted along with its last membership,
+    // so iterate over a copy of its channels.
+    QList<IrcChannel *> channels = pUser->m_channels;
+    for(int i = 0; i < channels.size(); ++i)
+        removeMember(channels[i], pUser);
+}
+
+//-----------------------------------//
+
+// Changes the nickname of the user from [oldNick] to [newNick]; every
+// membership of the user sees the change.
+void NetworkState::renameUser(const QString &oldNick, const QString &newNick)
+{
+    IrcUser *pUser = m_users.take(foldCase(oldNick));
+    if(pUser == NULL)
+        return;
+
+    // Anyone we still have under the new nickname must have left
+    // without us seeing it, so they're removed from their channels
+    // before the nickname is taken over.
+    removeUser(newNick);
+
+    pUser->m_nick = newNick;
+    m_users.insert(foldCase(newNick), pUser);
+}
+
+//-----------------------------------//
+
+void NetworkState::setUserHost(const QString &nick, const QString &user, const QString &host)
+{
+    IrcUser *pUser = findUser(nick);
+    if(pUser != NULL)
+    {
+        pUser->m_user = user;
+        pUser->m_host = host;
+    }
+}
+
+//-----------------------------------//
+
+void NetworkState::setUserAway(const QString &nick, bool isAway)
+{
+    IrcUser *pUser = findUser(nick);
+    if(pUser != NULL)
+        pUser->m_isAway = isAway;
+}
+
+//-----------------------------------//
+
+void NetworkState::setUserAccount(const QString &nick, const QString &account)
+{
+    IrcUser *pUser = findUser(nick);
+    if(pUser != NULL)
+        pUser->m_account = account;
+}
+
+//-----------------------------------//
+
+// Removes all channels and users, such as when disconnected.
+void NetworkState::clear()
+{
+    QHash<QString, IrcChannel *>::iterator chanIt = m_channels.begin();
+    for(; chanIt != m_channels.end(); ++chanIt)
+    {
+        qDeleteAll((*chanIt)->m_members);
+        delete *chanIt;
+    }
+    m_channels.clear();
+
+    qDeleteAll(m_users);
+    m_users.clear();
+}
+
+//-----------------------------------//
+
+// Adds an entry from the server's reply to a list request to the
+// list being received for [channel].
+void NetworkState::addListEntry(const QString &channel, ChannelListType type, const QString &mask,
+                                const QString &setBy/* = QString()*/, uint setAt/* = 0*/)
+{
+    IrcChannel *pChannel = findChannel(channel);
+    if(pChannel == NULL)
+        return;
+
+    ChannelListEntry entry;
+    entry.mask = Mask(mask);
+    entry.setBy = setBy;
+    entry.setAt = setAt;
+    pChannel->m_pendingLists[type].append(entry);
+}
+
+//-----------------------------------//
+
+// Replaces the cached list of [channel] with the one just received.
+void NetworkState::endList(const QString &channel, ChannelListType type)
+{
+    IrcChannel *pChannel = findChannel(channel);
+    if(pChannel == NULL)
+        return;
+
+    pChannel->m_lists[type] = pChannel->m_pendingLists[type];
+    pChannel->m_pendingLists[type].clear();
+    pChannel->m_hasList[type] = true;
+}
+
+//-----------------------------------//
+
+// Adds [mask] to the cached list of [channel], if there is one,
+// after it has been set with MODE.
+void NetworkState::addMask(const QString &channel, ChannelListType type, const QString &mask, const QString &setBy)
+{
+    IrcChannel *pChannel = findChannel(channel);
+    if(pChannel == NULL || !pChannel->m_hasList[type])
+        return;
+
+    ChannelListEntry entry;
+    entry.mask = Mask(mask);
+    entry.setBy = setBy;
+    entry.setAt = QDateTime::currentDateTime().toTime_t();
+    pChannel->m_lists[type].append(entry);
+}
+
+//-----------------------------------//
+
+// Removes [mask] from the cached list of [channel], if there is one,
+// after it has been unset with MODE.
+void NetworkState::removeMask(const QString &channel, ChannelListType type, const QString &mask)
+{
+    IrcChannel *pChannel = findChannel(channel);
+    if(pChannel == NULL || !pChannel->m_hasList[type])
+        return;
+
+    QString foldedMask = foldCase(mask);
+    QList<ChannelListEntry> &list = pChannel->m_lists[type];
+    for(int i = 0; i < list.size(); ++i)
+    {
+        if(foldCase(list[i].mask.getMask()) == foldedMask)
+        {
+            list.removeAt(i);
+            return;
+        }
+    }
+}
+
+//-----------------------------------//
+
+// Returns the members of [channel] who are matched by [mask].
+QList<ChannelUser *> NetworkState::findMatchingMembers(const QString &channel, const Mask &mask) const
+{
+    QList<ChannelUser *> matches;
+    IrcChannel *pChannel = findChannel(channel);
+    if(pChannel == NULL)
+        return matches;
+
+    QHash<IrcUser *, ChannelUser *>::const_iterator it = pChannel->m_members.constBegin();
+    for(; it != pChannel->m_members.constEnd(); ++it)
+    {
+        IrcUser *pUser = it.key();
+        QString hostmask = foldCase(pUser->m_nick + '!' + pUser->m_user + '@' + pUser->m_host);
+        if(mask.matches(hostmask, foldCase(pUser->m_account)))
+            matches.append(it.value());
+    }
+
+    return matches;
+}
+
+//-----------------------------------//
+
+// Returns the number of members of [channel] matched by each entry in
+// its cached list of type [type], in the same order as the list.
+QList<int> NetworkState::countMatchingMembers(const QString &channel, ChannelListType type) const
+{
+    QList<int> counts;
+    IrcChannel *pChannel = findChannel(channel);
+    if(pChannel == NULL)
+        return counts;
+
+    // Fold each member's hostmask once, rather than once per mask.
+    QVector<QString> hostmasks;
+    QVector<QString> accounts;
+    hostmasks.reserve(pChannel->m_members.size());
+    accounts.reserve(pChannel->m_members.size());
+    QHash<IrcUser *, ChannelUser *>::const_iterator it = pChannel->m_members.constBegin();
+    for(; it != pChannel->m_members.constEnd(); ++it)
+    {
+        IrcUser *pUser = it.key();
+        hostmasks.append(foldCase(pUser->m_nick + '!' + pUser->m_user + '@' + pUser->m_host));
+        accounts.append(foldCase(pUser->m_account));
+    }
+
+    const QList<ChannelListEntry> &list = pChannel->m_lists[type];
+    for(int i = 0; i < list.size(); ++i)
+    {
+        int count = 0;
+        for(int j = 0; j < hostmasks.size(); ++j)
+        {
+            if(list[i].mask.matches(hostmasks[j], accounts[j]))
+                ++count;
+        }
+        counts.append(count);
+    }
+
+    return counts;
+}
+
+//-----------------------------------//
+
+// Removes the membership of [pUser] in [pChannel], and the user
+// itself if that was the last channel we shared with it.
+void NetworkState::removeMember(IrcChannel *pChannel, IrcUser *pUser)
+{
+    ChannelUser *pMember = pChannel->m_members.take(pUser);
+    if(pMember == NULL)
+        return;
+
+    delete pMember;
+    pUser->m_channels.removeOne(pChannel);
+    if(pUser->m_channels.isEmpty())
+    {
+        m_users.remove(foldCase(pUser->m_nick));
+        delete pUser;
+    }
+}
+
+} // End namespace
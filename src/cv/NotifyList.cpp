@@ -0,0 +1,356 @@
+// Copyright (c) 2011 Conviersa Project. Use of this source code
+// is governed by the MIT License.
+
+#include "cv/NotifyList.h"
+#include "cv/Parser.h"
+#include "cv/Session.h"
+
+namespace cv {
+
+// Messages may be no longer than 512 characters, including the "\r\n".
+const int MAX_LINE_LENGTH = 510;
+
+// By default, one ISON message is sent every this many milliseconds.
+const int DEFAULT_POLL_MSEC = 10 * 1000;
+
+//-----------------------------------//
+
+NotifyList::NotifyList(Session *pSession)
+  : m_pSession(pSession),
+    m_pollIdx(0),
+    m_isSendingPoll(false),
+    m_monitorLimit(0),
+    m_isStarted(false)
+{
+    m_onlineEvt  = g_pEvtManager->createEvent<NotifyEvent>("notifyOnline");
+    m_offlineEvt = g_pEvtManager->createEvent<NotifyEvent>("notifyOffline");
+
+    m_pollTimer.setInterval(DEFAULT_POLL_MSEC);
+    QObject::connect(&m_pollTimer, SIGNAL(timeout()), this, SLOT(poll()));
+}
+
+//-----------------------------------//
+
+// Replaces the nicknames on the notify list with [nicks]. If the list
+// has been started, it is started again with the new nicknames; those
+// which were already on the list keep their state, so they aren't
+// announced again.
+void NotifyList::setNicks(const QStringList &nicks)
+{
+    QHash<QString, NotifyEntry> oldEntries = m_entries;
+    QQueue<PendingIson> pendingIsons = m_pendingIsons;
+    bool wasStarted = m_isStarted;
+    stop();
+
+    // The replies to the ISONs which were already sent are still on
+    // their way; polls for nicknames which are still on the list
+    // can still be used.
+    m_pendingIsons = pendingIsons;
+
+    m_entries.clear();
+    for(int i = 0; i < nicks.size(); ++i)
+    {
+        QString nick = nicks[i].trimmed();
+        if(nick.isEmpty())
+            continue;
+
+        QString key = foldCase(nick);
+        NotifyEntry entry;
+        entry.nick = nick;
+        entry.state = NotifyStateUnknown;
+        entry.isMonitored = false;
+        if(wasStarted && oldEntries.contains(key))
+            entry.state = oldEntries[key].state;
+        m_entries.insert(key, entry);
+    }
+
+    if(wasStarted)
+        start();
+}
+
+//-----------------------------------//
+
+QStringList NotifyList::getNicks() const
+{
+    QStringList nicks;
+    QHash<QString, NotifyEntry>::const_iterator it = m_entries.constBegin();
+    for(; it != m_entries.constEnd(); ++it)
+        nicks.append(it->nick);
+
+    return nicks;
+}
+
+//-----------------------------------//
+
+bool NotifyList::isOnline(const QString &nick) const
+{
+    QHash<QString, NotifyEntry>::const_iterator it = m_entries.constFind(foldCase(nick));
+    return (it != m_entries.constEnd() && it->state == NotifyStateOnline);
+}
+
+//-----------------------------------//
+
+// Starts keeping track of the nicknames; this should only be
+// done once the Session has registered with the server.
+void NotifyList::start()
+{
+    if(m_isStarted)
+        return;
+    m_isStarted = true;
+
+    // Monitor as many nicknames as the server allows,
+    // and poll the rest.
+    QStringList monitorNicks;
+    m_pollList.clear();
+    m_pollIdx = 0;
+    QHash<QString, NotifyEntry>::iterator it = m_entries.begin();
+    for(; it != m_entries.end(); ++it)
+    {
+        it->isMonitored = (monitorNicks.size() < m_monitorLimit);
+        if(it->isMonitored)
+            monitorNicks.append(it->nick);
+        else
+            m_pollList.append(it.key());
+    }
+
+    if(!monitorNicks.isEmpty())
+    {
+        m_pSession->sendData("MONITOR C");
+        sendPacked("MONITOR +", monitorNicks, ',');
+    }
+
+    if(!m_pollList.isEmpty())
+    {
+        poll();
+        m_pollTimer.start();
+    }
+}
+
+//-----------------------------------//
+
+// Stops keeping track of the nicknames, such as when disconnected;
+// since they could change in the meantime, their states are forgotten.
+void NotifyList::stop()
+{
+    m_isStarted = false;
+    m_pollTimer.stop();
+    m_pollList.clear();
+    m_pendingIsons.clear();
+
+    QHash<QString, NotifyEntry>::iterator it = m_entries.begin();
+    for(; it != m_entries.end(); ++it)
+    {
+        it->state = NotifyStateUnknown;
+        it->isMonitored = false;
+    }
+}
+
+//-----------------------------------//
+
+// Called by the Session whenever it sends an ISON message; those
+// which weren't sent by poll() are the user's own.
+void NotifyList::addSentIson()
+{
+    PendingIson ison;
+    ison.isPoll = m_isSendingPoll;
+    ison.time.start();
+    m_pendingIsons.enqueue(ison);
+}
+
+//-----------------------------------//
+
+// RPL_ISON
+//
+// Returns true if [msg] is the reply to one of our polls,
+// false otherwise.
+bool NotifyList::handleIsonReply(const Message &msg)
+{
+    // msg.m_params[0]: my nick
+    // msg.m_params[1]: nicks which are online, separated by spaces
+    if(m_pendingIsons.isEmpty())
+        return false;
+
+    PendingIson ison = m_pendingIsons.dequeue();
+    if(!ison.isPoll)
+        return false;
+
+    const QStringList &polledNicks = ison.nicks;
+    QStringList onlineNicks;
+    if(msg.m_paramsNum > 1)
+        onlineNicks = msg.m_params[1].split(' ', QString::SkipEmptyParts);
+
+    for(int i = 0; i < onlineNicks.size(); ++i)
+        onlineNicks[i] = foldCase(onlineNicks[i]);
+
+    for(int i = 0; i < polledNicks.size(); ++i)
+    {
+        bool isOnline = onlineNicks.contains(polledNicks[i]);
+        setState(polledNicks[i], isOnline ? NotifyStateOnline : NotifyStateOffline);
+    }
+
+    return true;
+}
+
+//-----------------------------------//
+
+// RPL_MONONLINE
+void NotifyList::handleMonitorOnline(const Message &msg)
+{
+    // msg.m_params[0]: my nick
+    // msg.m_params[1]: nick!user@host, separated by commas
+    if(msg.m_paramsNum < 2)
+        return;
+
+    QStringList targets = msg.m_params[1].split(',', QString::SkipEmptyParts);
+    for(int i = 0; i < targets.size(); ++i)
+        setState(foldCase(targets[i].section('!', 0, 0)), NotifyStateOnline);
+}
+
+//-----------------------------------//
+
+// RPL_MONOFFLINE
+void NotifyList::handleMonitorOffline(const Message &msg)
+{
+    // msg.m_params[0]: my nick
+    // msg.m_params[1]: nicks, separated by commas
+    if(msg.m_paramsNum < 2)
+        return;
+
+    QStringList targets = msg.m_params[1].split(',', QString::SkipEmptyParts);
+    for(int i = 0; i < targets.size(); ++i)
+        setState(foldCase(targets[i]), NotifyStateOffline);
+}
+
+//-----------------------------------//
+
+// ERR_MONLISTFULL
+//
+// The nicknames which didn't fit in the server's monitor
+// list are polled instead.
+void NotifyList::handleMonitorListFull(const Message &msg)
+{
+    // msg.m_params[0]: my nick
+    // msg.m_params[1]: limit
+    // msg.m_params[2]: nicks, separated by commas
+    if(msg.m_paramsNum < 3 || !m_isStarted)
+        return;
+
+    QStringList targets = msg.m_params[2].split(',', QString::SkipEmptyParts);
+    for(int i = 0; i < targets.size(); ++i)
+    {
+        QString key = foldCase(targets[i]);
+        QHash<QString, NotifyEntry>::iterator it = m_entries.find(key);
+        if(it == m_entries.end() || !it->isMonitored)
+            continue;
+
+        it->isMonitored = false;
+        m_pollList.append(key);
+    }
+
+    if(!m_pollList.isEmpty() && !m_pollTimer.isActive())
+    {
+        poll();
+        m_pollTimer.start();
+    }
+}
+
+//-----------------------------------//
+
+// Sends an ISON message for the next nicknames on the poll list,
+// packing in as many as fit in one line.
+void NotifyList::poll()
+{
+    if(m_pollList.isEmpty())
+        return;
+
+    // Don't pile up polls if the server is slow to reply.
+    expirePendingIsons();
+    for(int i = 0; i < m_pendingIsons.size(); ++i)
+    {
+        if(m_pendingIsons[i].isPoll)
+            return;
+    }
+
+    QString line = "ISON";
+    QStringList polledNicks;
+    for(int i = 0; i < m_pollList.size(); ++i)
+    {
+        const QString &key = m_pollList[m_pollIdx];
+        const QString &nick = m_entries[key].nick;
+        if(!polledNicks.isEmpty() && line.size() + 1 + nick.size() > MAX_LINE_LENGTH)
+            break;
+
+        line += ' ' + nick;
+        polledNicks.append(key);
+        m_pollIdx = (m_pollIdx + 1) % m_pollList.size();
+    }
+
+    // The Session calls addSentIson() as it sends the line.
+    m_isSendingPoll = true;
+    m_pSession->sendData(line);
+    m_isSendingPoll = false;
+
+    if(!m_pendingIsons.isEmpty() && m_pendingIsons.last().isPoll)
+        m_pendingIsons.last().nicks = polledNicks;
+}
+
+//-----------------------------------//
+
+// Gives up on the ISON messages which haven't been replied to within
+// two poll intervals; their replies were lost (or never coming, such
+// as when the server replied with an error instead).
+void NotifyList::expirePendingIsons()
+{
+    while(!m_pendingIsons.isEmpty() && m_pendingIsons.head().time.elapsed() > 2 * m_pollTimer.interval())
+    {
+        if(m_pendingIsons.head().isPoll)
+            qDebug("[NotifyList::expirePendingIsons] No reply to ISON poll; polling again");
+        m_pendingIsons.dequeue();
+    }
+}
+
+//-----------------------------------//
+
+// Changes the state of the nickname [key] (case-folded), and fires
+// the "notifyOnline" or "notifyOffline" event if it has changed.
+void NotifyList::setState(const QString &key, NotifyState state)
+{
+    QHash<QString, NotifyEntry>::iterator it = m_entries.find(key);
+    if(it == m_entries.end() || it->state == state)
+        return;
+
+    NotifyState oldState = it->state;
+    it->state = state;
+
+    if(state == NotifyStateOnline)
+        g_pEvtManager->fireEvent(m_onlineEvt, m_pSession, NotifyEvent(it->nick));
+    else if(oldState == NotifyStateOnline)
+        g_pEvtManager->fireEvent(m_offlineEvt, m_pSession, NotifyEvent(it->nick));
+}
+
+//-----------------------------------//
+
+// Sends [command] followed by [nicks], separated by [separator], split
+// into as many messages as it takes to keep each within a line.
+void NotifyList::sendPacked(const QString &command, const QStringList &nicks, const QChar &separator)
+{
+    QString line;
+    for(int i = 0; i < nicks.size(); ++i)
+    {
+        if(!line.isEmpty() && line.size() + 1 + nicks[i].size() > MAX_LINE_LENGTH)
+        {
+            m_pSession->sendData(line);
+            line.clear();
+        }
+
+        if(line.isEmpty())
+            line = command + ' ' + nicks[i];
+        else
+            line += separator + nicks[i];
+    }
+
+    if(!line.isEmpty())
+        m_pSession->sendData(line);
+}
+
+} // End namespace
@@ -0,0 +1,51 @@
+// Copyright (c) 2011 Conviersa Project. Use of this source code
+// is governed by the MIT License.
+
+#include <QtGlobal>
+#include "cv/NumericRegistry.h"
+
+namespace cv {
+
+// Attaches a [callback] function to the given [numeric].
+void NumericRegistry::hookNumeric(int numeric, NumericCallback callback)
+{
+    if(!isValid(numeric))
+    {
+        qDebug("[NR::hookNumeric] Attempted to hook invalid numeric %d", numeric);
+        return;
+    }
+
+    m_callbacks[numeric].append(callback);
+}
+
+//-----------------------------------//
+
+// Detaches a [callback] function from the given [numeric].
+void NumericRegistry::unhookNumeric(int numeric, NumericCallback callback)
+{
+    if(!isValid(numeric))
+        return;
+
+    m_callbacks[numeric].removeOne(callback);
+}
+
+//-----------------------------------//
+
+// Executes every callback hooked into the numeric held by [msg].
+//
+// Returns true if there was at least one callback, false otherwise.
+bool NumericRegistry::dispatch(const Message &msg)
+{
+    if(!isValid(msg.m_command) || m_callbacks[msg.m_command].isEmpty())
+        return false;
+
+    // Iterate over a (shallow) copy so that callbacks are free to
+    // hook or unhook numerics while the numeric is being dispatched.
+    QList<NumericCallback> callbacks = m_callbacks[msg.m_command];
+    for(int i = 0; i < callbacks.size(); ++i)
+        callbacks[i](msg);
+
+    return true;
+}
+
+} // End namespace
@@ -30,8 +30,11 @@ Message parseData(const QString &data)
         ++sectionIndex;
     }
 
-    // Get the command.
+    // Get the command. If it ends the line, there are no parameters,
+    // such as for AWAY when the user comes back (see away-notify).
     QString command = data.section(' ', sectionIndex, sectionIndex, QString::SectionSkipEmpty);
+    bool hasParams = (command.indexOf('\n') < 0);
+    command = command.trimmed();
     ++sectionIndex;
 
     // Decide which one it is.
@@ -39,7 +42,23 @@ Message parseData(const QString &data)
     if(!msg.m_isNumeric)
     {
         // The command isn't numeric, so we still have to search for it.
-        if(command.compare("ERROR", Qt::CaseInsensitive) == 0)
+        if(command.compare("ACCOUNT", Qt::CaseInsensitive) == 0)
+        {
+            msg.m_command = IRC_COMMAND_ACCOUNT;
+        }
+        else if(command.compare("AWAY", Qt::CaseInsensitive) == 0)
+        {
+            msg.m_command = IRC_COMMAND_AWAY;
+        }
+        else if(command.compare("CAP", Qt::CaseInsensitive) == 0)
+        {
+            msg.m_command = IRC_COMMAND_CAP;
+        }
+        else if(command.compare("CHGHOST", Qt::CaseInsensitive) == 0)
+        {
+            msg.m_command = IRC_COMMAND_CHGHOST;
+        }
+        else if(command.compare("ERROR", Qt::CaseInsensitive) == 0)
         {
             msg.m_command = IRC_COMMAND_ERROR;
         }
@@ -101,6 +120,12 @@ Message parseData(const QString &data)
         }
     }
 
+    if(!hasParams)
+    {
+        msg.m_paramsNum = 0;
+        return msg;
+    }
+
     // Get the parameters.
     int paramsIndex = 0;
     while(true)
@@ -138,6 +163,55 @@ Message parseData(const QString &data)
 
 //-----------------------------------//
 
+// Extracts the fields of an RPL_LIST (322) reply straight from the
+// raw line in [data], without building a Message for it; this is
+// used for the (very many) replies to a LIST request.
+//
+// Returns true if [data] is a 322 reply, false otherwise, in which
+// case none of the output parameters are modified.
+bool parseListReply(const QString &data, QString &channel, int &numUsers, QString &topic)
+{
+    // Format: :<server> 322 <nick> <channel> <# users> :<topic>
+    if(!data.startsWith(':'))
+        return false;
+
+    int cmdStart = data.indexOf(' ') + 1;
+    if(cmdStart <= 0 || data.midRef(cmdStart, 4) != QLatin1String("322 "))
+        return false;
+
+    int chanStart = data.indexOf(' ', cmdStart + 4) + 1;
+    if(chanStart <= 0)
+        return false;
+
+    int usersStart = data.indexOf(' ', chanStart) + 1;
+    if(usersStart <= 0)
+        return false;
+
+    int topicStart = data.indexOf(' ', usersStart) + 1;
+    if(topicStart <= 0)
+        return false;
+
+    bool conversionOk;
+    int users = data.mid(usersStart, topicStart - usersStart - 1).toInt(&conversionOk);
+    if(!conversionOk)
+        return false;
+
+    // Leave off the trailing "\r\n".
+    int topicEnd = data.size();
+    while(topicEnd > topicStart && (data[topicEnd-1] == '\n' || data[topicEnd-1] == '\r'))
+        --topicEnd;
+
+    if(topicStart < topicEnd && data[topicStart] == ':')
+        ++topicStart;
+
+    channel = data.mid(chanStart, usersStart - chanStart - 1);
+    numUsers = users;
+    topic = data.mid(topicStart, topicEnd - topicStart);
+    return true;
+}
+
+//-----------------------------------//
+
 QString getNetworkNameFrom001(const Message &msg)
 {
     // msg.m_params[0]: my nick
@@ -425,6 +499,70 @@ ChanModeType getChanModeType(const QString &chanModes, const QChar &letter)
 
 //-----------------------------------//
 
+// Parses the mode string and parameters of a channel MODE message
+// into a list of individual mode changes, using [chanModes] (from the
+// CHANMODES section of the 005 numeric) to decide which modes take
+// a parameter. [modeNum] is the server's MODES limit, and is only used
+// as a hint for how many changes to expect.
+//
+// Example: "MODE #chan +ov-b nick1 nick2 *!*@host" gives
+//  +o nick1, +v nick2, -b *!*@host
+QList<ChannelMode> parseChannelModes(const QString &chanModes, const Message &msg, int modeNum/* = 0*/)
+{
+    QList<ChannelMode> modeList;
+    if(msg.m_paramsNum < 2)
+        return modeList;
+
+    if(modeNum > 0)
+        modeList.reserve(modeNum);
+
+    // Split the mode types up front so each letter is only
+    // checked against the list it could belong to.
+    QString typeA = chanModes.section(',', 0, 0),
+            typeB = chanModes.section(',', 1, 1),
+            typeC = chanModes.section(',', 2, 2);
+
+    bool sign = true;
+    const QString &modes = msg.m_params[1];
+    for(int modesIndex = 0, paramsIndex = 2; modesIndex < modes.size(); ++modesIndex)
+    {
+        const QChar &letter = modes[modesIndex];
+        if(letter == '+')
+        {
+            sign = true;
+            continue;
+        }
+        else if(letter == '-')
+        {
+            sign = false;
+            continue;
+        }
+
+        ChannelMode mode;
+        mode.m_sign = sign;
+        mode.m_mode = letter;
+
+        // Type A and B modes always take a parameter, and type C
+        // modes only take one when they are being set.
+        bool hasParam = typeA.contains(letter)
+                     || typeB.contains(letter)
+                     || (sign && typeC.contains(letter));
+        if(hasParam)
+        {
+            // If there's no params left, the mode is malformed.
+            if(paramsIndex >= msg.m_paramsNum)
+                continue;
+            mode.m_param = msg.m_params[paramsIndex++];
+        }
+
+        modeList.append(mode);
+    }
+
+    return modeList;
+}
+
+//-----------------------------------//
+
 // Checks for the PREFIX section in a 005 numeric, and if
 // it exists, it parses it and returns it.
 QString getPrefixRules(const QString &param)
@@ -602,4 +740,32 @@ bool isChannel(const QString &str)
     }
 }
 
+//-----------------------------------//
+
+// Returns [name] (a nickname or channel) in lowercase, following
+// RFC 1459, where {}|^ are the lowercase forms of []\~; two names
+// are equivalent if their folded forms are equal.
+QString foldCase(const QString &name)
+{
+    QString folded = name;
+    QChar *pChar = folded.data();
+    for(int i = 0; i < folded.length(); ++i)
+        pChar[i] = foldCaseChar(pChar[i]);
+
+    return folded;
+}
+
+//-----------------------------------//
+
+// Returns the lowercase form of [c], as in foldCase().
+QChar foldCaseChar(QChar c)
+{
+    ushort u = c.unicode();
+    if(u >= 'A' && u <= ']')
+        return QChar(u + ('a' - 'A'));
+    if(u == '~')
+        return QChar('^');
+    return c;
+}
+
 } // End namespace
@@ -0,0 +1,81 @@
+// Copyright (c) 2011 Conviersa Project. Use of this source code
+// is governed by the MIT License.
+
+#include <QDir>
+#include <QLibrary>
+#include <QPluginLoader>
+#include "cv/EventManager.h"
+#include "cv/Plugin.h"
+#include "cv/PluginManager.h"
+
+namespace cv {
+
+PluginManager::~PluginManager()
+{
+    unloadPlugins();
+}
+
+//-----------------------------------//
+
+// Loads every plugin in the directory [dirPath]; a directory
+// that doesn't exist just means there are no plugins.
+void PluginManager::loadPlugins(const QString &dirPath)
+{
+    QDir dir(dirPath);
+    if(!dir.exists())
+        return;
+
+    QStringList filenames = dir.entryList(QDir::Files);
+    for(int i = 0; i < filenames.size(); ++i)
+        if(QLibrary::isLibrary(filenames[i]))
+            loadPlugin(dir.absoluteFilePath(filenames[i]));
+}
+
+//-----------------------------------//
+
+// Loads the plugin in the shared library [filename].
+//
+// Returns true if it was loaded, false otherwise.
+bool PluginManager::loadPlugin(const QString &filename)
+{
+    QPluginLoader *pLoader = new QPluginLoader(filename);
+    Plugin *pPlugin = qobject_cast<Plugin *>(pLoader->instance());
+    if(pPlugin == NULL)
+    {
+        qDebug("[PM::loadPlugin] %s is not a plugin: %s",
+               filename.toLatin1().constData(),
+               pLoader->errorString().toLatin1().constData());
+        pLoader->unload();
+        delete pLoader;
+        return false;
+    }
+
+    if(!pPlugin->load(g_pEvtManager))
+    {
+        qDebug("[PM::loadPlugin] Plugin \"%s\" failed to load", pPlugin->getName().toLatin1().constData());
+        pLoader->unload();
+        delete pLoader;
+        return false;
+    }
+
+    m_loaders.append(pLoader);
+    m_plugins.append(pPlugin);
+    return true;
+}
+
+//-----------------------------------//
+
+// Unloads every plugin, in the reverse order they were loaded.
+void PluginManager::unloadPlugins()
+{
+    while(!m_plugins.isEmpty())
+    {
+        m_plugins.takeLast()->unload(g_pEvtManager);
+
+        QPluginLoader *pLoader = m_loaders.takeLast();
+        pLoader->unload();
+        delete pLoader;
+    }
+}
+
+} // End namespace
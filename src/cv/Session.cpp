@@ -1,16 +1,81 @@
 // Copyright (c) 2011 Conviersa Project. Use of this source code
 // is governed by the MIT License.
 
+#include <climits>
 #include <QCoreApplication>
 #include <QDebug>
+#include <QRegExp>
 #include "cv/Session.h"
+#include "cv/ChannelUser.h"
 #include "cv/Parser.h"
 
 namespace cv {
 
+// A batch of channels from a LIST request is handed on once it
+// reaches this many rows, or once this many milliseconds have
+// passed since the previous batch, whichever comes first.
+const int LIST_BATCH_SIZE = 256;
+const int LIST_BATCH_MSEC = 250;
+
+// Sweeps of channels with WHO are sent this many milliseconds apart,
+// and without away-notify, every channel is swept again this often.
+const int WHO_DELAY_MSEC = 2000;
+const int WHO_REFRESH_MSEC = 5 * 60 * 1000;
+
+// A sweep is given up on if it hasn't ended this many milliseconds
+// after it was sent.
+const int WHO_TIMEOUT_MSEC = 30 * 1000;
+
+// A netsplit or netjoin is fired once this many milliseconds pass without
+// another QUIT or JOIN that belongs to it. Users who quit in a netsplit
+// are only taken to be part of a netjoin for this long afterwards, and
+// once a netjoin has been fired, the other JOINs of the users in it (to
+// their other channels) only belong to it for a short while longer.
+const int SPLIT_DELAY_MSEC = 1000;
+const int NETJOIN_EXPIRE_MSEC = 30 * 60 * 1000;
+const int NETJOIN_REJOIN_MSEC = 10 * 1000;
+
+// Identifies the replies to our own WHOX sweeps.
+const char WHOX_TOKEN[] = "152";
+
+// The capabilities requested from the server, if it offers them.
+const char *const SUPPORTED_CAPS[] = { "away-notify", "account-notify", "chghost" };
+const int NUM_SUPPORTED_CAPS = sizeof(SUPPORTED_CAPS) / sizeof(SUPPORTED_CAPS[0]);
+
+//-----------------------------------//
+
+// Sets [type] to the channel list that [mode] adds to or removes
+// from; returns false if it isn't one of them.
+static bool getListType(const QChar &mode, ChannelListType &type)
+{
+    switch(mode.toLatin1())
+    {
+        case 'b':
+            type = ChannelListBan;
+            return true;
+        case 'e':
+            type = ChannelListExcept;
+            return true;
+        case 'I':
+            type = ChannelListInvite;
+            return true;
+        default:
+            return false;
+    }
+}
+
+//-----------------------------------//
+
 Session::Session(const QString& nick)
   : m_nick(nick),
-    m_prevData("")
+    m_modeNum(3),
+    m_prevData(""),
+    m_listActive(false),
+    m_listBatchStart(0),
+    m_state(this),
+    m_hasWhox(false),
+    m_notifyList(this),
+    m_splitType(SplitTypeNone)
 {
     m_pConn = new ThreadedConnection;
     QObject::connect(m_pConn, SIGNAL(connecting()), this, SLOT(onConnecting()));
@@ -19,29 +84,77 @@ Session::Session(const QString& nick)
     QObject::connect(m_pConn, SIGNAL(disconnected()), this, SLOT(onDisconnect()));
     QObject::connect(m_pConn, SIGNAL(dataReceived(QString)), this, SLOT(onReceiveData(QString)));
 
-    g_pEvtManager->createEvent("connecting");
-    g_pEvtManager->createEvent("connectFailed");
-    g_pEvtManager->createEvent("connected");
-    g_pEvtManager->createEvent("disconnected");
-    g_pEvtManager->createEvent("sendData");
-    g_pEvtManager->createEvent("receivedData");
-    g_pEvtManager->createEvent("errorMessage");
-    g_pEvtManager->createEvent("inviteMessage");
-    g_pEvtManager->createEvent("joinMessage");
-    g_pEvtManager->createEvent("kickMessage");
-    g_pEvtManager->createEvent("modeMessage");
-    g_pEvtManager->createEvent("nickMessage");
-    g_pEvtManager->createEvent("noticeMessage");
-    g_pEvtManager->createEvent("partMessage");
-    g_pEvtManager->createEvent("pongMessage");
-    g_pEvtManager->createEvent("privmsgMessage");
-    g_pEvtManager->createEvent("quitMessage");
-    g_pEvtManager->createEvent("topicMessage");
-    g_pEvtManager->createEvent("wallopsMessage");
-    g_pEvtManager->createEvent("numericMessage");
-    g_pEvtManager->createEvent("unknownMessage");
-
-    g_pEvtManager->hookEvent("sendData", this, MakeDelegate(this, &Session::onSendData));
+    m_whoTimer.setSingleShot(true);
+    m_whoTimer.setInterval(WHO_DELAY_MSEC);
+    QObject::connect(&m_whoTimer, SIGNAL(timeout()), this, SLOT(sendNextWho()));
+    m_whoRefreshTimer.setInterval(WHO_REFRESH_MSEC);
+    QObject::connect(&m_whoRefreshTimer, SIGNAL(timeout()), this, SLOT(refreshWho()));
+    m_whoTimeoutTimer.setSingleShot(true);
+    m_whoTimeoutTimer.setInterval(WHO_TIMEOUT_MSEC);
+    QObject::connect(&m_whoTimeoutTimer, SIGNAL(timeout()), this, SLOT(abandonWho()));
+    m_splitTimer.setSingleShot(true);
+    m_splitTimer.setInterval(SPLIT_DELAY_MSEC);
+    QObject::connect(&m_splitTimer, SIGNAL(timeout()), this, SLOT(flushSplit()));
+
+    updateHighlighter();
+
+    m_connectingEvt       = g_pEvtManager->createEvent<ConnectionEvent>("connecting");
+    m_connectFailedEvt    = g_pEvtManager->createEvent<ConnectionEvent>("connectFailed");
+    m_connectedEvt        = g_pEvtManager->createEvent<ConnectionEvent>("connected");
+    m_disconnectedEvt     = g_pEvtManager->createEvent<ConnectionEvent>("disconnected");
+    m_sendDataEvt         = g_pEvtManager->createEvent<DataEvent>("sendData");
+    m_receivedDataEvt     = g_pEvtManager->createEvent<DataEvent>("receivedData");
+    m_channelListBatchEvt = g_pEvtManager->createEvent<ChannelListEvent>("channelListBatch");
+    m_numericMessageEvt   = g_pEvtManager->createEvent<MessageEvent>("numericMessage");
+    m_netsplitEvt         = g_pEvtManager->createEvent<NetsplitEvent>("netsplit");
+    m_netjoinEvt          = g_pEvtManager->createEvent<NetsplitEvent>("netjoin");
+
+    m_commandEvts[IRC_COMMAND_UNKNOWN] = g_pEvtManager->createEvent<MessageEvent>("unknownMessage");
+    m_commandEvts[IRC_COMMAND_ACCOUNT] = g_pEvtManager->createEvent<MessageEvent>("accountMessage");
+    m_commandEvts[IRC_COMMAND_AWAY]    = g_pEvtManager->createEvent<MessageEvent>("awayMessage");
+    m_commandEvts[IRC_COMMAND_CHGHOST] = g_pEvtManager->createEvent<MessageEvent>("chghostMessage");
+    m_commandEvts[IRC_COMMAND_ERROR]   = g_pEvtManager->createEvent<MessageEvent>("errorMessage");
+    m_commandEvts[IRC_COMMAND_INVITE]  = g_pEvtManager->createEvent<MessageEvent>("inviteMessage");
+    m_commandEvts[IRC_COMMAND_JOIN]    = g_pEvtManager->createEvent<MessageEvent>("joinMessage");
+    m_commandEvts[IRC_COMMAND_KICK]    = g_pEvtManager->createEvent<MessageEvent>("kickMessage");
+    m_commandEvts[IRC_COMMAND_MODE]    = g_pEvtManager->createEvent<MessageEvent>("modeMessage");
+    m_commandEvts[IRC_COMMAND_NICK]    = g_pEvtManager->createEvent<MessageEvent>("nickMessage");
+    m_commandEvts[IRC_COMMAND_NOTICE]  = g_pEvtManager->createEvent<MessageEvent>("noticeMessage");
+    m_commandEvts[IRC_COMMAND_PART]    = g_pEvtManager->createEvent<MessageEvent>("partMessage");
+    m_commandEvts[IRC_COMMAND_PONG]    = g_pEvtManager->createEvent<MessageEvent>("pongMessage");
+    m_commandEvts[IRC_COMMAND_PRIVMSG] = g_pEvtManager->createEvent<MessageEvent>("privmsgMessage");
+    m_commandEvts[IRC_COMMAND_QUIT]    = g_pEvtManager->createEvent<MessageEvent>("quitMessage");
+    m_commandEvts[IRC_COMMAND_TOPIC]   = g_pEvtManager->createEvent<MessageEvent>("topicMessage");
+    m_commandEvts[IRC_COMMAND_WALLOPS] = g_pEvtManager->createEvent<MessageEvent>("wallopsMessage");
+
+    // PING and CAP are handled by the Session and aren't fired as events.
+    m_commandEvts[IRC_COMMAND_PING]    = INVALID_EVENT_ID;
+    m_commandEvts[IRC_COMMAND_CAP]     = INVALID_EVENT_ID;
+
+    g_pEvtManager->hookEvent(m_sendDataEvt, this, MakeDelegate(this, &Session::onSendData));
+
+    hookNumeric(1, MakeDelegate(this, &Session::handle001Numeric));
+    hookNumeric(2, MakeDelegate(this, &Session::handle002Numeric));
+    hookNumeric(5, MakeDelegate(this, &Session::handle005Numeric));
+    hookNumeric(303, MakeDelegate(this, &Session::handle303Numeric));
+    hookNumeric(321, MakeDelegate(this, &Session::handle321Numeric));
+    hookNumeric(322, MakeDelegate(this, &Session::handle322Numeric));
+    hookNumeric(315, MakeDelegate(this, &Session::handle315Numeric));
+    hookNumeric(323, MakeDelegate(this, &Session::handle323Numeric));
+    hookNumeric(352, MakeDelegate(this, &Session::handle352Numeric));
+    hookNumeric(353, MakeDelegate(this, &Session::handle353Numeric));
+    hookNumeric(354, MakeDelegate(this, &Session::handle354Numeric));
+    hookNumeric(346, MakeDelegate(this, &Session::handleListEntryNumeric));
+    hookNumeric(347, MakeDelegate(this, &Session::handleEndOfListNumeric));
+    hookNumeric(348, MakeDelegate(this, &Session::handleListEntryNumeric));
+    hookNumeric(349, MakeDelegate(this, &Session::handleEndOfListNumeric));
+    hookNumeric(367, MakeDelegate(this, &Session::handleListEntryNumeric));
+    hookNumeric(368, MakeDelegate(this, &Session::handleEndOfListNumeric));
+    hookNumeric(376, MakeDelegate(this, &Session::handle376Numeric));
+    hookNumeric(422, MakeDelegate(this, &Session::handle376Numeric));
+    hookNumeric(730, MakeDelegate(this, &Session::handle730Numeric));
+    hookNumeric(731, MakeDelegate(this, &Session::handle731Numeric));
+    hookNumeric(734, MakeDelegate(this, &Session::handle734Numeric));
 }
 
 //-----------------------------------//
@@ -64,7 +177,7 @@ void Session::connectToServer(const QString &host, int port)
 void Session::connectToServer(const QString &host, int port, const QString &name, const QString &nick)
 {
     m_name = name;
-    m_nick = nick;
+    setNick(nick);
     m_host = host;
     m_port = port;
 
@@ -75,6 +188,12 @@ void Session::connectToServer(const QString &host, int port, const QString &name
     // For more info see the definition in Session.h.
     m_prefixRules = "o@v+";
 
+    // RFC 2812 allows up to 3 modes with parameters per message,
+    // which is used until the server sends MODES in the 005 numeric.
+    m_modeNum = 3;
+    m_hasWhox = false;
+    m_notifyList.setMonitorLimit(0);
+
     m_pConn->connectToHost(host, port);
 }
 
@@ -90,17 +209,33 @@ void Session::disconnectFromServer()
 
 void Session::sendData(const QString &data)
 {
-    DataEvent *pEvt = new DataEvent(data);
-    g_pEvtManager->fireEvent("sendData", this, pEvt);
-    delete pEvt;
+    g_pEvtManager->fireEvent(m_sendDataEvt, this, DataEvent(data));
 }
 
 //-----------------------------------//
 
-// Default functionality for the sendData event; it just sends the data.
-void Session::onSendData(Event *pEvt)
+// Default functionality for the sendData event; it just sends the data,
+// keeping track of each WHO and ISON so that its replies can be recognized.
+void Session::onSendData(const DataEvent &evt)
 {
-    m_pConn->send(DCAST(DataEvent, pEvt)->getData() + "\r\n");
+    const QString &data = evt.getData();
+    QString command = data.section(' ', 0, 0);
+    if(command.compare("ISON", Qt::CaseInsensitive) == 0)
+    {
+        m_notifyList.addSentIson();
+    }
+    else if(command.compare("WHO", Qt::CaseInsensitive) == 0)
+    {
+        // Servers reply to a WHO without a mask as if it were "*".
+        PendingWho who;
+        who.mask = foldCase(data.section(' ', 1, 1, QString::SectionSkipEmpty));
+        if(who.mask.isEmpty())
+            who.mask = "*";
+        who.isSweep = false;
+        m_pendingWhos.append(who);
+    }
+
+    m_pConn->send(data + "\r\n");
 }
 
 //-----------------------------------//
@@ -119,6 +254,33 @@ void Session::sendAction(const QString &target, const QString &msg)
 
 //-----------------------------------//
 
+void Session::setNick(const QString &nick)
+{
+    m_nick = nick;
+    updateHighlighter();
+}
+
+//-----------------------------------//
+
+// Sets the user's other nicks, which highlight messages
+// in the same way as the current one.
+void Session::setAltNicks(const QStringList &altNicks)
+{
+    m_altNicks = altNicks;
+    updateHighlighter();
+}
+
+//-----------------------------------//
+
+// Sets the words (besides the user's nicks) which highlight messages.
+void Session::setHighlightWords(const QStringList &words)
+{
+    m_highlightWords = words;
+    updateHighlighter();
+}
+
+//-----------------------------------//
+
 // Sets the prefix rules supported by the server.
 void Session::setPrefixRules(const QString &prefixRules)
 {
@@ -181,6 +343,35 @@ int Session::compareNickPrefixes(const QChar &prefix1, const QChar &prefix2)
 
 //-----------------------------------//
 
+// Returns the rank of [prefix] as per the server's specification, where
+// the most powerful prefix has rank 0. Anything that isn't a prefix
+// (such as '\0' for no prefix) ranks after all of them.
+int Session::getPrefixRank(const QChar &prefix)
+{
+    for(int i = 1; i < m_prefixRules.size(); i += 2)
+    {
+        if(m_prefixRules[i] == prefix)
+            return i / 2;
+    }
+
+    return m_prefixRules.size() / 2;
+}
+
+//-----------------------------------//
+
+// Returns the prefix with the given [rank] (see getPrefixRank()),
+// or '\0' if the server has no such prefix.
+QChar Session::getNickPrefix(int rank)
+{
+    int i = rank * 2 + 1;
+    if(rank < 0 || i >= m_prefixRules.size())
+        return '\0';
+
+    return m_prefixRules[i];
+}
+
+//-----------------------------------//
+
 // Returns the corresponding prefix rule to the character provided by [match].
 // It can either be a nick prefix or the corresponding mode.
 QChar Session::getPrefixRule(const QChar &match)
@@ -225,161 +416,895 @@ bool Session::isNickPrefix(const QChar &prefix)
 // some information as a result of others (like numerics).
 void Session::processMessage(const Message &msg)
 {
-    Event *pEvent = new MessageEvent(msg);
+    MessageEvent evt(msg);
     if(msg.m_isNumeric)
     {
-        switch(msg.m_command)
+        // Only fall back to the generic event if no one has
+        // hooked into this specific numeric.
+        if(!m_numerics.dispatch(msg))
+            g_pEvtManager->fireEvent(m_numericMessageEvt, this, evt);
+    }
+    else if(msg.m_command == IRC_COMMAND_PING)
+    {
+        sendData("PONG :" + msg.m_params[0]);
+    }
+    else if(msg.m_command == IRC_COMMAND_CAP)
+    {
+        handleCap(msg);
+    }
+    else
+    {
+        // The netsplit or netjoin being collected ends with the first
+        // message that changes the network state and isn't part of it.
+        QString splitServers;
+        SplitType splitType = getSplitType(msg, splitServers);
+        if(m_splitType != SplitTypeNone
+            && msg.m_command != IRC_COMMAND_PRIVMSG
+            && msg.m_command != IRC_COMMAND_NOTICE
+            && (splitType != m_splitType || splitServers != m_splitServers))
         {
-            case 1:
-            {
-                // Check to make sure nickname hasn't changed; some or all servers apparently don't
-                // send you a NICK message when your nickname conflicts with another user upon
-                // first entering the server, and you try to change it.
-                if(!isMyNick(msg.m_params[0]))
-                    setNick(msg.m_params[0]);
+            flushSplit();
+        }
 
-                break;
-            }
-            case 2:
-            {
-                // msg.m_params[0]: my nick
-                // msg.m_params[1]: "Your host is ..."
-                QString header = "Your host is ";
-                QString hostStr = msg.m_params[1].section(',', 0, 0);
-                if(hostStr.startsWith(header))
-                {
-                    setHost(hostStr.mid(header.size()));
-                }
+        updateNetworkState(msg);
 
-                break;
-            }
-            case 5:
-            {
-                // We only go to the second-to-last parameter, because the
-                // last parameter holds "are supported by this server".
-                for(int i = 1; i < msg.m_paramsNum-1; ++i)
-                {
-                    if(msg.m_params[i].startsWith("PREFIX=", Qt::CaseInsensitive))
-                    {
-                        setPrefixRules(getPrefixRules(msg.m_params[i]));
-                    }
-                    else if(msg.m_params[i].compare("NAMESX", Qt::CaseInsensitive) == 0)
-                    {
-                        // Lets the server know we support multiple nick prefixes.
-                        //
-                        // TODO (seand): Implement UHNAMES?
-                        sendData("PROTOCTL NAMESX");
-                    }
-                    else if(msg.m_params[i].startsWith("CHANMODES=", Qt::CaseInsensitive))
-                    {
-                        setChanModes(msg.m_params[i].section('=', 1));
-                    }
-                }
+        if(splitType != SplitTypeNone)
+        {
+            collectSplit(msg, splitType, splitServers);
+            return;
+        }
+
+        // Messages for a channel or query go straight to its window.
+        g_pEvtManager->fireEvent(m_commandEvts[msg.m_command], this, getMessageTarget(msg), evt);
 
-                break;
+        pruneNetworkState(msg);
+
+        // Update the user's nickname if he's the one changing it.
+        if(msg.m_command == IRC_COMMAND_NICK)
+        {
+            QString oldNick = parseMsgPrefix(msg.m_prefix, MsgPrefixName);
+            if(isMyNick(oldNick))
+            {
+                setNick(msg.m_params[0]);
             }
         }
+    }
+}
 
-        g_pEvtManager->fireEvent("numericMessage", this, pEvent);
+//-----------------------------------//
+
+// Returns the case-folded name of the channel or query window that
+// [msg] is meant for, or an empty string if it isn't meant for one.
+QString Session::getMessageTarget(const Message &msg)
+{
+    if(msg.m_paramsNum < 1)
+        return QString();
+
+    switch(msg.m_command)
+    {
+        case IRC_COMMAND_JOIN:
+        case IRC_COMMAND_KICK:
+        case IRC_COMMAND_MODE:
+        case IRC_COMMAND_PART:
+        case IRC_COMMAND_TOPIC:
+            return foldCase(msg.m_params[0]);
+        case IRC_COMMAND_NOTICE:
+        case IRC_COMMAND_PRIVMSG:
+        {
+            // A private message belongs to the query with the sender.
+            if(isMyNick(msg.m_params[0]))
+                return foldCase(parseMsgPrefix(msg.m_prefix, MsgPrefixName));
+            return foldCase(msg.m_params[0]);
+        }
+        default:
+            return QString();
     }
+}
+
+//-----------------------------------//
+
+// Returns true if [data] is a PRIVMSG or NOTICE from a user on the
+// ignore list; only the prefix and command are looked at, so this
+// is done before the line is parsed.
+bool Session::isIgnoredLine(const QString &data)
+{
+    if(m_ignoreList.isEmpty() || !data.startsWith(':'))
+        return false;
+
+    int prefixEnd = data.indexOf(' ');
+    int commandEnd = (prefixEnd < 0) ? -1 : data.indexOf(' ', prefixEnd + 1);
+    if(commandEnd < 0)
+        return false;
+
+    IgnoreType type;
+    QStringRef command = data.midRef(prefixEnd + 1, commandEnd - prefixEnd - 1);
+    if(command.compare("PRIVMSG", Qt::CaseInsensitive) == 0)
+        type = IgnoreMessages;
+    else if(command.compare("NOTICE", Qt::CaseInsensitive) == 0)
+        type = IgnoreNotices;
     else
+        return false;
+
+    // CTCPs (and their replies) are wrapped in \1.
+    int trailingStart = data.indexOf(" :", commandEnd) + 2;
+    if(trailingStart > 1 && trailingStart < data.size() && data[trailingStart] == '\1')
+        type = IgnoreCtcp;
+
+    return m_ignoreList.isIgnored(data.mid(1, prefixEnd - 1), type);
+}
+
+//-----------------------------------//
+
+// Hands the user's nicks and the highlight words on to the highlighter,
+// which only rebuilds its automaton if they've changed.
+void Session::updateHighlighter()
+{
+    QStringList words;
+    words.append(m_nick);
+    words += m_altNicks;
+    words += m_highlightWords;
+    m_highlighter.setWords(words);
+}
+
+//-----------------------------------//
+
+// Applies the joins, nick changes and prefix changes in [msg] to the
+// network state; this is done before the message's event is fired.
+void Session::updateNetworkState(const Message &msg)
+{
+    switch(msg.m_command)
     {
-        switch(msg.m_command)
+        case IRC_COMMAND_JOIN:
         {
-            case IRC_COMMAND_ERROR:
-            {
-                g_pEvtManager->fireEvent("errorMessage", this, pEvent);
-                break;
-            }
-            case IRC_COMMAND_INVITE:
-            {
-                g_pEvtManager->fireEvent("inviteMessage", this, pEvent);
-                break;
-            }
-            case IRC_COMMAND_JOIN:
-            {
-                g_pEvtManager->fireEvent("joinMessage", this, pEvent);
-                break;
-            }
-            case IRC_COMMAND_KICK:
-            {
-                g_pEvtManager->fireEvent("kickMessage", this, pEvent);
-                break;
-            }
-            case IRC_COMMAND_MODE:
+            if(msg.m_paramsNum < 1)
+                return;
+
+            if(isMyNick(parseMsgPrefix(msg.m_prefix, MsgPrefixName)))
             {
-                g_pEvtManager->fireEvent("modeMessage", this, pEvent);
-                break;
+                m_state.addChannel(msg.m_params[0]);
+
+                // The server sends the names in the channel before it
+                // gets to the WHO, so the sweep covers all of them.
+                queueWho(msg.m_params[0]);
             }
-            case IRC_COMMAND_NICK:
-            {
-                g_pEvtManager->fireEvent("nickMessage", this, pEvent);
+            m_state.addMember(msg.m_params[0], msg.m_prefix);
+            break;
+        }
+        case IRC_COMMAND_ACCOUNT:
+        {
+            // msg.m_params[0]: account, or "*" if logged out
+            if(msg.m_paramsNum < 1)
+                return;
+
+            QString account = (msg.m_params[0] == "*") ? QString() : msg.m_params[0];
+            m_state.setUserAccount(parseMsgPrefix(msg.m_prefix, MsgPrefixName), account);
+            break;
+        }
+        case IRC_COMMAND_AWAY:
+        {
+            // The user is back if there is no away message.
+            m_state.setUserAway(parseMsgPrefix(msg.m_prefix, MsgPrefixName), msg.m_paramsNum > 0);
+            break;
+        }
+        case IRC_COMMAND_CHGHOST:
+        {
+            // msg.m_params[0]: new user
+            // msg.m_params[1]: new host
+            if(msg.m_paramsNum < 2)
+                return;
+
+            m_state.setUserHost(parseMsgPrefix(msg.m_prefix, MsgPrefixName), msg.m_params[0], msg.m_params[1]);
+            break;
+        }
+        case IRC_COMMAND_NICK:
+        {
+            if(msg.m_paramsNum < 1)
+                return;
 
-                // update the user's nickname if he's the one changing it
-                QString oldNick = parseMsgPrefix(msg.m_prefix, MsgPrefixName);
-                if(isMyNick(oldNick))
+            m_state.renameUser(parseMsgPrefix(msg.m_prefix, MsgPrefixName), msg.m_params[0]);
+            break;
+        }
+        case IRC_COMMAND_MODE:
+        {
+            if(msg.m_paramsNum < 2 || m_state.findChannel(msg.m_params[0]) == NULL)
+                return;
+
+            QList<ChannelMode> modeList = parseChannelModes(m_chanModes, msg, m_modeNum);
+            for(int i = 0; i < modeList.size(); ++i)
+            {
+                const ChannelMode &mode = modeList[i];
+                ChannelListType listType;
+                if(getListType(mode.m_mode, listType))
                 {
-                    setNick(msg.m_params[0]);
+                    if(mode.m_sign)
+                        m_state.addMask(msg.m_params[0], listType, mode.m_param, parseMsgPrefix(msg.m_prefix, MsgPrefixName));
+                    else
+                        m_state.removeMask(msg.m_params[0], listType, mode.m_param);
+                    continue;
                 }
-                break;
-            }
-            case IRC_COMMAND_NOTICE:
-            {
-                g_pEvtManager->fireEvent("noticeMessage", this, pEvent);
-                break;
-            }
-            case IRC_COMMAND_PART:
-            {
-                g_pEvtManager->fireEvent("partMessage", this, pEvent);
-                break;
-            }
-            case IRC_COMMAND_PING:
-            {
-                sendData("PONG :" + msg.m_params[0]);
-                break;
-            }
-            case IRC_COMMAND_PONG:
-            {
-                g_pEvtManager->fireEvent("pongMessage", this, pEvent);
-                break;
-            }
-            case IRC_COMMAND_PRIVMSG:
-            {
-                g_pEvtManager->fireEvent("privmsgMessage", this, pEvent);
-                break;
-            }
-            case IRC_COMMAND_QUIT:
-            {
-                g_pEvtManager->fireEvent("quitMessage", this, pEvent);
-                break;
+
+                QChar prefix = getPrefixRule(mode.m_mode);
+                if(prefix == '\0')
+                    continue;
+
+                ChannelUser *pMember = m_state.findMember(msg.m_params[0], mode.m_param);
+                if(pMember == NULL)
+                    continue;
+
+                if(mode.m_sign)
+                    pMember->addPrefix(prefix);
+                else
+                    pMember->removePrefix(prefix);
             }
-            case IRC_COMMAND_TOPIC:
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+//-----------------------------------//
+
+// Applies the parts, kicks and quits in [msg] to the network
+// state; this is done after the message's event is fired.
+void Session::pruneNetworkState(const Message &msg)
+{
+    switch(msg.m_command)
+    {
+        case IRC_COMMAND_PART:
+        case IRC_COMMAND_KICK:
+        {
+            if(msg.m_paramsNum < 1)
+                return;
+
+            QString nick;
+            if(msg.m_command == IRC_COMMAND_KICK)
             {
-                g_pEvtManager->fireEvent("topicMessage", this, pEvent);
-                break;
+                if(msg.m_paramsNum < 2)
+                    return;
+                nick = msg.m_params[1];
             }
-            case IRC_COMMAND_WALLOPS:
+            else
             {
-                g_pEvtManager->fireEvent("wallopsMessage", this, pEvent);
-                break;
+                nick = parseMsgPrefix(msg.m_prefix, MsgPrefixName);
             }
-            default:
+
+            if(isMyNick(nick))
+                m_state.removeChannel(msg.m_params[0]);
+            else
+                m_state.removeMember(msg.m_params[0], nick);
+            m_splitUsers.remove(foldCase(nick));
+            break;
+        }
+        case IRC_COMMAND_QUIT:
+        {
+            QString nick = parseMsgPrefix(msg.m_prefix, MsgPrefixName);
+            m_state.removeUser(nick);
+            m_splitUsers.remove(foldCase(nick));
+            break;
+        }
+        case IRC_COMMAND_NICK:
+        {
+            m_splitUsers.remove(foldCase(parseMsgPrefix(msg.m_prefix, MsgPrefixName)));
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+//-----------------------------------//
+
+// Returns the kind of netsplit that [msg] is part of, if any, and sets
+// [servers] to the names of the two servers involved.
+//
+// A QUIT is part of a netsplit if its reason is the names of two
+// different servers (which networks may hide as "*.net *.split"),
+// and a JOIN is part of a netjoin if the user quit in a recent one.
+Session::SplitType Session::getSplitType(const Message &msg, QString &servers)
+{
+    static QRegExp splitRegex("([A-Za-z0-9*-]+\\.[A-Za-z0-9.*-]+) ([A-Za-z0-9*-]+\\.[A-Za-z0-9.*-]+)");
+
+    if(msg.m_command == IRC_COMMAND_QUIT)
+    {
+        if(msg.m_paramsNum < 1 || !splitRegex.exactMatch(msg.m_params[0])
+            || splitRegex.cap(1) == splitRegex.cap(2))
+        {
+            return SplitTypeNone;
+        }
+
+        servers = msg.m_params[0];
+        return SplitTypeQuit;
+    }
+    else if(msg.m_command == IRC_COMMAND_JOIN)
+    {
+        QString nick = foldCase(parseMsgPrefix(msg.m_prefix, MsgPrefixName));
+        QHash<QString, SplitUser>::iterator it = m_splitUsers.find(nick);
+        if(it == m_splitUsers.end())
+            return SplitTypeNone;
+
+        if(it->time.elapsed() > it->expireMsec)
+        {
+            m_splitUsers.erase(it);
+            return SplitTypeNone;
+        }
+
+        servers = it->servers;
+        return SplitTypeJoin;
+    }
+
+    return SplitTypeNone;
+}
+
+//-----------------------------------//
+
+// Adds the QUIT or JOIN in [msg] to the netsplit or netjoin being
+// collected, starting a new one if there isn't one.
+void Session::collectSplit(const Message &msg, SplitType type, const QString &servers)
+{
+    m_splitType = type;
+    m_splitServers = servers;
+
+    QString nick = parseMsgPrefix(msg.m_prefix, MsgPrefixName);
+    if(!m_splitNicks.contains(nick))
+        m_splitNicks.append(nick);
+
+    if(type == SplitTypeQuit)
+    {
+        // The user is only removed once the netsplit is fired.
+        IrcUser *pUser = m_state.findUser(nick);
+        if(pUser != NULL)
+        {
+            const QList<IrcChannel *> &channels = pUser->getChannels();
+            for(int i = 0; i < channels.size(); ++i)
+                m_splitChannels[foldCase(channels[i]->getName())].append(nick);
+        }
+    }
+    else if(msg.m_paramsNum > 0)
+    {
+        m_splitChannels[foldCase(msg.m_params[0])].append(nick);
+    }
+
+    m_splitTimer.start();
+}
+
+//-----------------------------------//
+
+// Fires the netsplit or netjoin being collected as one event.
+void Session::flushSplit()
+{
+    m_splitTimer.stop();
+    if(m_splitType == SplitTypeNone)
+        return;
+
+    SplitType type = m_splitType;
+    NetsplitEvent evt(m_splitServers, m_splitChannels, m_splitNicks);
+    m_splitType = SplitTypeNone;
+    m_splitChannels.clear();
+
+    if(type == SplitTypeQuit)
+    {
+        g_pEvtManager->fireEvent(m_netsplitEvt, this, evt);
+
+        // Remember who left for the netjoin, and drop the users
+        // who left in splits that are too old to rejoin from.
+        QHash<QString, SplitUser>::iterator it = m_splitUsers.begin();
+        while(it != m_splitUsers.end())
+        {
+            if(it->time.elapsed() > it->expireMsec)
+                it = m_splitUsers.erase(it);
+            else
+                ++it;
+        }
+
+        SplitUser splitUser;
+        splitUser.servers = m_splitServers;
+        splitUser.time.start();
+        splitUser.expireMsec = NETJOIN_EXPIRE_MSEC;
+        for(int i = 0; i < m_splitNicks.size(); ++i)
+        {
+            m_state.removeUser(m_splitNicks[i]);
+            m_splitUsers.insert(foldCase(m_splitNicks[i]), splitUser);
+        }
+    }
+    else
+    {
+        g_pEvtManager->fireEvent(m_netjoinEvt, this, evt);
+
+        // The users have rejoined, so any JOINs of theirs after the
+        // rest of the netjoin has arrived are ordinary joins.
+        for(int i = 0; i < m_splitNicks.size(); ++i)
+        {
+            QHash<QString, SplitUser>::iterator it = m_splitUsers.find(foldCase(m_splitNicks[i]));
+            if(it != m_splitUsers.end() && it->expireMsec != NETJOIN_REJOIN_MSEC)
             {
-                g_pEvtManager->fireEvent("unknownMessage", this, pEvent);
+                it->time.start();
+                it->expireMsec = NETJOIN_REJOIN_MSEC;
             }
         }
     }
 
-    delete pEvent;
+    m_splitServers.clear();
+    m_splitNicks.clear();
+}
+
+//-----------------------------------//
+
+// Negotiates the capabilities in SUPPORTED_CAPS with the server, which
+// is started by sending CAP LS when connecting. Servers which don't
+// support CAP ignore it, and registration goes on as usual.
+void Session::handleCap(const Message &msg)
+{
+    // msg.m_params[0]: my nick, or "*" while registering
+    // msg.m_params[1]: subcommand
+    // msg.m_params[2]: "*" if more lines follow (only for LS)
+    // msg.m_params[last]: capabilities, separated by spaces
+    if(msg.m_paramsNum < 3)
+        return;
+
+    QString subcommand = msg.m_params[1].toUpper();
+    QStringList caps = msg.m_params[msg.m_paramsNum-1].split(' ', QString::SkipEmptyParts);
+    if(subcommand == "LS")
+    {
+        for(int i = 0; i < caps.size(); ++i)
+            m_offeredCaps.append(caps[i].section('=', 0, 0));
+
+        if(msg.m_paramsNum > 3 && msg.m_params[2] == "*")
+            return;
+
+        QStringList requestedCaps;
+        for(int i = 0; i < NUM_SUPPORTED_CAPS; ++i)
+        {
+            if(m_offeredCaps.contains(SUPPORTED_CAPS[i], Qt::CaseInsensitive))
+                requestedCaps.append(SUPPORTED_CAPS[i]);
+        }
+        m_offeredCaps.clear();
+
+        if(requestedCaps.isEmpty())
+            sendData("CAP END");
+        else
+            sendData("CAP REQ :" + requestedCaps.join(" "));
+    }
+    else if(subcommand == "ACK")
+    {
+        for(int i = 0; i < caps.size(); ++i)
+        {
+            if(caps[i].startsWith('-'))
+                m_caps.removeAll(caps[i].mid(1));
+            else if(!hasCap(caps[i]))
+                m_caps.append(caps[i]);
+        }
+        sendData("CAP END");
+    }
+    else if(subcommand == "NAK")
+    {
+        sendData("CAP END");
+    }
+}
+
+//-----------------------------------//
+
+// Adds [channel] to the channels waiting to be swept with WHO,
+// unless it's already waiting or being swept.
+void Session::queueWho(const QString &channel)
+{
+    QString key = foldCase(channel);
+    if(key == m_whoChannel || m_whoQueue.contains(key))
+        return;
+
+    m_whoQueue.enqueue(key);
+    if(m_whoChannel.isEmpty() && !m_whoTimer.isActive())
+        sendNextWho();
+}
+
+//-----------------------------------//
+
+// Sends WHO for the next channel waiting to be swept,
+// unless another sweep is still in progress.
+void Session::sendNextWho()
+{
+    if(!m_whoChannel.isEmpty())
+        return;
+
+    while(!m_whoQueue.isEmpty())
+    {
+        // We may have left the channel since it was queued.
+        QString channel = m_whoQueue.dequeue();
+        if(m_state.findChannel(channel) == NULL)
+            continue;
+
+        m_whoChannel = channel;
+        if(m_hasWhox)
+            sendData(QString("WHO %1 %tcuhnfa,%2").arg(channel).arg(WHOX_TOKEN));
+        else
+            sendData(QString("WHO %1").arg(channel));
+
+        // onSendData() has just added it to the pending WHOs.
+        if(!m_pendingWhos.isEmpty())
+            m_pendingWhos.last().isSweep = true;
+        m_whoTimeoutTimer.start();
+        return;
+    }
+}
+
+//-----------------------------------//
+
+// Sweeps every channel again, for servers without away-notify.
+void Session::refreshWho()
+{
+    if(hasCap("away-notify"))
+        return;
+
+    QList<IrcChannel *> channels = m_state.getChannels();
+    for(int i = 0; i < channels.size(); ++i)
+        queueWho(channels[i]->getName());
+}
+
+//-----------------------------------//
+
+// Gives up on the sweep in progress, which hasn't been answered,
+// and moves on to the next channel.
+void Session::abandonWho()
+{
+    if(m_whoChannel.isEmpty())
+        return;
+
+    qDebug("[Session::abandonWho] No end to the WHO for %s", qPrintable(m_whoChannel));
+
+    // Anything sent before the sweep has gone unanswered too.
+    int idx = 0;
+    while(idx < m_pendingWhos.size() && !m_pendingWhos[idx].isSweep)
+        ++idx;
+    if(idx < m_pendingWhos.size())
+        m_pendingWhos.erase(m_pendingWhos.begin(), m_pendingWhos.begin() + idx + 1);
+
+    m_whoChannel.clear();
+    m_whoTimer.start();
+}
+
+//-----------------------------------//
+
+// Returns the index of the first pending WHO for [mask] (case-folded),
+// or -1 if there is none.
+int Session::findPendingWho(const QString &mask)
+{
+    for(int i = 0; i < m_pendingWhos.size(); ++i)
+    {
+        if(m_pendingWhos[i].mask == mask)
+            return i;
+    }
+
+    return -1;
+}
+
+//-----------------------------------//
+
+// Returns true if a WHO reply for [channel] belongs to our own sweep;
+// that is, if the first WHO still waiting for a reply for [channel]
+// is the sweep.
+bool Session::isWhoSweepReply(const QString &channel)
+{
+    int idx = findPendingWho(foldCase(channel));
+    return (idx >= 0 && m_pendingWhos[idx].isSweep);
+}
+
+//-----------------------------------//
+
+// Fires the "channelListBatch" event for the channels which have been
+// added to the channel list since the last batch. Unless [force] is
+// true, nothing is fired until the batch is large or old enough.
+void Session::flushChannelList(bool force)
+{
+    int count = m_channelList.size() - m_listBatchStart;
+    if(count <= 0)
+        return;
+
+    if(!force && count < LIST_BATCH_SIZE && m_listBatchTime.elapsed() < LIST_BATCH_MSEC)
+        return;
+
+    ChannelListEvent evt(&m_channelList, m_listBatchStart, count);
+    m_listBatchStart = m_channelList.size();
+    m_listBatchTime.start();
+    g_pEvtManager->fireEvent(m_channelListBatchEvt, this, evt);
+}
+
+//-----------------------------------//
+
+void Session::handle001Numeric(const Message &msg)
+{
+    // Check to make sure nickname hasn't changed; some or all servers apparently don't
+    // send you a NICK message when your nickname conflicts with another user upon
+    // first entering the server, and you try to change it.
+    if(!isMyNick(msg.m_params[0]))
+        setNick(msg.m_params[0]);
+}
+
+//-----------------------------------//
+
+void Session::handle002Numeric(const Message &msg)
+{
+    // msg.m_params[0]: my nick
+    // msg.m_params[1]: "Your host is ..."
+    QString header = "Your host is ";
+    QString hostStr = msg.m_params[1].section(',', 0, 0);
+    if(hostStr.startsWith(header))
+    {
+        setHost(hostStr.mid(header.size()));
+    }
+}
+
+//-----------------------------------//
+
+void Session::handle005Numeric(const Message &msg)
+{
+    // We only go to the second-to-last parameter, because the
+    // last parameter holds "are supported by this server".
+    for(int i = 1; i < msg.m_paramsNum-1; ++i)
+    {
+        if(msg.m_params[i].startsWith("PREFIX=", Qt::CaseInsensitive))
+        {
+            setPrefixRules(getPrefixRules(msg.m_params[i]));
+        }
+        else if(msg.m_params[i].compare("NAMESX", Qt::CaseInsensitive) == 0)
+        {
+            // Lets the server know we support multiple nick prefixes.
+            //
+            // TODO (seand): Implement UHNAMES?
+            sendData("PROTOCTL NAMESX");
+        }
+        else if(msg.m_params[i].startsWith("CHANMODES=", Qt::CaseInsensitive))
+        {
+            setChanModes(msg.m_params[i].section('=', 1));
+        }
+        else if(msg.m_params[i].compare("WHOX", Qt::CaseInsensitive) == 0)
+        {
+            m_hasWhox = true;
+        }
+        else if(msg.m_params[i].section('=', 0, 0).compare("MONITOR", Qt::CaseInsensitive) == 0)
+        {
+            // MONITOR without a limit means there isn't one.
+            bool ok;
+            int limit = msg.m_params[i].section('=', 1).toInt(&ok);
+            m_notifyList.setMonitorLimit((ok && limit > 0) ? limit : INT_MAX);
+        }
+        else if(msg.m_params[i].startsWith("MODES=", Qt::CaseInsensitive))
+        {
+            bool ok;
+            int modeNum = msg.m_params[i].section('=', 1).toInt(&ok);
+            if(ok && modeNum > 0)
+                setModeNum(modeNum);
+        }
+    }
+}
+
+//-----------------------------------//
+
+// RPL_ISON
+void Session::handle303Numeric(const Message &msg)
+{
+    // Replies to the notify list's polls aren't passed on.
+    if(!m_notifyList.handleIsonReply(msg))
+        g_pEvtManager->fireEvent(m_numericMessageEvt, this, MessageEvent(msg));
+}
+
+//-----------------------------------//
+
+// RPL_ENDOFWHO
+void Session::handle315Numeric(const Message &msg)
+{
+    // msg.m_params[0]: my nick
+    // msg.m_params[1]: mask
+    // msg.m_params[2]: "End of WHO list"
+    int idx = (msg.m_paramsNum < 2) ? -1 : findPendingWho(foldCase(msg.m_params[1]));
+    bool isSweep = (idx >= 0 && m_pendingWhos[idx].isSweep);
+
+    // Replies come in order, so the WHOs before this one have
+    // either ended already or never will.
+    if(idx >= 0)
+        m_pendingWhos.erase(m_pendingWhos.begin(), m_pendingWhos.begin() + idx + 1);
+
+    if(!isSweep)
+    {
+        g_pEvtManager->fireEvent(m_numericMessageEvt, this, MessageEvent(msg));
+        return;
+    }
+
+    // Wait a bit before the next sweep.
+    m_whoChannel.clear();
+    m_whoTimeoutTimer.stop();
+    m_whoTimer.start();
+}
+
+//-----------------------------------//
+
+// RPL_LISTSTART
+void Session::handle321Numeric(const Message &)
+{
+    m_channelList.clear();
+    m_listActive = true;
+    m_listBatchStart = 0;
+    m_listBatchTime.start();
+}
+
+//-----------------------------------//
+
+// RPL_LIST
+//
+// Replies are normally consumed by onReceiveData() while the list is
+// active; this only handles the ones it was unable to parse.
+void Session::handle322Numeric(const Message &msg)
+{
+    // msg.m_params[0]: my nick
+    // msg.m_params[1]: channel
+    // msg.m_params[2]: number of users
+    // msg.m_params[3]: topic
+    if(!m_listActive || msg.m_paramsNum < 3)
+        return;
+
+    m_channelList.append(msg.m_params[1], msg.m_params[2].toInt(),
+                         (msg.m_paramsNum > 3) ? msg.m_params[3] : QString());
+}
+
+//-----------------------------------//
+
+// RPL_LISTEND
+void Session::handle323Numeric(const Message &)
+{
+    flushChannelList(true);
+    m_listActive = false;
+}
+
+//-----------------------------------//
+
+// RPL_WHOREPLY
+void Session::handle352Numeric(const Message &msg)
+{
+    // msg.m_params[0]: my nick
+    // msg.m_params[1]: channel
+    // msg.m_params[2]: user
+    // msg.m_params[3]: host
+    // msg.m_params[4]: server
+    // msg.m_params[5]: nick
+    // msg.m_params[6]: flags ("H" if here or "G" if gone, then others)
+    // msg.m_params[7]: hop count and real name
+    //
+    // Sweeps with WHOX are answered with 354 instead, so with
+    // WHOX, this can only be a reply to the user's own WHO.
+    if(msg.m_paramsNum < 7 || m_hasWhox || !isWhoSweepReply(msg.m_params[1]))
+    {
+        g_pEvtManager->fireEvent(m_numericMessageEvt, this, MessageEvent(msg));
+        return;
+    }
+
+    m_state.setUserHost(msg.m_params[5], msg.m_params[2], msg.m_params[3]);
+    m_state.setUserAway(msg.m_params[5], msg.m_params[6].startsWith('G'));
+}
+
+//-----------------------------------//
+
+// RPL_NAMREPLY
+void Session::handle353Numeric(const Message &msg)
+{
+    // msg.m_params[0]: my nick
+    // msg.m_params[1]: "=" | "*" | "@"
+    // msg.m_params[2]: channel
+    // msg.m_params[3]: names, separated by spaces
+    if(msg.m_paramsNum < 4 || m_state.findChannel(msg.m_params[2]) == NULL)
+        return;
+
+    QStringList names = msg.m_params[3].split(' ', QString::SkipEmptyParts);
+    for(int i = 0; i < names.size(); ++i)
+        m_state.addMember(msg.m_params[2], names[i]);
+}
+
+//-----------------------------------//
+
+// RPL_WHOSPCRPL, the reply to a WHOX request
+void Session::handle354Numeric(const Message &msg)
+{
+    // For the fields requested by sendNextWho():
+    // msg.m_params[0]: my nick
+    // msg.m_params[1]: token
+    // msg.m_params[2]: channel
+    // msg.m_params[3]: user
+    // msg.m_params[4]: host
+    // msg.m_params[5]: nick
+    // msg.m_params[6]: flags ("H" if here or "G" if gone, then others)
+    // msg.m_params[7]: account, or "0" if not logged in
+    if(msg.m_paramsNum < 8 || msg.m_params[1] != WHOX_TOKEN)
+    {
+        g_pEvtManager->fireEvent(m_numericMessageEvt, this, MessageEvent(msg));
+        return;
+    }
+
+    QString nick = msg.m_params[5];
+    m_state.setUserHost(nick, msg.m_params[3], msg.m_params[4]);
+    m_state.setUserAway(nick, msg.m_params[6].startsWith('G'));
+    m_state.setUserAccount(nick, (msg.m_params[7] == "0") ? QString() : msg.m_params[7]);
+}
+
+//-----------------------------------//
+
+// RPL_INVITELIST, RPL_EXCEPTLIST and RPL_BANLIST
+void Session::handleListEntryNumeric(const Message &msg)
+{
+    // msg.m_params[0]: my nick
+    // msg.m_params[1]: channel
+    // msg.m_params[2]: mask
+    // msg.m_params[3]: who set it (optional)
+    // msg.m_params[4]: when it was set (optional)
+    if(msg.m_paramsNum >= 3)
+    {
+        ChannelListType type = (msg.m_command == 346) ? ChannelListInvite
+                             : (msg.m_command == 348) ? ChannelListExcept
+                             : ChannelListBan;
+        QString setBy = (msg.m_paramsNum > 3) ? msg.m_params[3] : QString();
+        uint setAt = (msg.m_paramsNum > 4) ? msg.m_params[4].toUInt() : 0;
+        m_state.addListEntry(msg.m_params[1], type, msg.m_params[2], setBy, setAt);
+    }
+
+    g_pEvtManager->fireEvent(m_numericMessageEvt, this, MessageEvent(msg));
+}
+
+//-----------------------------------//
+
+// RPL_ENDOFINVITELIST, RPL_ENDOFEXCEPTLIST and RPL_ENDOFBANLIST
+void Session::handleEndOfListNumeric(const Message &msg)
+{
+    // msg.m_params[0]: my nick
+    // msg.m_params[1]: channel
+    if(msg.m_paramsNum >= 2)
+    {
+        ChannelListType type = (msg.m_command == 347) ? ChannelListInvite
+                             : (msg.m_command == 349) ? ChannelListExcept
+                             : ChannelListBan;
+        m_state.endList(msg.m_params[1], type);
+    }
+
+    g_pEvtManager->fireEvent(m_numericMessageEvt, this, MessageEvent(msg));
+}
+
+//-----------------------------------//
+
+// RPL_ENDOFMOTD and ERR_NOMOTD
+void Session::handle376Numeric(const Message &msg)
+{
+    // By now the 005 numeric has told us whether
+    // MONITOR is supported.
+    m_notifyList.start();
+
+    g_pEvtManager->fireEvent(m_numericMessageEvt, this, MessageEvent(msg));
+}
+
+//-----------------------------------//
+
+// RPL_MONONLINE
+void Session::handle730Numeric(const Message &msg)
+{
+    m_notifyList.handleMonitorOnline(msg);
+}
+
+//-----------------------------------//
+
+// RPL_MONOFFLINE
+void Session::handle731Numeric(const Message &msg)
+{
+    m_notifyList.handleMonitorOffline(msg);
+}
+
+//-----------------------------------//
+
+// ERR_MONLISTFULL
+void Session::handle734Numeric(const Message &msg)
+{
+    m_notifyList.handleMonitorListFull(msg);
 }
 
 //-----------------------------------//
 
 void Session::onConnecting()
 {
-    ConnectionEvent *pEvt = new ConnectionEvent(m_host, m_port);
-    g_pEvtManager->fireEvent("connecting", this, pEvt);
-    delete pEvt;
+    g_pEvtManager->fireEvent(m_connectingEvt, this, ConnectionEvent(m_host, m_port));
 }
 
 //-----------------------------------//
@@ -387,30 +1312,52 @@ void Session::onConnecting()
 void Session::onConnect()
 {
     // TODO (seand): Use config options.
+    sendData("CAP LS");
     sendData(QString("NICK %1").arg(m_nick));
     sendData(QString("USER %1 tolmoon \"%2\" :%3").arg(m_nick).arg(m_host).arg(m_name));
 
-    ConnectionEvent *pEvt = new ConnectionEvent(m_host, m_port);
-    g_pEvtManager->fireEvent("connected", this, pEvt);
-    delete pEvt;
+    g_pEvtManager->fireEvent(m_connectedEvt, this, ConnectionEvent(m_host, m_port));
+
+    m_whoRefreshTimer.start();
 }
 
 //-----------------------------------//
 
 void Session::onFailedConnect()
 {
-    ConnectionEvent *pEvt = new ConnectionEvent(m_host, m_port, m_pConn->error());
-    g_pEvtManager->fireEvent("connectFailed", this, pEvt);
-    delete pEvt;
+    g_pEvtManager->fireEvent(m_connectFailedEvt, this, ConnectionEvent(m_host, m_port, m_pConn->error()));
 }
 
 //-----------------------------------//
 
 void Session::onDisconnect()
 {
-    ConnectionEvent *pEvt = new ConnectionEvent(m_host, m_port);
-    g_pEvtManager->fireEvent("disconnected", this, pEvt);
-    delete pEvt;
+    // Hand on whatever was received of an unfinished list.
+    flushChannelList(true);
+    m_listActive = false;
+
+    m_caps.clear();
+    m_offeredCaps.clear();
+    m_whoQueue.clear();
+    m_whoChannel.clear();
+    m_pendingWhos.clear();
+    m_whoTimer.stop();
+    m_whoRefreshTimer.stop();
+    m_whoTimeoutTimer.stop();
+    m_notifyList.stop();
+
+    // Whatever was being collected goes away with the state.
+    m_splitTimer.stop();
+    m_splitType = SplitTypeNone;
+    m_splitServers.clear();
+    m_splitChannels.clear();
+    m_splitNicks.clear();
+    m_splitUsers.clear();
+
+    g_pEvtManager->fireEvent(m_disconnectedEvt, this, ConnectionEvent(m_host, m_port));
+
+    // Windows stop displaying the state when they receive the event.
+    m_state.clear();
 }
 
 //-----------------------------------//
@@ -427,13 +1374,31 @@ void Session::onReceiveData(const QString &data)
         QString msgData = m_prevData.left(numChars);
         m_prevData.remove(0, numChars);
 
-        Event *pEvent = new DataEvent(msgData);
-        g_pEvtManager->fireEvent("receivedData", this, pEvent);
-        delete pEvent;
+        // While a list is being received, channels go straight into
+        // the channel list without being parsed into a Message or
+        // fired as events.
+        if(m_listActive)
+        {
+            QString channel, topic;
+            int numUsers;
+            if(parseListReply(msgData, channel, numUsers, topic))
+            {
+                m_channelList.append(channel, numUsers, topic);
+                continue;
+            }
+        }
+
+        if(isIgnoredLine(msgData))
+            continue;
+
+        g_pEvtManager->fireEvent(m_receivedDataEvt, this, DataEvent(msgData));
 
         Message msg = parseData(msgData);
         processMessage(msg);
     }
+
+    if(m_listActive)
+        flushChannelList(false);
 }
 
 } // End namespace
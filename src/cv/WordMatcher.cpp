@@ -0,0 +1,172 @@
+// Copyright (c) 2011 Conviersa Project. Use of this source code
+// is governed by the MIT License.
+
+#include <QQueue>
+#include "cv/WordMatcher.h"
+
+namespace cv {
+
+// Folds the case of [c] in the same way as foldCase() for ASCII
+// (so that nicks match however they're written), and as QChar
+// does for everything else.
+static ushort foldChar(QChar c)
+{
+    ushort u = c.unicode();
+    if(u >= 'A' && u <= ']')
+        return u + ('a' - 'A');
+    if(u == '~')
+        return '^';
+    if(u < 0x80)
+        return u;
+    return c.toLower().unicode();
+}
+
+//-----------------------------------//
+
+WordMatcher::WordMatcher()
+{
+    compile();
+}
+
+//-----------------------------------//
+
+// Sets the words to look for; the automaton is only rebuilt
+// if they're different from the current ones.
+void WordMatcher::setWords(const QStringList &words)
+{
+    if(words == m_words)
+        return;
+
+    m_words = words;
+    compile();
+}
+
+//-----------------------------------//
+
+// Returns the position and length of every word within [text],
+// in the order in which they end.
+QList<WordMatch> WordMatcher::findAll(const QString &text) const
+{
+    QList<WordMatch> matches;
+    scan(text, &matches);
+    return matches;
+}
+
+//-----------------------------------//
+
+void WordMatcher::compile()
+{
+    m_nodes.clear();
+    m_nodes.append(Node());
+
+    // Add each word to the trie.
+    for(int i = 0; i < m_words.size(); ++i)
+    {
+        const QString &word = m_words[i];
+        if(word.isEmpty())
+            continue;
+
+        int nodeIdx = 0;
+        for(int j = 0; j < word.size(); ++j)
+        {
+            ushort c = foldChar(word[j]);
+            int nextIdx = m_nodes[nodeIdx].next.value(c, -1);
+            if(nextIdx < 0)
+            {
+                nextIdx = m_nodes.size();
+                m_nodes[nodeIdx].next.insert(c, nextIdx);
+                m_nodes.append(Node());
+            }
+            nodeIdx = nextIdx;
+        }
+        m_nodes[nodeIdx].length = word.size();
+    }
+
+    // Link each node to its longest suffix, breadth-first so that
+    // the suffixes (which are shallower) are linked first.
+    QQueue<int> queue;
+    queue.enqueue(0);
+    while(!queue.isEmpty())
+    {
+        int nodeIdx = queue.dequeue();
+        QHash<ushort, int>::const_iterator iter = m_nodes[nodeIdx].next.constBegin();
+        for(; iter != m_nodes[nodeIdx].next.constEnd(); ++iter)
+        {
+            int childIdx = iter.value();
+            int failIdx = 0;
+            if(nodeIdx != 0)
+            {
+                int suffixIdx = m_nodes[nodeIdx].fail;
+                while(suffixIdx != 0 && !m_nodes[suffixIdx].next.contains(iter.key()))
+                    suffixIdx = m_nodes[suffixIdx].fail;
+                failIdx = m_nodes[suffixIdx].next.value(iter.key(), 0);
+            }
+
+            m_nodes[childIdx].fail = failIdx;
+            m_nodes[childIdx].output = (m_nodes[failIdx].length > 0) ? failIdx : m_nodes[failIdx].output;
+            queue.enqueue(childIdx);
+        }
+    }
+}
+
+//-----------------------------------//
+
+// Runs [text] through the automaton, adding every word found to
+// [pMatches]; if [pMatches] is NULL, it stops at the first one.
+//
+// Returns true if at least one word was found, false otherwise.
+bool WordMatcher::scan(const QString &text, QList<WordMatch> *pMatches) const
+{
+    if(isEmpty())
+        return false;
+
+    bool found = false;
+    int nodeIdx = 0;
+    for(int i = 0; i < text.size(); ++i)
+    {
+        ushort c = foldChar(text[i]);
+        int nextIdx;
+        while((nextIdx = m_nodes[nodeIdx].next.value(c, -1)) < 0 && nodeIdx != 0)
+            nodeIdx = m_nodes[nodeIdx].fail;
+        nodeIdx = qMax(nextIdx, 0);
+
+        // Words which end here only count if they aren't
+        // part of a longer word in the text.
+        if(!isBoundary(text, i + 1))
+            continue;
+
+        int outputIdx = (m_nodes[nodeIdx].length > 0) ? nodeIdx : m_nodes[nodeIdx].output;
+        for(; outputIdx >= 0; outputIdx = m_nodes[outputIdx].output)
+        {
+            int start = i - m_nodes[outputIdx].length + 1;
+            if(!isBoundary(text, start - 1))
+                continue;
+
+            if(pMatches == NULL)
+                return true;
+
+            WordMatch match;
+            match.start = start;
+            match.length = m_nodes[outputIdx].length;
+            pMatches->append(match);
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+//-----------------------------------//
+
+// Returns true if the character at [idx] can't be part of
+// a word (or [idx] is outside of [text]), false otherwise.
+bool WordMatcher::isBoundary(const QString &text, int idx)
+{
+    if(idx < 0 || idx >= text.size())
+        return true;
+
+    ushort c = text[idx].unicode();
+    return !((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'));
+}
+
+} // End namespace
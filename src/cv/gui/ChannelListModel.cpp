@@ -0,0 +1,114 @@
+// Copyright (c) 2011 Conviersa Project. Use of this source code
+// is governed by the MIT License.
+
+#include <QTextDocument>
+#include "cv/Parser.h"
+#include "cv/ChannelListStore.h"
+#include "cv/gui/ChannelListModel.h"
+
+namespace cv { namespace gui {
+
+ChannelListModel::ChannelListModel(const ChannelListStore *pStore, QObject *parent/* = NULL*/)
+    : QAbstractTableModel(parent),
+      m_pStore(pStore),
+      m_numRows(0),
+      m_displayCodes(true)
+{ }
+
+//-----------------------------------//
+
+int ChannelListModel::rowCount(const QModelIndex &parent/* = QModelIndex()*/) const
+{
+    if(parent.isValid())
+        return 0;
+
+    return m_numRows;
+}
+
+//-----------------------------------//
+
+int ChannelListModel::columnCount(const QModelIndex &parent/* = QModelIndex()*/) const
+{
+    if(parent.isValid())
+        return 0;
+
+    return 3;
+}
+
+//-----------------------------------//
+
+QVariant ChannelListModel::data(const QModelIndex &index, int role/* = Qt::DisplayRole*/) const
+{
+    // The store may have been cleared for a new list before
+    // the model has been reset, so check it as well.
+    if(!index.isValid() || index.row() >= m_numRows || index.row() >= m_pStore->size())
+        return QVariant();
+
+    if(role == Qt::DisplayRole)
+    {
+        switch(index.column())
+        {
+            case 0:
+                return m_pStore->getName(index.row());
+            case 1:
+                return m_pStore->getNumUsers(index.row());
+            case 2:
+            {
+                if(m_displayCodes)
+                    return m_pStore->getTopic(index.row());
+                return Qt::escape(stripCodes(m_pStore->getTopic(index.row())));
+            }
+        }
+    }
+    else if(role == StrippedTopicRole && index.column() == 2)
+    {
+        return stripCodes(m_pStore->getTopic(index.row()));
+    }
+
+    return QVariant();
+}
+
+//-----------------------------------//
+
+QVariant ChannelListModel::headerData(int section, Qt::Orientation orientation, int role/* = Qt::DisplayRole*/) const
+{
+    if(orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QVariant();
+
+    switch(section)
+    {
+        case 0:
+            return "Name";
+        case 1:
+            return "# Users";
+        case 2:
+            return "Topic";
+    }
+
+    return QVariant();
+}
+
+//-----------------------------------//
+
+// Makes the next [count] rows of the store visible to the view.
+void ChannelListModel::appendRows(int count)
+{
+    if(count <= 0)
+        return;
+
+    beginInsertRows(QModelIndex(), m_numRows, m_numRows + count - 1);
+    m_numRows += count;
+    endInsertRows();
+}
+
+//-----------------------------------//
+
+// Removes all the rows from the view.
+void ChannelListModel::clear()
+{
+    beginResetModel();
+    m_numRows = 0;
+    endResetModel();
+}
+
+} } // End namespaces
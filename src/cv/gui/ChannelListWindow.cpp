@@ -4,7 +4,6 @@
 #include <QVBoxLayout>
 #include <QTreeView>
 #include <QHeaderView>
-#include <QStandardItemModel>
 #include <QPushButton>
 #include <QCheckBox>
 #include <QLabel>
@@ -19,9 +18,11 @@
 #include <QMessageBox>
 #include "cv/Parser.h"
 #include "cv/Session.h"
+#include "cv/ChannelListStore.h"
 #include "cv/gui/WindowManager.h"
 #include "cv/gui/SearchBar.h"
 #include "cv/gui/ChannelListWindow.h"
+#include "cv/gui/ChannelListModel.h"
 #include "cv/gui/ChannelTopicDelegate.h"
 
 namespace cv { namespace gui {
@@ -34,21 +35,16 @@ ChannelListWindow::ChannelListWindow(Session *pSession, const QSize &size/* = QS
       m_savedMaxUsers(0)
 {
     m_pSession = pSession;
+    m_pStore = m_pSession->getChannelList();
 
     m_pVLayout = new QVBoxLayout;
     m_pView = new QTreeView(this);
-    m_pModel = new QStandardItemModel(this);
+    m_pModel = new ChannelListModel(m_pStore, this);
     m_pDelegate = new ChannelTopicDelegate(m_pView);
 
     m_pVLayout->addWidget(m_pView);
     m_pView->setModel(m_pModel);
 
-    QStringList list;
-    list.append("Name");
-    list.append("# Users");
-    list.append("Topic");
-    m_pModel->setHorizontalHeaderLabels(list);
-
     m_pView->setColumnWidth(0, 175);
     m_pView->setColumnWidth(1, 50);
     m_pView->setItemDelegateForColumn(2, m_pDelegate);
@@ -91,66 +87,20 @@ void ChannelListWindow::beginPopulatingList()
     // Reset for saving to the text file.
     m_numVisible = 0;
     m_savedTopicDisplay = (m_pTopicDisplay->checkState() == Qt::Checked);
+    m_pModel->setDisplayCodes(m_savedTopicDisplay);
 }
 
 //-----------------------------------//
 
-// Adds a channel to the QTreeWidget.
-void ChannelListWindow::addChannel(const QString &channel, const QString &numUsers, const QString &topic)
+// Makes the next [count] channels in the Session's channel
+// list visible, as one insertion into the view.
+void ChannelListWindow::addChannels(int count)
 {
     if(m_populatingList)
     {
-        QList<QStandardItem *> list;
-        list.append(new QStandardItem(channel));
-        list.append(new QStandardItem(numUsers));
-
-        QStandardItem *pItem = new QStandardItem;
-
-        QString strippedTopic = stripCodes(topic);
-        if(m_pTopicDisplay->checkState() == Qt::Checked)
-        {
-            pItem->setData(topic, Qt::DisplayRole);
-        }
-        else
-        {
-            pItem->setData(Qt::escape(strippedTopic), Qt::DisplayRole);
-        }
-        pItem->setSizeHint(QFontMetrics(m_pView->font()).size(Qt::TextSingleLine, strippedTopic));
-        list.append(pItem);
-
-        m_pModel->appendRow(list);
-        /*
-        if(m_pModel->rowCount() > 0)
-        {
-            QStandardItem *pCurrItem;
-
-            // find the position to insert
-            int rowToInsertBefore = 0;
-            while(true)
-            {
-                pCurrItem = m_pModel->item(rowToInsertBefore, 0);
-                if(!pCurrItem)
-                {
-                    m_pModel->appendRow(list);
-                    break;
-                }
-
-                if(channel.compare(pCurrItem->text(), Qt::CaseInsensitive) < 0)
-                {
-                    m_pModel->insertRow(rowToInsertBefore, list);
-                    break;
-                }
-
-                ++rowToInsertBefore;
-            }
-        }
-        else
-        {
-            m_pModel->appendRow(list);
-        }
-        */
+        m_pModel->appendRows(count);
+        m_numVisible += count;
         m_pChannelsLabel->setText(QString("%1 / %1 Channels").arg(m_pModel->rowCount()));
-        ++m_numVisible;
     }
 }
 
@@ -182,12 +132,6 @@ void ChannelListWindow::clearList()
 {
     m_pModel->clear();
 
-    QStringList list;
-    list.append("Name");
-    list.append("# Users");
-    list.append("Topic");
-    m_pModel->setHorizontalHeaderLabels(list);
-
     m_pChannelsLabel->setText("0 / 0 Channels");
     m_pSaveButton->setEnabled(false);
 }
@@ -431,7 +375,7 @@ void ChannelListWindow::performSearchIteration()
         // Make sure the number of users is within the range of the min and max
         // users first; if it isn't, we continue so the result isn't included
         // in the display.
-        int numUsers = m_pModel->item(i, 1)->text().toInt();
+        int numUsers = m_pStore->getNumUsers(i);
         if(m_savedMinUsers > 0)
         {
             if(numUsers < m_savedMinUsers)
@@ -450,15 +394,13 @@ void ChannelListWindow::performSearchIteration()
             bool containsStr = false;
             if(m_pCheckChanNames->isChecked())
             {
-                QStandardItem *pNameItem = m_pModel->item(i, 0);
-
                 if(m_pUseRegExp->checkState() == Qt::Checked)
                 {
-                    containsStr = pNameItem->text().contains(m_searchRegex);
+                    containsStr = m_pStore->getName(i).contains(m_searchRegex);
                 }
                 else
                 {
-                    containsStr = pNameItem->text().contains(m_searchStr, Qt::CaseInsensitive);
+                    containsStr = m_pStore->getName(i).contains(m_searchStr, Qt::CaseInsensitive);
                 }
             }
 
@@ -466,18 +408,14 @@ void ChannelListWindow::performSearchIteration()
             // so this short-circuits and fails.
             if(!containsStr && m_pCheckChanTopics->isChecked())
             {
-                QTextDocument doc;
-                QStandardItem *pTopicItem = m_pModel->item(i, 2);
-                doc.setHtml(pTopicItem->data(Qt::DisplayRole).toString());
-
-                bool containsStr;
+                QString topic = stripCodes(m_pStore->getTopic(i));
                 if(m_pUseRegExp->checkState() == Qt::Checked)
                 {
-                    containsStr = doc.toPlainText().contains(m_searchRegex);
+                    containsStr = topic.contains(m_searchRegex);
                 }
                 else
                 {
-                    containsStr = doc.toPlainText().contains(m_searchStr, Qt::CaseInsensitive);
+                    containsStr = topic.contains(m_searchStr, Qt::CaseInsensitive);
                 }
             }
 
@@ -585,15 +523,13 @@ void ChannelListWindow::saveList()
     // Branch at the beginning to save time, even though it means some repetitive code.
     if(m_savedTopicDisplay)
     {
-        QTextDocument doc;
         for(int i = 0; i < m_pModel->rowCount(); ++i)
         {
             if(!m_pView->isRowHidden(i, QModelIndex()))
             {
-                doc.setHtml(m_pModel->item(i, 2)->data(Qt::DisplayRole).toString());
-                out << m_pModel->item(i, 0)->text() << ' '
-                    << m_pModel->item(i, 1)->text() << ' '
-                    << doc.toPlainText() << '\n';
+                out << m_pStore->getName(i) << ' '
+                    << m_pStore->getNumUsers(i) << ' '
+                    << m_pStore->getTopic(i) << '\n';
             }
         }
     }
@@ -603,9 +539,9 @@ void ChannelListWindow::saveList()
         {
             if(!m_pView->isRowHidden(i, QModelIndex()))
             {
-                out << m_pModel->item(i, 0)->text() << ' '
-                    << m_pModel->item(i, 1)->text() << ' '
-                    << m_pModel->item(i, 2)->data(Qt::DisplayRole).toString() << '\n';
+                out << m_pStore->getName(i) << ' '
+                    << m_pStore->getNumUsers(i) << ' '
+                    << stripCodes(m_pStore->getTopic(i)) << '\n';
             }
         }
     }
@@ -1,13 +1,12 @@
 // Copyright (c) 2011 Conviersa Project. Use of this source code
 // is governed by the MIT License.
 
-#include <QTreeView>
-#include <QStandardItemModel>
 #include <QPainter>
 #include <QTextDocument>
 #include <QAbstractTextDocumentLayout>
 #include "cv/Parser.h"
 #include "cv/gui/ChannelTopicDelegate.h"
+#include "cv/gui/ChannelListModel.h"
 
 namespace cv { namespace gui {
 
@@ -48,9 +47,8 @@ void ChannelTopicDelegate::paint(QPainter *painter, const QStyleOptionViewItem &
 
 QSize ChannelTopicDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
 {
-    QTreeView *pView = dynamic_cast<QTreeView *>(parent());
-    QStandardItemModel *pModel = dynamic_cast<QStandardItemModel *>(pView->model());
-    QSize size = pModel->item(index.row(), 2)->sizeHint();
+    QString strippedTopic = index.data(ChannelListModel::StrippedTopicRole).toString();
+    QSize size = QFontMetrics(option.font).size(Qt::TextSingleLine, strippedTopic);
     size.setWidth(size.width() + 5);
     size.setHeight(size.height() + 5);
     return size;
@@ -0,0 +1,287 @@
+// Copyright (c) 2011 Conviersa Project. Use of this source code
+// is governed by the MIT License.
+
+#include <QSet>
+#include <QtAlgorithms>
+#include "cv/ChannelUser.h"
+#include "cv/Parser.h"
+#include "cv/Session.h"
+#include "cv/gui/ChannelUserModel.h"
+
+namespace cv { namespace gui {
+
+// Returns true if [entry1] comes before [entry2] in the userlist.
+static bool userListLessThan(const UserListEntry &entry1, const UserListEntry &entry2)
+{
+    if(entry1.rank != entry2.rank)
+        return (entry1.rank < entry2.rank);
+    return (entry1.nick < entry2.nick);
+}
+
+//-----------------------------------//
+
+// Returns true if [pUser1] has spoken more recently than [pUser2].
+static bool spokeMoreRecently(ChannelUser *pUser1, ChannelUser *pUser2)
+{
+    return (pUser1->getPriority() > pUser2->getPriority());
+}
+
+//-----------------------------------//
+
+ChannelUserModel::ChannelUserModel(Session *pSession, QObject *parent/* = NULL*/)
+    : QAbstractListModel(parent),
+      m_pSession(pSession),
+      m_numMessages(0)
+{ }
+
+//-----------------------------------//
+
+int ChannelUserModel::rowCount(const QModelIndex &parent/* = QModelIndex()*/) const
+{
+    if(parent.isValid())
+        return 0;
+
+    return m_users.size();
+}
+
+//-----------------------------------//
+
+QVariant ChannelUserModel::data(const QModelIndex &index, int role/* = Qt::DisplayRole*/) const
+{
+    if(!index.isValid() || index.row() >= m_users.size())
+        return QVariant();
+
+    if(role == Qt::DisplayRole)
+        return m_users[index.row()].pUser->getProperNickname();
+    else if(role == NicknameRole)
+        return m_users[index.row()].pUser->getNickname();
+
+    return QVariant();
+}
+
+//-----------------------------------//
+
+// Returns true if the user who was added with the nickname [nick] is
+// in the userlist.
+bool ChannelUserModel::hasUser(const QString &nick) const
+{
+    return m_userIndex.contains(foldCase(nick));
+}
+
+//-----------------------------------//
+
+// Adds [pUser] to the userlist in the proper place. Returns true
+// if the user was added, false if it was already there.
+bool ChannelUserModel::addUser(ChannelUser *pUser)
+{
+    UserListEntry entry = createEntry(pUser);
+    if(m_userIndex.contains(entry.nick))
+        return false;
+
+    int idx = findInsertionIndex(entry);
+    beginInsertRows(QModelIndex(), idx, idx);
+    m_users.insert(idx, entry);
+    m_userIndex.insert(entry.nick, entry);
+    m_completionIndex.insert(entry.nick, pUser);
+    endInsertRows();
+    return true;
+}
+
+//-----------------------------------//
+
+// Adds all of [users] to the userlist. Rather than inserting them one
+// at a time, the whole list is sorted once and the model is reset.
+void ChannelUserModel::addUsers(const QList<ChannelUser *> &users)
+{
+    int numUsers = m_users.size();
+    for(int i = 0; i < users.size(); ++i)
+    {
+        UserListEntry entry = createEntry(users[i]);
+        if(m_userIndex.contains(entry.nick))
+            continue;
+
+        m_users.append(entry);
+        m_userIndex.insert(entry.nick, entry);
+        m_completionIndex.insert(entry.nick, users[i]);
+    }
+
+    if(m_users.size() == numUsers)
+        return;
+
+    beginResetModel();
+    qSort(m_users.begin(), m_users.end(), userListLessThan);
+    endResetModel();
+}
+
+//-----------------------------------//
+
+// Removes the user who was added with the nickname [nick] from the
+// userlist. Returns true if the user was removed, false otherwise.
+bool ChannelUserModel::removeUser(const QString &nick)
+{
+    QHash<QString, UserListEntry>::iterator it = m_userIndex.find(foldCase(nick));
+    if(it == m_userIndex.end())
+        return false;
+
+    int idx = findRow(*it);
+    m_completionIndex.remove(it.key());
+    m_userIndex.erase(it);
+    if(idx < 0)
+        return false;
+
+    beginRemoveRows(QModelIndex(), idx, idx);
+    m_users.remove(idx);
+    endRemoveRows();
+    return true;
+}
+
+//-----------------------------------//
+
+// Removes all of [nicks] from the userlist. Rather than removing the
+// rows one at a time, the rest of the users are kept in a single pass
+// and the model is reset.
+void ChannelUserModel::removeUsers(const QStringList &nicks)
+{
+    QSet<ChannelUser *> removedUsers;
+    for(int i = 0; i < nicks.size(); ++i)
+    {
+        QHash<QString, UserListEntry>::iterator it = m_userIndex.find(foldCase(nicks[i]));
+        if(it == m_userIndex.end())
+            continue;
+
+        removedUsers.insert(it->pUser);
+        m_completionIndex.remove(it.key());
+        m_userIndex.erase(it);
+    }
+
+    if(removedUsers.isEmpty())
+        return;
+
+    beginResetModel();
+    QVector<UserListEntry> users;
+    users.reserve(m_users.size() - removedUsers.size());
+    for(int i = 0; i < m_users.size(); ++i)
+        if(!removedUsers.contains(m_users[i].pUser))
+            users.append(m_users[i]);
+    m_users = users;
+    endResetModel();
+}
+
+//-----------------------------------//
+
+// Moves [pUser], who was added with the nickname [oldNick], to the right
+// place in the userlist after its nickname or prefixes have changed.
+void ChannelUserModel::updateUser(const QString &oldNick, ChannelUser *pUser)
+{
+    QHash<QString, UserListEntry>::iterator it = m_userIndex.find(foldCase(oldNick));
+    if(it == m_userIndex.end() || it->pUser != pUser)
+        return;
+
+    int oldIdx = findRow(*it);
+    m_completionIndex.remove(it.key());
+    m_userIndex.erase(it);
+    if(oldIdx < 0)
+        return;
+
+    UserListEntry entry = createEntry(pUser);
+    m_userIndex.insert(entry.nick, entry);
+    m_completionIndex.insert(entry.nick, pUser);
+
+    // The row before which the user is moved, counting the user's current
+    // row, and the row the user ends up in once it has been taken out.
+    int destIdx = findInsertionIndex(entry);
+    int newIdx = (destIdx > oldIdx) ? destIdx - 1 : destIdx;
+
+    if(newIdx == oldIdx)
+    {
+        m_users[oldIdx] = entry;
+    }
+    else
+    {
+        beginMoveRows(QModelIndex(), oldIdx, oldIdx, QModelIndex(), destIdx);
+        m_users.remove(oldIdx);
+        m_users.insert(newIdx, entry);
+        endMoveRows();
+    }
+
+    QModelIndex changedIdx = index(newIdx);
+    emit dataChanged(changedIdx, changedIdx);
+}
+
+//-----------------------------------//
+
+// Removes all the users from the userlist.
+void ChannelUserModel::clear()
+{
+    beginResetModel();
+    m_users.clear();
+    m_userIndex.clear();
+    m_completionIndex.clear();
+    endResetModel();
+}
+
+//-----------------------------------//
+
+// Returns the nicknames of the users which start with [word], with
+// the users who have spoken most recently first, and the rest in
+// alphabetical order.
+QStringList ChannelUserModel::findCompletions(const QString &word) const
+{
+    QString key = foldCase(word);
+    QList<ChannelUser *> matches;
+    QMap<QString, ChannelUser *>::const_iterator it = m_completionIndex.lowerBound(key);
+    for(; it != m_completionIndex.constEnd() && it.key().startsWith(key); ++it)
+        matches.append(it.value());
+
+    qStableSort(matches.begin(), matches.end(), spokeMoreRecently);
+
+    QStringList nicks;
+    for(int i = 0; i < matches.size(); ++i)
+        nicks.append(matches[i]->getNickname());
+    return nicks;
+}
+
+//-----------------------------------//
+
+// Marks [pUser] as the user who has spoken most recently.
+void ChannelUserModel::setUserSpoke(ChannelUser *pUser)
+{
+    pUser->setPriority(++m_numMessages);
+}
+
+//-----------------------------------//
+
+UserListEntry ChannelUserModel::createEntry(ChannelUser *pUser)
+{
+    UserListEntry entry;
+    entry.pUser = pUser;
+    entry.rank = pUser->getPrefixRank();
+    entry.nick = foldCase(pUser->getNickname());
+    return entry;
+}
+
+//-----------------------------------//
+
+// Returns the index of the first user in the userlist which does
+// not come before [entry], using a binary search.
+int ChannelUserModel::findInsertionIndex(const UserListEntry &entry) const
+{
+    return qLowerBound(m_users.begin(), m_users.end(), entry, userListLessThan) - m_users.begin();
+}
+
+//-----------------------------------//
+
+// Returns the row of [entry], or -1 if it isn't in the userlist.
+int ChannelUserModel::findRow(const UserListEntry &entry) const
+{
+    int idx = findInsertionIndex(entry);
+    if(idx < m_users.size() && m_users[idx].pUser == entry.pUser)
+        return idx;
+
+    // Every user in the index is in the list, so the
+    // list can only have fallen out of order.
+    qDebug("[CUM::findRow] User is missing from the userlist; it is out of order");
+    return -1;
+}
+
+} } // End namespaces
@@ -2,7 +2,8 @@
 // is governed by the MIT License.
 
 #include <QAction>
-#include <QListWidget>
+#include <QDateTime>
+#include <QListView>
 #include <QSplitter>
 #include "cv/ChannelUser.h"
 #include "cv/Session.h"
@@ -10,6 +11,7 @@
 #include "cv/ConfigManager.h"
 #include "cv/gui/WindowManager.h"
 #include "cv/gui/ChannelWindow.h"
+#include "cv/gui/ChannelUserModel.h"
 #include "cv/gui/QueryWindow.h"
 #include "cv/gui/StatusWindow.h"
 #include "cv/gui/OutputControl.h"
@@ -28,15 +30,24 @@ ChannelWindow::ChannelWindow(Session *pSession,
                              const QSize &size/* = QSize(500, 300)*/)
     : InputOutputWindow(title, size),
       m_inChannel(false),
-      m_matchesIdx(-1)
+      m_matchesIdx(-1),
+      m_nickMatcherDirty(true)
 {
     m_pSession = pSession;
     m_pSharedServerConnPanel = pSharedServerConnPanel;
 
     m_pSplitter = new QSplitter(this);
-    m_pUserList = new QListWidget;
+    m_pUserModel = new ChannelUserModel(m_pSession, this);
+    m_pUserList = new QListView;
     m_pUserList->setFont(m_defaultFont);
-    QObject::connect(m_pUserList, SIGNAL(itemDoubleClicked(QListWidgetItem*)), this, SLOT(onUserDoubleClicked(QListWidgetItem*)));
+    m_pUserList->setModel(m_pUserModel);
+    m_pUserList->setUniformItemSizes(true);
+    m_pUserList->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    QObject::connect(m_pUserList, SIGNAL(doubleClicked(QModelIndex)), this, SLOT(onUserDoubleClicked(QModelIndex)));
+    QObject::connect(m_pUserModel, SIGNAL(rowsInserted(QModelIndex, int, int)), this, SLOT(invalidateNickMatcher()));
+    QObject::connect(m_pUserModel, SIGNAL(rowsRemoved(QModelIndex, int, int)), this, SLOT(invalidateNickMatcher()));
+    QObject::connect(m_pUserModel, SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SLOT(invalidateNickMatcher()));
+    QObject::connect(m_pUserModel, SIGNAL(modelReset()), this, SLOT(invalidateNickMatcher()));
 
     m_pSplitter->addWidget(m_pOutput);
     m_pSplitter->addWidget(m_pUserList);
@@ -62,36 +73,28 @@ ChannelWindow::ChannelWindow(Session *pSession,
 
     setupColors();
 
-    g_pEvtManager->hookEvent("numericMessage",  m_pSession, MakeDelegate(this, &ChannelWindow::onNumericMessage));
-    g_pEvtManager->hookEvent("joinMessage",     m_pSession, MakeDelegate(this, &ChannelWindow::onJoinMessage));
-    g_pEvtManager->hookEvent("kickMessage",     m_pSession, MakeDelegate(this, &ChannelWindow::onKickMessage));
-    g_pEvtManager->hookEvent("modeMessage",     m_pSession, MakeDelegate(this, &ChannelWindow::onModeMessage));
-    g_pEvtManager->hookEvent("noticeMessage",   m_pSession, MakeDelegate(this, &ChannelWindow::onNoticeMessage));
-    g_pEvtManager->hookEvent("nickMessage",     m_pSession, MakeDelegate(this, &ChannelWindow::onNickMessage));
-    g_pEvtManager->hookEvent("partMessage",     m_pSession, MakeDelegate(this, &ChannelWindow::onPartMessage));
-    g_pEvtManager->hookEvent("privmsgMessage",  m_pSession, MakeDelegate(this, &ChannelWindow::onPrivmsgMessage));
-    g_pEvtManager->hookEvent("topicMessage",    m_pSession, MakeDelegate(this, &ChannelWindow::onTopicMessage));
+    // Messages which are sent to the channel are only fired for this window,
+    // and notices are shown in whichever window is focused. Nick changes are
+    // passed on by the parent StatusWindow to the channels the user is in.
+    QString target = foldCase(getWindowName());
+    m_eventHandles.append(g_pEvtManager->hookEvent("joinMessage",     m_pSession, target, MakeDelegate(this, &ChannelWindow::onJoinMessage)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("kickMessage",     m_pSession, target, MakeDelegate(this, &ChannelWindow::onKickMessage)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("modeMessage",     m_pSession, target, MakeDelegate(this, &ChannelWindow::onModeMessage)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("partMessage",     m_pSession, target, MakeDelegate(this, &ChannelWindow::onPartMessage)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("privmsgMessage",  m_pSession, target, MakeDelegate(this, &ChannelWindow::onPrivmsgMessage)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("topicMessage",    m_pSession, target, MakeDelegate(this, &ChannelWindow::onTopicMessage)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("noticeMessage",   m_pSession, MakeDelegate(this, &ChannelWindow::onNoticeMessage)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("disconnected",    m_pSession, MakeDelegate(this, &ChannelWindow::onDisconnect)));
 
-    g_pEvtManager->hookEvent("configChanged", COLOR_BACKGROUND, MakeDelegate(this, &ChannelWindow::onColorConfigChanged));
-    g_pEvtManager->hookEvent("configChanged", COLOR_FOREGROUND, MakeDelegate(this, &ChannelWindow::onColorConfigChanged));
+    m_eventHandles.append(g_pEvtManager->hookEvent("configChanged", COLOR_BACKGROUND, MakeDelegate(this, &ChannelWindow::onColorConfigChanged)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("configChanged", COLOR_FOREGROUND, MakeDelegate(this, &ChannelWindow::onColorConfigChanged)));
 }
 
 //-----------------------------------//
 
 ChannelWindow::~ChannelWindow()
 {
-    g_pEvtManager->unhookEvent("numericMessage", m_pSession, MakeDelegate(this, &ChannelWindow::onNumericMessage));
-    g_pEvtManager->unhookEvent("joinMessage",    m_pSession, MakeDelegate(this, &ChannelWindow::onJoinMessage));
-    g_pEvtManager->unhookEvent("kickMessage",    m_pSession, MakeDelegate(this, &ChannelWindow::onKickMessage));
-    g_pEvtManager->unhookEvent("modeMessage",    m_pSession, MakeDelegate(this, &ChannelWindow::onModeMessage));
-    g_pEvtManager->unhookEvent("nickMessage",    m_pSession, MakeDelegate(this, &ChannelWindow::onNickMessage));
-    g_pEvtManager->unhookEvent("noticeMessage",  m_pSession, MakeDelegate(this, &ChannelWindow::onNoticeMessage));
-    g_pEvtManager->unhookEvent("partMessage",    m_pSession, MakeDelegate(this, &ChannelWindow::onPartMessage));
-    g_pEvtManager->unhookEvent("privmsgMessage", m_pSession, MakeDelegate(this, &ChannelWindow::onPrivmsgMessage));
-    g_pEvtManager->unhookEvent("topicMessage",   m_pSession, MakeDelegate(this, &ChannelWindow::onTopicMessage));
-
-    g_pEvtManager->unhookEvent("configChanged", COLOR_BACKGROUND, MakeDelegate(this, &ChannelWindow::onColorConfigChanged));
-    g_pEvtManager->unhookEvent("configChanged", COLOR_FOREGROUND, MakeDelegate(this, &ChannelWindow::onColorConfigChanged));
+    g_pEvtManager->unhookEvents(m_eventHandles);
 
     m_pSharedServerConnPanel.reset();
 }
@@ -108,7 +111,7 @@ void ChannelWindow::setupColorConfig(QMap<QString, ConfigOption> &defOptions)
 
 void ChannelWindow::setupColors()
 {
-    QString stylesheet("QListWidget { background-color: %1 } QListWidget::item { color: %2 }");
+    QString stylesheet("QListView { background-color: %1 } QListView::item { color: %2 }");
     stylesheet = stylesheet.arg(GET_STRING(COLOR_BACKGROUND))
                            .arg(GET_STRING(COLOR_FOREGROUND));
     m_pUserList->setStyleSheet(stylesheet);
@@ -116,102 +119,88 @@ void ChannelWindow::setupColors()
 
 //-----------------------------------//
 
-void ChannelWindow::onColorConfigChanged(Event *pEvent)
+void ChannelWindow::onColorConfigChanged(const ConfigEvent &evt)
 {
     setupColors();
 }
 
 //-----------------------------------//
 
-// Adds the user to the channel's userlist in the proper place.
-// [user] holds the nickname, and can include any number of prefixes,
-// as well as the user and host.
-//
-// Returns true if the user was added, false otherwise.
-bool ChannelWindow::addUser(const QString &user)
+// Removes the user with the nickname [user] from the channel's userlist,
+// where [user] is the nickname the user was displayed with. Returns true
+// if the user was removed, false otherwise.
+bool ChannelWindow::removeUser(const QString &user)
 {
-    ChannelUser *pNewUser = new ChannelUser(m_pSession, user);
-    if(!addUser(pNewUser))
-    {
-        delete pNewUser;
-        return false;
-    }
-
-    return true;
+    return m_pUserModel->removeUser(user);
 }
 
 //-----------------------------------//
 
-// Removes the user from the channel's userlist. Returns true if
-// the user was removed, false otherwise.
-bool ChannelWindow::removeUser(const QString &user)
+// Moves the user to the right place in the userlist after the
+// Session has changed their nickname from [oldNick] to [newNick].
+void ChannelWindow::changeUserNick(const QString &oldNick, const QString &newNick)
 {
-    for(int i = 0; i < m_users.size(); ++i)
-    {
-        if(user.compare(m_users[i]->getNickname(), Qt::CaseInsensitive) == 0)
-        {
-            delete m_users.takeAt(i);
-            m_pUserList->takeItem(i);
-            return true;
-        }
-    }
+    ChannelUser *pUser = findUser(newNick);
+    if(pUser == NULL)
+        return;
 
-    return false;
+    m_pUserModel->updateUser(oldNick, pUser);
 }
 
 //-----------------------------------//
 
-// Changes the user's nickname from [oldNick] to [newNick], unless
-// the user is not in the channel.
-void ChannelWindow::changeUserNick(const QString &oldNick, const QString &newNick)
+// Returns true if the joins, parts and quits of the user with the
+// prefix [prefix] should not be shown, because the user is ignored,
+// or because the smart filter is on and the user hasn't spoken in
+// the channel recently. This is checked before anything is formatted.
+bool ChannelWindow::isFilteredUser(const QString &prefix)
 {
-    ChannelUser *pNewUser = findUser(oldNick);
-    if(!pNewUser)
-        return;
+    if(m_pSession->getIgnoreList()->isIgnored(prefix, IgnoreJoins))
+        return true;
+    else if(!GET_BOOL("irc.channel.smartFilter"))
+        return false;
 
-    ChannelUser *pUser = new ChannelUser(m_pSession, newNick);
-    for(int i = 0; i < m_users.size(); ++i)
-    {
-        if(m_users[i] == pNewUser)
-        {
-            removeUser(pNewUser);
-            pNewUser->setNickname(pUser->getNickname());
-            addUser(pNewUser);
-            break;
-        }
-    }
+    QHash<QString, uint>::iterator it = m_lastSpoke.find(foldCase(parseMsgPrefix(prefix, MsgPrefixName)));
+    if(it == m_lastSpoke.end())
+        return true;
 
-    delete pUser;
+    uint expiry = *it + GET_INT("irc.channel.smartFilter.minutes") * 60;
+    if(QDateTime::currentDateTime().toTime_t() < expiry)
+        return false;
+
+    m_lastSpoke.erase(it);
+    return true;
 }
 
 //-----------------------------------//
 
-// Adds the specified prefix to the user, and updates the user list display
-// (if necessary).
-void ChannelWindow::addPrefixToUser(const QString &user, const QChar &prefixToAdd)
+// Records that [nick] has just spoken in the channel.
+void ChannelWindow::setUserSpoke(const QString &nick)
 {
-    ChannelUser *pUser = findUser(user);
-    if(pUser)
+    uint now = QDateTime::currentDateTime().toTime_t();
+    m_lastSpoke.insert(foldCase(nick), now);
+
+    // Users who spoke and then left are kept in case they come back,
+    // so every so often, forget the ones who spoke too long ago.
+    if(m_lastSpoke.size() <= 2 * getUserCount() + 64)
+        return;
+
+    uint oldest = now - GET_INT("irc.channel.smartFilter.minutes") * 60;
+    QHash<QString, uint>::iterator it = m_lastSpoke.begin();
+    while(it != m_lastSpoke.end())
     {
-        removeUser(pUser);
-        pUser->addPrefix(prefixToAdd);
-        addUser(pUser);
+        if(*it < oldest)
+            it = m_lastSpoke.erase(it);
+        else
+            ++it;
     }
 }
 
 //-----------------------------------//
 
-// Removes the specified prefix from the user, and updates the user list
-// display (if necessary) - assuming the user has the given prefix.
-void ChannelWindow::removePrefixFromUser(const QString &user, const QChar &prefixToRemove)
+int ChannelWindow::getUserCount()
 {
-    ChannelUser *pUser = findUser(user);
-    if(pUser)
-    {
-        removeUser(pUser);
-        pUser->removePrefix(prefixToRemove);
-        addUser(pUser);
-    }
+    return m_pUserModel->getUserCount();
 }
 
 //-----------------------------------//
@@ -229,90 +218,83 @@ QString ChannelWindow::fetchProperNickname(const QString &nick)
 
 //-----------------------------------//
 
-void ChannelWindow::onNumericMessage(Event *pEvent)
+// The numeric handlers below are called by the parent StatusWindow
+// for numerics that concern this channel.
+
+// RPL_TOPIC
+void ChannelWindow::handle332Numeric(const Message &msg)
 {
-    Message msg = DCAST(MessageEvent, pEvent)->getMessage();
-    switch(msg.m_command)
-    {
-        // RPL_TOPIC
-        case 332:
-        {
-            // msg.m_params[0]: my nick
-            // msg.m_params[1]: channel
-            // msg.m_params[2]: topic
-            if(isChannelName(msg.m_params[1]))
-            {
-                QString titleWithTopic = QString("%1: %2")
-                                         .arg(getWindowName())
-                                         .arg(stripCodes(msg.m_params[2]));
-                setTitle(titleWithTopic);
-
-                QString textToPrint = GET_STRING("message.332")
-                                        .arg(msg.m_params[2]);
-
-                if(m_inChannel)
-                    printOutput(textToPrint, MESSAGE_IRC_TOPIC);
-                else
-                    enqueueMessage(textToPrint, MESSAGE_IRC_TOPIC);
-            }
+    // msg.m_params[0]: my nick
+    // msg.m_params[1]: channel
+    // msg.m_params[2]: topic
+    QString titleWithTopic = QString("%1: %2")
+                             .arg(getWindowName())
+                             .arg(stripCodes(msg.m_params[2]));
+    setTitle(titleWithTopic);
 
-            break;
-        }
-        case 333:
-        {
-            // msg.m_params[0]: my nick
-            // msg.m_params[1]: channel
-            // msg.m_params[2]: nick
-            // msg.m_params[3]: unix time
-            if(isChannelName(msg.m_params[1]))
-            {
-                QString textToPrint = GET_STRING("message.333.channel")
-                                      .arg(msg.m_params[2])
-                                      .arg(getDate(msg.m_params[3]))
-                                      .arg(getTime(msg.m_params[3]));
-                if(m_inChannel)
-                    printOutput(textToPrint, MESSAGE_IRC_TOPIC);
-                else
-                    enqueueMessage(textToPrint, MESSAGE_IRC_TOPIC);
-            }
+    QString textToPrint = GET_STRING("message.332")
+                            .arg(msg.m_params[2]);
 
-            break;
-        }
-        case 353:
-        {
-            // msg.m_params[0]: my nick
-            // msg.m_params[1]: "=" | "*" | "@"
-            // msg.m_params[2]: channel
-            // msg.m_params[3]: names, separated by spaces
-            //
-            // RPL_NAMREPLY was sent as a result of a JOIN command.
-            if(!m_inChannel)
-            {
-                int numSections = msg.m_params[3].count(' ') + 1;
-                for(int i = 0; i < numSections; ++i)
-                    addUser(msg.m_params[3].section(' ', i, i, QString::SectionSkipEmpty));
-            }
-            break;
-        }
-        case 366:
-        {
-            // msg.m_params[0]: my nick
-            // msg.m_params[1]: channel
-            // msg.m_params[2]: "End of NAMES list"
-            //
-            // RPL_ENDOFNAMES was sent as a result of a JOIN command.
-            if(!m_inChannel)
-                joinChannel();
-            break;
-        }
+    if(m_inChannel)
+        printOutput(textToPrint, MESSAGE_IRC_TOPIC);
+    else
+        enqueueMessage(textToPrint, MESSAGE_IRC_TOPIC);
+}
+
+//-----------------------------------//
+
+void ChannelWindow::handle333Numeric(const Message &msg)
+{
+    // msg.m_params[0]: my nick
+    // msg.m_params[1]: channel
+    // msg.m_params[2]: nick
+    // msg.m_params[3]: unix time
+    QString textToPrint = GET_STRING("message.333.channel")
+                          .arg(msg.m_params[2])
+                          .arg(getDate(msg.m_params[3]))
+                          .arg(getTime(msg.m_params[3]));
+    if(m_inChannel)
+        printOutput(textToPrint, MESSAGE_IRC_TOPIC);
+    else
+        enqueueMessage(textToPrint, MESSAGE_IRC_TOPIC);
+}
+
+//-----------------------------------//
+
+// RPL_NAMREPLY
+void ChannelWindow::handle353Numeric(const Message &msg)
+{
+    // msg.m_params[0]: my nick
+    // msg.m_params[1]: "=" | "*" | "@"
+    // msg.m_params[2]: channel
+    // msg.m_params[3]: names, separated by spaces
+    //
+    //
+    // RPL_NAMREPLY was sent as a result of a JOIN command; the names
+    // are only looked up in the Session's network state at 366, since
+    // users might leave before then.
+    if(!m_inChannel)
+        m_pendingNames += msg.m_params[3].split(' ', QString::SkipEmptyParts);
+}
+
+//-----------------------------------//
+
+// RPL_ENDOFNAMES
+void ChannelWindow::handle366Numeric(const Message &)
+{
+    // RPL_ENDOFNAMES was sent as a result of a JOIN command.
+    if(!m_inChannel)
+    {
+        addPendingUsers();
+        joinChannel();
     }
 }
 
 //-----------------------------------//
 
-void ChannelWindow::onJoinMessage(Event *pEvent)
+void ChannelWindow::onJoinMessage(const MessageEvent &evt)
 {
-    Message msg = DCAST(MessageEvent, pEvent)->getMessage();
+    const Message &msg = evt.getMessage();
     if(isChannelName(msg.m_params[0]))
     {
         QString textToPrint;
@@ -326,11 +308,17 @@ void ChannelWindow::onJoinMessage(Event *pEvent)
         }
         else
         {
+            ChannelUser *pUser = findUser(nickJoined);
+            if(pUser != NULL)
+                m_pUserModel->addUser(pUser);
+
+            if(isFilteredUser(msg.m_prefix))
+                return;
+
             textToPrint = GET_STRING("message.join")
                           .arg(parseMsgPrefix(msg.m_prefix, MsgPrefixName))
                           .arg(parseMsgPrefix(msg.m_prefix, MsgPrefixUserAndHost))
                           .arg(msg.m_params[0]);
-            addUser(nickJoined);
         }
 
         printOutput(textToPrint, MESSAGE_IRC_JOIN);
@@ -339,9 +327,9 @@ void ChannelWindow::onJoinMessage(Event *pEvent)
 
 //-----------------------------------//
 
-void ChannelWindow::onKickMessage(Event *pEvent)
+void ChannelWindow::onKickMessage(const MessageEvent &evt)
 {
-    Message msg = DCAST(MessageEvent, pEvent)->getMessage();
+    const Message &msg = evt.getMessage();
     if(isChannelName(msg.m_params[0]))
     {
         QString textToPrint;
@@ -371,9 +359,9 @@ void ChannelWindow::onKickMessage(Event *pEvent)
 
 //-----------------------------------//
 
-void ChannelWindow::onModeMessage(Event *pEvent)
+void ChannelWindow::onModeMessage(const MessageEvent &evt)
 {
-    Message msg = DCAST(MessageEvent, pEvent)->getMessage();
+    const Message &msg = evt.getMessage();
     if(isChannelName(msg.m_params[0]))
     {
         // Ignore the first parameter.
@@ -385,65 +373,51 @@ void ChannelWindow::onModeMessage(Event *pEvent)
                                 .arg(parseMsgPrefix(msg.m_prefix, MsgPrefixName))
                                 .arg(modeParams);
 
-        bool sign = true;
-        QString modes = msg.m_params[1];
-        for(int modesIndex = 0, paramsIndex = 2; modesIndex < modes.size(); ++modesIndex)
+        // The Session has already applied the prefix changes to its
+        // network state, so parse the mode string only to find out
+        // which users have to be moved in the userlist.
+        QList<ChannelMode> modeList = parseChannelModes(m_pSession->getChanModes(), msg, m_pSession->getModeNum());
+
+        // Each affected user is moved once, no matter how
+        // many of their prefixes change.
+        QList<ChannelUser *> changedUsers;
+        for(int i = 0; i < modeList.size(); ++i)
         {
-            if(modes[modesIndex] == '+')
-            {
-                sign = true;
-            }
-            else if(modes[modesIndex] == '-')
-            {
-                sign = false;
-            }
-            else
-            {
-                ChanModeType type = getChanModeType(m_pSession->getChanModes(), modes[modesIndex]);
-                switch(type)
-                {
-                    case ModeTypeA:
-                    case ModeTypeB:
-                    case ModeTypeC:
-                    {
-                        // If there's no params left, continue.
-                        if(paramsIndex >= msg.m_paramsNum)
-                            break;
-
-                        QChar prefix = m_pSession->getPrefixRule(modes[modesIndex]);
-                        if(prefix != '\0')
-                        {
-                            if(sign)
-                                addPrefixToUser(msg.m_params[paramsIndex], prefix);
-                            else
-                                removePrefixFromUser(msg.m_params[paramsIndex], prefix);
-                        }
-
-                        ++paramsIndex;
-                        break;
-                    }
-                    default:
-                    {
-
-                    }
-                }
-            }
+            const ChannelMode &mode = modeList[i];
+            if(m_pSession->getPrefixRule(mode.m_mode) == '\0')
+                continue;
+
+            ChannelUser *pUser = findUser(mode.m_param);
+            if(pUser != NULL && !changedUsers.contains(pUser))
+                changedUsers.append(pUser);
         }
 
+        for(int i = 0; i < changedUsers.size(); ++i)
+            m_pUserModel->updateUser(changedUsers[i]->getNickname(), changedUsers[i]);
+
         printOutput(textToPrint, MESSAGE_IRC_MODE);
     }
 }
 
 //-----------------------------------//
 
-void ChannelWindow::onNickMessage(Event *pEvent)
+void ChannelWindow::onNickMessage(const MessageEvent &evt)
 {
-    Message msg = DCAST(MessageEvent, pEvent)->getMessage();
+    const Message &msg = evt.getMessage();
 
+    // The Session has already renamed the user.
     QString oldNick = parseMsgPrefix(msg.m_prefix, MsgPrefixName);
-    if(hasUser(oldNick))
+    if(hasUser(msg.m_params[0]))
     {
         changeUserNick(oldNick, msg.m_params[0]);
+
+        QHash<QString, uint>::iterator it = m_lastSpoke.find(foldCase(oldNick));
+        if(it != m_lastSpoke.end())
+        {
+            m_lastSpoke.insert(foldCase(msg.m_params[0]), *it);
+            m_lastSpoke.erase(it);
+        }
+
         QString textToPrint = GET_STRING("message.nick")
                               .arg(oldNick)
                               .arg(msg.m_params[0]);
@@ -453,19 +427,19 @@ void ChannelWindow::onNickMessage(Event *pEvent)
 
 //-----------------------------------//
 
-void ChannelWindow::onNoticeMessage(Event *pEvent)
+void ChannelWindow::onNoticeMessage(const MessageEvent &evt)
 {
     if(m_pManager->isWindowFocused(this))
     {
-        InputOutputWindow::onNoticeMessage(pEvent);
+        InputOutputWindow::onNoticeMessage(evt);
     }
 }
 
 //-----------------------------------//
 
-void ChannelWindow::onPartMessage(Event *pEvent)
+void ChannelWindow::onPartMessage(const MessageEvent &evt)
 {
-    Message msg = DCAST(MessageEvent, pEvent)->getMessage();
+    const Message &msg = evt.getMessage();
     if(isChannelName(msg.m_params[0]))
     {
         QString textToPrint;
@@ -483,6 +457,9 @@ void ChannelWindow::onPartMessage(Event *pEvent)
             // Get the nickname to display.
             QString nick = parseMsgPrefix(msg.m_prefix, MsgPrefixName);
             removeUser(nick);
+            if(isFilteredUser(msg.m_prefix))
+                return;
+
             if(GET_BOOL("irc.channel.properNickInChat"))
                 nick = fetchProperNickname(nick);
 
@@ -505,14 +482,21 @@ void ChannelWindow::onPartMessage(Event *pEvent)
 
 //-----------------------------------//
 
-void ChannelWindow::onPrivmsgMessage(Event *pEvent)
+void ChannelWindow::onPrivmsgMessage(const MessageEvent &evt)
 {
-    Message msg = DCAST(MessageEvent, pEvent)->getMessage();
+    const Message &msg = evt.getMessage();
 
     if(isChannelName(msg.m_params[0]))
     {
         // Get the nickname to display.
         QString nick = parseMsgPrefix(msg.m_prefix, MsgPrefixName);
+
+        // Whoever spoke last is completed first.
+        ChannelUser *pUser = findUser(nick);
+        if(pUser != NULL)
+            m_pUserModel->setUserSpoke(pUser);
+        setUserSpoke(nick);
+
         if(GET_BOOL("irc.channel.properNickInChat"))
             nick = fetchProperNickname(nick);
 
@@ -537,6 +521,11 @@ void ChannelWindow::onPrivmsgMessage(Event *pEvent)
                                 .arg(nick)
                                 .arg(msgText);
             }
+            else
+            {
+                // Other requests are shown (and limited) by the StatusWindow.
+                return;
+            }
         }
         else
         {
@@ -561,9 +550,9 @@ void ChannelWindow::onPrivmsgMessage(Event *pEvent)
 
 //-----------------------------------//
 
-void ChannelWindow::onTopicMessage(Event *pEvent)
+void ChannelWindow::onTopicMessage(const MessageEvent &evt)
 {
-    Message msg = DCAST(MessageEvent, pEvent)->getMessage();
+    const Message &msg = evt.getMessage();
     if(isChannelName(msg.m_params[0]))
     {
         QString textToPrint = GET_STRING("message.topic")
@@ -584,36 +573,87 @@ void ChannelWindow::onTopicMessage(Event *pEvent)
 
 //-----------------------------------//
 
-void ChannelWindow::onOutput(Event *pEvent)
+// Removes the users who quit in a netsplit all at once, and prints
+// a single line for them. This is passed on by the parent StatusWindow.
+void ChannelWindow::onNetsplit(const NetsplitEvent &evt)
+{
+    QStringList nicks = evt.getChannels().value(foldCase(getWindowName()));
+    if(nicks.isEmpty())
+        return;
+
+    m_pUserModel->removeUsers(nicks);
+
+    QString textToPrint = GET_STRING("message.netsplit")
+                            .arg(evt.getServer1())
+                            .arg(evt.getServer2())
+                            .arg(nicks.size());
+    printOutput(textToPrint, MESSAGE_IRC_QUIT);
+}
+
+//-----------------------------------//
+
+// Adds the users who joined again after a netsplit all at once, and
+// prints a single line for them. This is passed on by the parent
+// StatusWindow.
+void ChannelWindow::onNetjoin(const NetsplitEvent &evt)
 {
-    OutputEvent *pOutputEvt = DCAST(OutputEvent, pEvent);
-    for(int i = 0; i < m_users.size(); ++i)
+    QStringList nicks = evt.getChannels().value(foldCase(getWindowName()));
+    if(nicks.isEmpty())
+        return;
+
+    QList<ChannelUser *> users;
+    for(int i = 0; i < nicks.size(); ++i)
     {
-        QRegExp regex(OutputWindow::s_invalidNickPrefix
-                    + QRegExp::escape(m_users[i]->getNickname())
-                    + OutputWindow::s_invalidNickSuffix);
-        regex.setCaseSensitivity(Qt::CaseInsensitive);
-        int lastIdx = 0, idx;
-        while((idx = regex.indexIn(pOutputEvt->getText(), lastIdx)) >= 0)
-        {
-            idx += regex.capturedTexts()[1].length();
-            lastIdx = idx + m_users[i]->getNickname().length() - 1;
-            pOutputEvt->addLinkInfo(idx, lastIdx);
-        }
+        ChannelUser *pUser = findUser(nicks[i]);
+        if(pUser != NULL)
+            users.append(pUser);
     }
+    m_pUserModel->addUsers(users);
+
+    QString textToPrint = GET_STRING("message.netjoin")
+                            .arg(evt.getServer1())
+                            .arg(evt.getServer2())
+                            .arg(nicks.size());
+    printOutput(textToPrint, MESSAGE_IRC_JOIN);
 }
 
 //-----------------------------------//
 
-void ChannelWindow::onDoubleClickLink(Event *pEvent)
+// The Session clears its network state once the event has been
+// fired, so let go of the users before that happens.
+void ChannelWindow::onDisconnect(const ConnectionEvent &)
 {
-    DoubleClickLinkEvent *pDblClickLinkEvt = DCAST(DoubleClickLinkEvent, pEvent);
+    leaveChannel();
+}
+
+//-----------------------------------//
 
+// Makes links of the nicks of the users in the channel.
+void ChannelWindow::onOutput(const OutputEvent &evt)
+{
+    if(m_nickMatcherDirty)
+    {
+        QStringList nicks;
+        for(int i = 0; i < m_pUserModel->getUserCount(); ++i)
+            nicks.append(m_pUserModel->getUser(i)->getNickname());
+        m_nickMatcher.setWords(nicks);
+        m_nickMatcherDirty = false;
+    }
+
+    QList<WordMatch> matches = m_nickMatcher.findAll(evt.getText());
+    for(int i = 0; i < matches.size(); ++i)
+        evt.addLinkInfo(matches[i].start, matches[i].start + matches[i].length - 1);
+}
+
+//-----------------------------------//
+
+void ChannelWindow::onDoubleClickLink(const DoubleClickLinkEvent &evt)
+{
     // Check to see if there is a QueryWindow already open for this nick.
     Window *pParentWin = m_pManager->getWindowFromItem(m_pManager->getItemFromWindow(this)->parent());
     StatusWindow *pStatusWin = DCAST(StatusWindow, pParentWin);
 
-    OutputWindow *pQueryWin = pStatusWin->getChildIrcWindow(pDblClickLinkEvt->getText());
+    OutputWindow *pQueryWin = pStatusWin->getChildIrcWindow(evt.getText());
     if(pQueryWin != NULL)
     {
         m_pManager->setCurrentItem(m_pManager->getItemFromWindow(pQueryWin));
@@ -621,7 +661,7 @@ void ChannelWindow::onDoubleClickLink(Event *pEvent)
     }
     else
     {
-        pStatusWin->addQueryWindow(new QueryWindow(m_pSession, m_pSharedServerConnPanel, pDblClickLinkEvt->getText()), true);
+        pStatusWin->addQueryWindow(new QueryWindow(m_pSession, m_pSharedServerConnPanel, evt.getText()), true);
     }
 }
 
@@ -654,15 +694,15 @@ void ChannelWindow::joinChannel()
 
 //-----------------------------------//
 
-// Removes all the users from memory.
+// Removes all the users from the userlist; the users
+// themselves belong to the Session's network state.
 void ChannelWindow::leaveChannel()
 {
     m_inChannel = false;
-    while(m_users.size() > 0)
-    {
-        delete m_users.takeAt(0);
-        m_pUserList->takeItem(0);
-    }
+    m_pendingNames.clear();
+    m_pUserModel->clear();
+    m_autocompleteMatches.clear();
+    m_matchesIdx = -1;
 }
 
 //-----------------------------------//
@@ -725,9 +765,7 @@ void ChannelWindow::handleTab()
             return;
 
         // Find all autocomplete matches.
-        for(int i = 0; i < m_users.size(); ++i)
-            if(m_users[i]->getNickname().startsWith(word, Qt::CaseInsensitive))
-                m_autocompleteMatches.push_back(m_users[i]);
+        m_autocompleteMatches = m_pUserModel->findCompletions(word);
 
         if(m_autocompleteMatches.size() > 0)
             m_matchesIdx = 0;
@@ -742,10 +780,10 @@ void ChannelWindow::handleTab()
     if(m_matchesIdx >= 0)
     {
         m_pInput->setPlainText(m_preAutocompleteStr
-                             + m_autocompleteMatches[m_matchesIdx]->getNickname()
+                             + m_autocompleteMatches[m_matchesIdx]
                              + m_postAutocompleteStr);
         int cursorPos = m_preAutocompleteStr.length()
-                      + m_autocompleteMatches[m_matchesIdx]->getNickname().length();
+                      + m_autocompleteMatches[m_matchesIdx].length();
         QTextCursor textCursor = m_pInput->textCursor();
         textCursor.setPosition(cursorPos);
         m_pInput->setTextCursor(textCursor);
@@ -790,57 +828,20 @@ void ChannelWindow::closeEvent(QCloseEvent *event)
 
 //-----------------------------------//
 
-// Adds a ChannelUser to both the list in memory and the
-// list view which is seen by the user.
-bool ChannelWindow::addUser(ChannelUser *pNewUser)
+// Adds the users named in the 353 numerics received while joining to
+// the userlist, all at once.
+void ChannelWindow::addPendingUsers()
 {
-    QListWidgetItem *pListItem = new QListWidgetItem(pNewUser->getProperNickname());
-    for(int i = 0; i < m_users.size(); ++i)
+    QList<ChannelUser *> users;
+    for(int i = 0; i < m_pendingNames.size(); ++i)
     {
-        int compareVal = m_pSession->compareNickPrefixes(m_users[i]->getPrefix(), pNewUser->getPrefix());
-        if(compareVal > 0)
-        {
-            m_pUserList->insertItem(i, pListItem);
-            m_users.insert(i, pNewUser);
-            return true;
-        }
-        else if(compareVal == 0)
-        {
-            compareVal = QString::compare(m_users[i]->getNickname(), pNewUser->getNickname(), Qt::CaseInsensitive);
-            if(compareVal > 0)
-            {
-                m_pUserList->insertItem(i, pListItem);
-                m_users.insert(i, pNewUser);
-                return true;
-            }
-            else if(compareVal == 0)
-            {
-                // The user is already in the list.
-                return false;
-            }
-        }
+        ChannelUser *pUser = findUser(m_pendingNames[i]);
+        if(pUser != NULL)
+            users.append(pUser);
     }
+    m_pendingNames.clear();
 
-    m_pUserList->addItem(pListItem);
-    m_users.append(pNewUser);
-    return true;
-}
-
-//-----------------------------------//
-
-// Removes a ChannelUser from both the list in memory and the
-// list view which is seen by the user.
-void ChannelWindow::removeUser(ChannelUser *pUser)
-{
-    for(int i = 0; i < m_users.size(); ++i)
-    {
-        if(m_users[i] == pUser)
-        {
-            delete m_pUserList->takeItem(i);
-            m_users.removeAt(i);
-            break;
-        }
-    }
+    m_pUserModel->addUsers(users);
 }
 
 //-----------------------------------//
@@ -848,31 +849,31 @@ void ChannelWindow::removeUser(ChannelUser *pUser)
 // Finds the user within the channel, based on nickname
 // (regardless if there are prefixes or a user/host in it).
 //
-// Returns a pointer to the Channeluser if found in the channel,
+// Returns a pointer to the ChannelUser if found in the channel,
 // NULL otherwise.
 ChannelUser *ChannelWindow::findUser(const QString &user)
 {
-    ChannelUser ircChanUser(m_pSession, user);
-    for(int i = 0; i < m_users.size(); ++i)
-        if(QString::compare(m_users[i]->getNickname(), ircChanUser.getNickname(), Qt::CaseInsensitive) == 0)
-            return m_users[i];
+    NetworkState *pState = m_pSession->getNetworkState();
+    return pState->findMember(getWindowName(), pState->parseNick(user));
+}
+
+//-----------------------------------//
 
-    return NULL;
+void ChannelWindow::onUserDoubleClicked(const QModelIndex &index)
+{
+    QString nick = index.data(ChannelUserModel::NicknameRole).toString();
+    if(!nick.isEmpty() && !m_pSession->isMyNick(nick))
+        g_pEvtManager->fireEvent("doubleClickedLink", m_pOutput, DoubleClickLinkEvent(nick));
 }
 
 //-----------------------------------//
 
-void ChannelWindow::onUserDoubleClicked(QListWidgetItem *pItem)
+// Called whenever the userlist changes; the nick matcher is rebuilt
+// when the next line is printed rather than once per change, since
+// the userlist can change many times between two lines.
+void ChannelWindow::invalidateNickMatcher()
 {
-    for(int i = 0; i < m_users.size(); ++i)
-        if(m_users[i]->getProperNickname().compare(pItem->text()) == 0
-        && !m_pSession->isMyNick(m_users[i]->getNickname()))
-        {
-            DoubleClickLinkEvent *pEvt = new DoubleClickLinkEvent(m_users[i]->getNickname());
-            g_pEvtManager->fireEvent("doubleClickedLink", m_pOutput, pEvt);
-            delete pEvt;
-            break;
-        }
+    m_nickMatcherDirty = true;
 }
 
 } } // End namespaces
@@ -3,7 +3,9 @@
 
 #include <QFile>
 #include <QTimer>
+#include <QCoreApplication>
 #include "cv/ConfigManager.h"
+#include "cv/PluginManager.h"
 #include "cv/gui/Client.h"
 #include "cv/gui/WindowManager.h"
 #include "cv/gui/AltWindowContainer.h"
@@ -49,12 +51,18 @@ Client::Client(const QString &title)
 
     // Create a StatusWindow on client start.
     onNewIrcServerWindow();
+
+    // Plugins are loaded last, so that the events
+    // they hook have already been created.
+    m_pPluginManager = new PluginManager;
+    m_pPluginManager->loadPlugins(QCoreApplication::applicationDirPath() + "/plugins");
 }
 
 //-----------------------------------//
 
 Client::~Client()
 {
+    delete m_pPluginManager;
     delete g_pCfgManager;
     delete g_pEvtManager;
 }
@@ -86,9 +94,9 @@ void Client::resizeEvent(QResizeEvent *)
 void Client::setupEvents()
 {
     g_pEvtManager = new EventManager;
-    g_pEvtManager->createEvent("input");
-    g_pEvtManager->createEvent("output");
-    g_pEvtManager->createEvent("doubleClickedLink");
+    g_pEvtManager->createEvent<InputEvent>("input");
+    g_pEvtManager->createEvent<OutputEvent>("output");
+    g_pEvtManager->createEvent<DoubleClickLinkEvent>("doubleClickedLink");
 }
 
 //-----------------------------------//
@@ -169,6 +177,7 @@ void Client::setupMessagesConfig(QMap<QString, ConfigOption> &defOptions)
     // Regular messages
     defOptions.insert("message.action",        ConfigOption("* %1 %2"));
     defOptions.insert("message.ctcp",          ConfigOption("[CTCP %1 (from %2)]"));
+    defOptions.insert("message.ctcp.dropped",  ConfigOption("* Ignored %1 CTCP request(s) (%2) from %3 source(s)"));
     defOptions.insert("message.connecting",    ConfigOption("* Connecting to %1 (%2)"));
     defOptions.insert("message.connectFailed", ConfigOption("* Failed to connect to server (%1)"));
     defOptions.insert("message.disconnected",  ConfigOption("* Disconnected"));
@@ -179,8 +188,12 @@ void Client::setupMessagesConfig(QMap<QString, ConfigOption> &defOptions)
     defOptions.insert("message.kick.self",     ConfigOption("* You were kicked by %1"));
     defOptions.insert("message.rejoin",        ConfigOption("* You have rejoined %1"));
     defOptions.insert("message.mode",          ConfigOption("* %1 has set mode: %2"));
+    defOptions.insert("message.netjoin",       ConfigOption("* Netjoin: %1 <-> %2 (%3 users)"));
+    defOptions.insert("message.netsplit",      ConfigOption("* Netsplit: %1 <-> %2 (%3 users)"));
     defOptions.insert("message.nick",          ConfigOption("* %1 is now known as %2"));
     defOptions.insert("message.notice",        ConfigOption("-%1- %2"));
+    defOptions.insert("message.notify.online", ConfigOption("* %1 is online"));
+    defOptions.insert("message.notify.offline", ConfigOption("* %1 is offline"));
     defOptions.insert("message.part",          ConfigOption("* %1 (%2) has left %3"));
     defOptions.insert("message.part.self",     ConfigOption("* You have left %1"));
     defOptions.insert("message.pong",          ConfigOption("* PONG from %1: %2"));
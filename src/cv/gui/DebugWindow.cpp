@@ -17,35 +17,34 @@ DebugWindow::DebugWindow(Session *pSession,
     m_pVLayout->setContentsMargins(2, 2, 2, 2);
     setLayout(m_pVLayout);
 
-    g_pEvtManager->hookEvent("sendData", m_pSession, MakeDelegate(this, &DebugWindow::onSendData));
-    g_pEvtManager->hookEvent("receivedData", m_pSession, MakeDelegate(this, &DebugWindow::onReceivedData));
+    m_eventHandles.append(g_pEvtManager->hookEvent("sendData", m_pSession, MakeDelegate(this, &DebugWindow::onSendData)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("receivedData", m_pSession, MakeDelegate(this, &DebugWindow::onReceivedData)));
 }
 
 //-----------------------------------//
 
 DebugWindow::~DebugWindow()
 {
-    g_pEvtManager->unhookEvent("sendData", m_pSession, MakeDelegate(this, &DebugWindow::onSendData));
-    g_pEvtManager->unhookEvent("receivedData", m_pSession, MakeDelegate(this, &DebugWindow::onReceivedData));
+    g_pEvtManager->unhookEvents(m_eventHandles);
 }
 
 //-----------------------------------//
 
-void DebugWindow::onSendData(Event *pEvt)
+void DebugWindow::onSendData(const DataEvent &evt)
 {
-    printOutput("<- " + DCAST(DataEvent, pEvt)->getData(), MESSAGE_INFO, COLOR_NONE, 1);
+    printOutput("<- " + evt.getData(), MESSAGE_INFO, COLOR_NONE, 1);
 }
 
 //-----------------------------------//
 
-void DebugWindow::onReceivedData(Event *pEvt)
+void DebugWindow::onReceivedData(const DataEvent &evt)
 {
-    printOutput("-> " + DCAST(DataEvent, pEvt)->getData().trimmed(), MESSAGE_INFO, COLOR_NONE, 1);
+    printOutput("-> " + evt.getData().trimmed(), MESSAGE_INFO, COLOR_NONE, 1);
 }
 
 //-----------------------------------//
 
-void DebugWindow::onOutput(Event *) { }
-void DebugWindow::onDoubleClickLink(Event *) { }
+void DebugWindow::onOutput(const OutputEvent &) { }
+void DebugWindow::onDoubleClickLink(const DoubleClickLinkEvent &) { }
 
 } } // End namespaces
@@ -4,7 +4,10 @@
 #include <QApplication>
 #include <QPushButton>
 #include <QFont>
+#include <QFile>
+#include "json.h"
 #include "cv/Session.h"
+#include "cv/ChannelUser.h"
 #include "cv/ConfigManager.h"
 #include "cv/EventManager.h"
 #include "cv/gui/InputOutputWindow.h"
@@ -29,9 +32,9 @@ InputOutputWindow::InputOutputWindow(const QString &title/* = tr("Untitled")*/,
     setFocusProxy(m_pInput);
     m_pOutput->setFocusProxy(m_pInput);
 
-    g_pEvtManager->hookEvent("input", m_pInput, MakeDelegate(this, &InputOutputWindow::onInput));
-    g_pEvtManager->hookEvent("configChanged", COLOR_BACKGROUND, MakeDelegate(this, &InputOutputWindow::onColorConfigChanged));
-    g_pEvtManager->hookEvent("configChanged", COLOR_FOREGROUND, MakeDelegate(this, &InputOutputWindow::onColorConfigChanged));
+    m_eventHandles.append(g_pEvtManager->hookEvent("input", m_pInput, MakeDelegate(this, &InputOutputWindow::onInput)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("configChanged", COLOR_BACKGROUND, MakeDelegate(this, &InputOutputWindow::onColorConfigChanged)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("configChanged", COLOR_FOREGROUND, MakeDelegate(this, &InputOutputWindow::onColorConfigChanged)));
     setupColors();
 }
 
@@ -39,9 +42,7 @@ InputOutputWindow::InputOutputWindow(const QString &title/* = tr("Untitled")*/,
 
 InputOutputWindow::~InputOutputWindow()
 {
-    g_pEvtManager->unhookEvent("input", m_pInput, MakeDelegate(this, &InputOutputWindow::onInput));
-    g_pEvtManager->unhookEvent("configChanged", COLOR_BACKGROUND, MakeDelegate(this, &InputOutputWindow::onColorConfigChanged));
-    g_pEvtManager->unhookEvent("configChanged", COLOR_FOREGROUND, MakeDelegate(this, &InputOutputWindow::onColorConfigChanged));
+    g_pEvtManager->unhookEvents(m_eventHandles);
 }
 
 //-----------------------------------//
@@ -64,7 +65,7 @@ void InputOutputWindow::setupColors()
 
 //-----------------------------------//
 
-void InputOutputWindow::onColorConfigChanged(Event *)
+void InputOutputWindow::onColorConfigChanged(const ConfigEvent &)
 {
     setupColors();
 }
@@ -82,11 +83,10 @@ void InputOutputWindow::giveFocus()
 //-----------------------------------//
 
 // Handles the input for the window.
-void InputOutputWindow::onInput(Event *pEvent)
+void InputOutputWindow::onInput(const InputEvent &evt)
 {
     // TODO (seand): Change this when colors are added.
-    InputEvent *inputEvt = DCAST(InputEvent, pEvent);
-    QString text = inputEvt->getInput();
+    QString text = evt.getInput();
 
     // TODO (seand): Should we make the '/' configurable?
     //
@@ -164,6 +164,167 @@ void InputOutputWindow::onInput(Event *pEvent)
         DebugWindow *pDebugWin = new DebugWindow(m_pSession);
         m_pManager->addWindow(pDebugWin, m_pManager->getItemFromWindow(pParentWin), true);
     }
+    // Current format: /eventstats [on|off|reset|save <file>]
+    else if(text.compare("/eventstats", Qt::CaseInsensitive) == 0
+         || text.startsWith("/eventstats ", Qt::CaseInsensitive))
+    {
+        QString action = text.section(' ', 1, 1, QString::SectionSkipEmpty);
+        if(action.compare("on", Qt::CaseInsensitive) == 0)
+        {
+            g_pEvtManager->setProfiling(true);
+            printOutput("Event profiling is on.", MESSAGE_INFO);
+        }
+        else if(action.compare("off", Qt::CaseInsensitive) == 0)
+        {
+            g_pEvtManager->setProfiling(false);
+            printOutput("Event profiling is off.", MESSAGE_INFO);
+        }
+        else if(action.compare("reset", Qt::CaseInsensitive) == 0)
+        {
+            g_pEvtManager->clearProfiler();
+            printOutput("Event profiling stats have been reset.", MESSAGE_INFO);
+        }
+        else if(action.compare("save", Qt::CaseInsensitive) == 0)
+        {
+            QString filename = text.section(' ', 2, -1, QString::SectionSkipEmpty);
+            QFile file(filename);
+            if(filename.isEmpty() || !file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate))
+            {
+                printError(QString("Could not write event stats to \"%1\".").arg(filename));
+                return;
+            }
+
+            file.write(QtJson::Json::serialize(g_pEvtManager->getProfiler().toVariant(*g_pEvtManager)));
+            printOutput(QString("Saved event stats to \"%1\".").arg(filename), MESSAGE_INFO);
+        }
+        else
+        {
+            EventProfiler profiler = g_pEvtManager->getProfiler();
+            if(profiler.isEmpty())
+            {
+                printOutput(g_pEvtManager->isProfiling()
+                              ? "No events have been fired since profiling was turned on."
+                              : "Event profiling is off; use \"/eventstats on\" to turn it on.",
+                            MESSAGE_INFO);
+                return;
+            }
+
+            QStringList lines = profiler.getSummary(*g_pEvtManager);
+            for(int i = 0; i < lines.size(); ++i)
+                printOutput(lines[i], MESSAGE_INFO);
+        }
+    }
+    // Current format: /ignore [<mask> [msgs,notices,ctcp,joins|all]]
+    else if(text.compare("/ignore", Qt::CaseInsensitive) == 0
+         || text.startsWith("/ignore ", Qt::CaseInsensitive))
+    {
+        QString mask = text.section(' ', 1, 1, QString::SectionSkipEmpty);
+        QVariantList ignoreList = GET_LIST("irc.ignore");
+        if(mask.isEmpty())
+        {
+            if(ignoreList.isEmpty())
+                printOutput("No one is being ignored.", MESSAGE_INFO);
+            for(int i = 0; i < ignoreList.size(); ++i)
+                printOutput("Ignoring " + ignoreList[i].toString(), MESSAGE_INFO);
+            return;
+        }
+
+        int types = IgnoreList::parseTypes(text.section(' ', 2, 2, QString::SectionSkipEmpty));
+        if(types == 0)
+        {
+            printError("Ignore types must be msgs, notices, ctcp, joins or all.");
+            return;
+        }
+
+        // Replace any entry that's already there for the mask.
+        QString entry = mask + ' ' + IgnoreList::typesToString(types);
+        for(int i = 0; i < ignoreList.size(); ++i)
+        {
+            if(ignoreList[i].toString().section(' ', 0, 0).compare(mask, Qt::CaseInsensitive) == 0)
+                ignoreList.removeAt(i--);
+        }
+        ignoreList.append(entry);
+        g_pCfgManager->setOptionValue("irc.ignore", ignoreList, true);
+        printOutput("Ignoring " + entry, MESSAGE_INFO);
+    }
+    // Current format: /unignore <mask>
+    else if(text.startsWith("/unignore ", Qt::CaseInsensitive))
+    {
+        QString mask = text.section(' ', 1, 1, QString::SectionSkipEmpty);
+        QVariantList ignoreList = GET_LIST("irc.ignore");
+        int numEntries = ignoreList.size();
+        for(int i = 0; i < ignoreList.size(); ++i)
+        {
+            if(ignoreList[i].toString().section(' ', 0, 0).compare(mask, Qt::CaseInsensitive) == 0)
+                ignoreList.removeAt(i--);
+        }
+
+        if(ignoreList.size() == numEntries)
+        {
+            printError(QString("%1 is not being ignored.").arg(mask));
+            return;
+        }
+
+        g_pCfgManager->setOptionValue("irc.ignore", ignoreList, true);
+        printOutput(QString("No longer ignoring %1").arg(mask), MESSAGE_INFO);
+    }
+    // Current format: /bantest <mask>
+    //
+    // Shows which users in the channel the mask would affect.
+    else if(text.startsWith("/bantest ", Qt::CaseInsensitive))
+    {
+        NetworkState *pState = m_pSession->getNetworkState();
+        if(pState->findChannel(getWindowName()) == NULL)
+        {
+            printError("/bantest can only be used in a channel.");
+            return;
+        }
+
+        QString mask = text.section(' ', 1, 1, QString::SectionSkipEmpty);
+        QList<ChannelUser *> matches = pState->findMatchingMembers(getWindowName(), Mask(mask));
+        QStringList nicks;
+        for(int i = 0; i < matches.size(); ++i)
+            nicks.append(matches[i]->getNickname());
+        nicks.sort();
+
+        printOutput(QString("%1 matches %2 user(s): %3")
+                      .arg(mask)
+                      .arg(nicks.size())
+                      .arg(nicks.join(" ")),
+                    MESSAGE_INFO);
+    }
+    // Current format: /bans
+    //
+    // Shows the channel's cached ban list, and how many of
+    // the users in the channel each ban affects.
+    else if(text.compare("/bans", Qt::CaseInsensitive) == 0)
+    {
+        NetworkState *pState = m_pSession->getNetworkState();
+        IrcChannel *pChannel = pState->findChannel(getWindowName());
+        if(pChannel == NULL)
+        {
+            printError("/bans can only be used in a channel.");
+            return;
+        }
+        else if(!pChannel->hasList(ChannelListBan))
+        {
+            printOutput(QString("The ban list hasn't been received; use \"/mode %1 +b\" to get it.")
+                          .arg(pChannel->getName()),
+                        MESSAGE_INFO);
+            return;
+        }
+
+        const QList<ChannelListEntry> &bans = pChannel->getList(ChannelListBan);
+        QList<int> counts = pState->countMatchingMembers(pChannel->getName(), ChannelListBan);
+        for(int i = 0; i < bans.size(); ++i)
+        {
+            printOutput(QString("%1 (set by %2) matches %3 user(s)")
+                          .arg(bans[i].mask.getMask())
+                          .arg(bans[i].setBy)
+                          .arg(counts[i]),
+                        MESSAGE_INFO);
+        }
+    }
     else    // Commands that interact with the server.
     {
         if(!m_pSession->isConnected())
@@ -226,9 +387,9 @@ void InputOutputWindow::onInput(Event *pEvent)
 
 //-----------------------------------//
 
-void InputOutputWindow::onNoticeMessage(Event *pEvent)
+void InputOutputWindow::onNoticeMessage(const MessageEvent &evt)
 {
-    Message msg = DCAST(MessageEvent, pEvent)->getMessage();
+    const Message &msg = evt.getMessage();
     QString source;
     if(!msg.m_prefix.isEmpty())
         source = parseMsgPrefix(msg.m_prefix, MsgPrefixName);
@@ -276,9 +437,7 @@ bool InputOutputWindow::eventFilter(QObject *obj, QEvent *event)
                 m_pastCommands.append(text);
                 m_pInput->clear();
 
-                InputEvent *inputEvt = new InputEvent(this, m_pSession, text);
-                g_pEvtManager->fireEvent("input", m_pInput, inputEvt);
-                delete inputEvt;
+                g_pEvtManager->fireEvent("input", m_pInput, InputEvent(this, m_pSession, text));
 
                 return true;
             }
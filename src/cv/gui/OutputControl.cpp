@@ -95,15 +95,16 @@ OutputControl::OutputControl(QWidget *parent/*= NULL*/)
 
     // Set pointers for the blocks of memory.
     m_pFM = m_fmBlock;
-    m_pEvt = m_evtBlock;
+
+    m_outputEvt = g_pEvtManager->getEventId("output");
 
     setupColors();
-    g_pEvtManager->hookGlobalEvent("configChanged", STRING_EVENT, MakeDelegate(this, &OutputControl::onConfigChanged));
+    m_configChangedHandle = g_pEvtManager->hookGlobalEvent("configChanged", MakeDelegate(this, &OutputControl::onConfigChanged));
 }
 
 OutputControl::~OutputControl()
 {
-    g_pEvtManager->unhookGlobalEvent("configChanged", STRING_EVENT, MakeDelegate(this, &OutputControl::onConfigChanged));
+    g_pEvtManager->unhookEvent(m_configChangedHandle);
 }
 
 //-----------------------------------//
@@ -173,10 +174,9 @@ void OutputControl::setupColors()
 
 //-----------------------------------//
 
-void OutputControl::onConfigChanged(Event *pEvent)
+void OutputControl::onConfigChanged(const ConfigEvent &evt)
 {
-    ConfigEvent *pCfgEvent = DCAST(ConfigEvent, pEvent);
-    QString optName = pCfgEvent->getName();
+    QString optName = evt.getName();
 
     for(int i = 0; i < COLOR_NUM; ++i)
     {
@@ -184,9 +184,9 @@ void OutputControl::onConfigChanged(Event *pEvent)
         {
             // If it's the background color, we also need to set it in the QSS.
             if(i == COLOR_CHAT_BACKGROUND)
-                setStyleSheet(QString("cv--gui--OutputControl { background-color: %1 }").arg(pCfgEvent->getString()));
+                setStyleSheet(QString("cv--gui--OutputControl { background-color: %1 }").arg(evt.getString()));
 
-            m_colorsArr[i] = QColor(pCfgEvent->getColor());
+            m_colorsArr[i] = QColor(evt.getColor());
             viewport()->update();
             break;
         }
@@ -407,8 +407,8 @@ void OutputControl::appendMessage(const QString &msg, OutputColor defaultMsgColo
 
     // Fire the "output" event for callbacks to use for adding links
     // to the text.
-    OutputEvent *pEvent = new(m_pEvt) OutputEvent(line.text());
-    g_pEvtManager->fireEvent("output", this, pEvent);
+    OutputEvent evt(line.text());
+    g_pEvtManager->fireEvent(m_outputEvt, this, evt);
 
     // Iterate through the OutputEvent to add the links given the LinkInfo.
     QList<LinkInfo>::const_iterator iter;
@@ -418,7 +418,7 @@ void OutputControl::appendMessage(const QString &msg, OutputColor defaultMsgColo
     Link *prevLink = NULL;
     currTextRunIdx = 0;
     currTextRun = line.firstTextRun();
-    for(iter = pEvent->getLinkInfoList().begin(); iter != pEvent->getLinkInfoList().end(); ++iter)
+    for(iter = evt.getLinkInfoList().begin(); iter != evt.getLinkInfoList().end(); ++iter)
     {
         int width = 0;
         LinkInfo linkInfo = *iter;
@@ -453,7 +453,6 @@ void OutputControl::appendMessage(const QString &msg, OutputColor defaultMsgColo
         prevLink = link;
     }
     fm->~QFontMetrics();
-    pEvent->~OutputEvent();
 
     appendLine(line);
 }
@@ -1607,9 +1606,7 @@ void OutputControl::mouseDoubleClickEvent(QMouseEvent *event)
     if(linkHitTest(event->pos().x(), event->pos().y(), lineIdx, link))
     {
         QString text = m_lines[lineIdx].text().mid(link->getStartIdx(), link->getEndIdx() - link->getStartIdx() + 1);
-        DoubleClickLinkEvent *pEvent = new DoubleClickLinkEvent(text);
-        g_pEvtManager->fireEvent("doubleClickedLink", this, pEvent);
-        delete pEvent;
+        g_pEvtManager->fireEvent("doubleClickedLink", this, DoubleClickLinkEvent(text));
     }
 }
 
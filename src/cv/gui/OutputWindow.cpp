@@ -19,15 +19,6 @@
 
 namespace cv { namespace gui {
 
-/*
-QString OutputWindow::s_invalidNickPrefix = "(^|[^A-z\\{\\|\\}])(";
-QString OutputWindow::s_invalidNickSuffix = ")($|[^0-9A-z\\{\\|\\}\\-])";
-*/
-QString OutputWindow::s_invalidNickPrefix = "(^|[^A-Za-z0-9])(";
-QString OutputWindow::s_invalidNickSuffix = ")($|[^A-Za-z0-9])";
-
-//-----------------------------------//
-
 OutputWindow::OutputWindow(const QString &title/* = tr("Untitled")*/,
                            const QSize &size/* = QSize(500, 300)*/)
     : Window(title, size),
@@ -47,8 +38,8 @@ OutputWindow::OutputWindow(const QString &title/* = tr("Untitled")*/,
     m_pOutput->setVerticalScrollBar(m_pScrollBar);
     */
     m_pOutput = new OutputControl;
-    g_pEvtManager->hookEvent("output", m_pOutput, MakeDelegate(this, &OutputWindow::onOutput));
-    g_pEvtManager->hookEvent("doubleClickedLink", m_pOutput, MakeDelegate(this, &OutputWindow::onDoubleClickLink));
+    m_eventHandles.append(g_pEvtManager->hookEvent("output", m_pOutput, MakeDelegate(this, &OutputWindow::onOutput)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("doubleClickedLink", m_pOutput, MakeDelegate(this, &OutputWindow::onDoubleClickLink)));
     //m_pOutput->setParentWindow(this);
 }
 
@@ -56,8 +47,7 @@ OutputWindow::OutputWindow(const QString &title/* = tr("Untitled")*/,
 
 OutputWindow::~OutputWindow()
 {
-    g_pEvtManager->unhookEvent("output", m_pOutput, MakeDelegate(this, &OutputWindow::onOutput));
-    g_pEvtManager->unhookEvent("doubleClickedLink", m_pOutput, MakeDelegate(this, &OutputWindow::onDoubleClickLink));
+    g_pEvtManager->unhookEvents(m_eventHandles);
 }
 
 //-----------------------------------//
@@ -196,14 +186,11 @@ void OutputWindow::printDebug(const QString &text)
 
 //-----------------------------------//
 
-// Returns true if the user's nick is within the provided text, false otherwise.
+// Returns true if the user's nick (or one of the other words which
+// highlight messages) is within the provided text, false otherwise.
 bool OutputWindow::containsNick(const QString &text)
 {
-    QRegExp regex(OutputWindow::s_invalidNickPrefix
-                + QRegExp::escape(m_pSession->getNick())
-                + OutputWindow::s_invalidNickSuffix);
-    regex.setCaseSensitivity(Qt::CaseInsensitive);
-    return text.contains(regex);
+    return m_pSession->isHighlight(text);
 }
 
 //-----------------------------------//
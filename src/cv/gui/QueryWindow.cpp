@@ -20,6 +20,7 @@ QueryWindow::QueryWindow(Session *pSession,
     m_pSession = pSession;
     m_pSharedServerConnPanel = pSharedServerConnPanel;
     m_targetNick = targetNick;
+    m_nickMatcher.setWords(QStringList(targetNick));
 
     m_pVLayout->addWidget(m_pOutput);
     m_pVLayout->addWidget(m_pInput);
@@ -30,20 +31,17 @@ QueryWindow::QueryWindow(Session *pSession,
     m_pOpenButton = m_pSharedServerConnPanel->addOpenButton(m_pOutput, "Connect", 80, 30);
     m_pOutput->installEventFilter(this);
 
-    g_pEvtManager->hookEvent("numericMessage", m_pSession, MakeDelegate(this, &QueryWindow::onNumericMessage));
-    g_pEvtManager->hookEvent("nickMessage",    m_pSession, MakeDelegate(this, &QueryWindow::onNickMessage));
-    g_pEvtManager->hookEvent("noticeMessage",  m_pSession, MakeDelegate(this, &QueryWindow::onNoticeMessage));
-    g_pEvtManager->hookEvent("privmsgMessage", m_pSession, MakeDelegate(this, &QueryWindow::onPrivmsgMessage));
+    m_eventHandles.append(g_pEvtManager->hookEvent("nickMessage",    m_pSession, MakeDelegate(this, &QueryWindow::onNickMessage)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("noticeMessage",  m_pSession, MakeDelegate(this, &QueryWindow::onNoticeMessage)));
+    hookTargetEvents();
 }
 
 //-----------------------------------//
 
 QueryWindow::~QueryWindow()
 {
-    g_pEvtManager->unhookEvent("numericMessage", m_pSession, MakeDelegate(this, &QueryWindow::onNumericMessage));
-    g_pEvtManager->unhookEvent("nickMessage",    m_pSession, MakeDelegate(this, &QueryWindow::onNickMessage));
-    g_pEvtManager->unhookEvent("noticeMessage",  m_pSession, MakeDelegate(this, &QueryWindow::onNoticeMessage));
-    g_pEvtManager->unhookEvent("privmsgMessage", m_pSession, MakeDelegate(this, &QueryWindow::onPrivmsgMessage));
+    g_pEvtManager->unhookEvents(m_eventHandles);
+    g_pEvtManager->unhookEvent(m_privmsgHandle);
 
     m_pSharedServerConnPanel.reset();
 }
@@ -54,8 +52,10 @@ QueryWindow::~QueryWindow()
 void QueryWindow::setTargetNick(const QString &nick)
 {
     m_targetNick = nick;
+    m_nickMatcher.setWords(QStringList(nick));
     setWindowName(nick);
     setTitle(nick);
+    hookTargetEvents();
 }
 
 //-----------------------------------//
@@ -69,28 +69,21 @@ QString QueryWindow::getTargetNick()
 
 //-----------------------------------//
 
-void QueryWindow::onNumericMessage(Event *pEvent)
+// ERR_NOSUCHNICK and ERR_CANNOTSENDTOCHAN; called by the parent
+// StatusWindow when the numeric concerns this query.
+void QueryWindow::handle401Numeric(const Message &msg)
 {
-    Message msg = DCAST(MessageEvent, pEvent)->getMessage();
-    switch(msg.m_command)
-    {
-        case 401:   // ERR_NOSUCKNICK
-        case 404:   // ERR_CANNOTSENDTOCHAN
-        {
-            // msg.m_params[0]: my nick
-            // msg.m_params[1]: nick/channel
-            // msg.m_params[2]: "No such nick/channel"
-            if(msg.m_params[1].compare(getWindowName(), Qt::CaseInsensitive) == 0)
-                printOutput(getNumericText(msg), MESSAGE_IRC_NUMERIC);
-        }
-    }
+    // msg.m_params[0]: my nick
+    // msg.m_params[1]: nick/channel
+    // msg.m_params[2]: "No such nick/channel"
+    printOutput(getNumericText(msg), MESSAGE_IRC_NUMERIC);
 }
 
 //-----------------------------------//
 
-void QueryWindow::onNickMessage(Event *pEvent)
+void QueryWindow::onNickMessage(const MessageEvent &evt)
 {
-    Message msg = DCAST(MessageEvent, pEvent)->getMessage();
+    const Message &msg = evt.getMessage();
 
     // Will print a nick change message to the PM window
     // if we get a NICK message, which will only be if we're in
@@ -107,10 +100,11 @@ void QueryWindow::onNickMessage(Event *pEvent)
     {
         // If the target nick has changed and there isn't another query with that name
         // already open, then we can safely change the target's nick.
-        bool queryWindowExists = DCAST(StatusWindow, m_pManager->getParentWindow(this))->childIrcWindowExists(msg.m_params[0]);
+        StatusWindow *pStatusWin = DCAST(StatusWindow, m_pManager->getParentWindow(this));
+        bool queryWindowExists = pStatusWin->childIrcWindowExists(msg.m_params[0]);
         if(isTargetNick(oldNick) && !queryWindowExists)
         {
-            setTargetNick(msg.m_params[0]);
+            pStatusWin->renameQueryWindow(this, msg.m_params[0]);
             printOutput(textToPrint, MESSAGE_IRC_NICK);
         }
     }
@@ -118,17 +112,17 @@ void QueryWindow::onNickMessage(Event *pEvent)
 
 //-----------------------------------//
 
-void QueryWindow::onNoticeMessage(Event *pEvent)
+void QueryWindow::onNoticeMessage(const MessageEvent &evt)
 {
     if(m_pManager->isWindowFocused(this))
-        InputOutputWindow::onNoticeMessage(pEvent);
+        InputOutputWindow::onNoticeMessage(evt);
 }
 
 //-----------------------------------//
 
-void QueryWindow::onPrivmsgMessage(Event *pEvent)
+void QueryWindow::onPrivmsgMessage(const MessageEvent &evt)
 {
-    Message msg = DCAST(MessageEvent, pEvent)->getMessage();
+    const Message &msg = evt.getMessage();
     if(m_pSession->isMyNick(msg.m_params[0]))
     {
         QString fromNick = parseMsgPrefix(msg.m_prefix, MsgPrefixName);
@@ -155,6 +149,11 @@ void QueryWindow::onPrivmsgMessage(Event *pEvent)
                                   .arg(fromNick)
                                   .arg(msgText);
                 }
+                else
+                {
+                    // Other requests are shown (and limited) by the StatusWindow.
+                    return;
+                }
             }
             else
             {
@@ -177,28 +176,29 @@ void QueryWindow::onPrivmsgMessage(Event *pEvent)
 
 //-----------------------------------//
 
-void QueryWindow::onOutput(Event *pEvent)
+// Private messages are only fired for the query with the sender, so
+// they have to be hooked again whenever the target's nick changes.
+void QueryWindow::hookTargetEvents()
 {
-    OutputEvent *pOutputEvt = DCAST(OutputEvent, pEvent);
-    QRegExp regex(OutputWindow::s_invalidNickPrefix
-                + QRegExp::escape(m_targetNick)
-                + OutputWindow::s_invalidNickSuffix);
-    regex.setCaseSensitivity(Qt::CaseInsensitive);
-    int lastIdx = 0, idx;
-    while((idx = regex.indexIn(pOutputEvt->getText(), lastIdx)) >= 0)
-    {
-        idx += regex.capturedTexts()[1].length();
-        lastIdx = idx + m_targetNick.length() - 1;
-        pOutputEvt->addLinkInfo(idx, lastIdx);
-    }
+    g_pEvtManager->unhookEvent(m_privmsgHandle);
+    m_privmsgHandle = g_pEvtManager->hookEvent("privmsgMessage", m_pSession, foldCase(m_targetNick),
+                                               MakeDelegate(this, &QueryWindow::onPrivmsgMessage));
+}
+
+//-----------------------------------//
+
+void QueryWindow::onOutput(const OutputEvent &evt)
+{
+    QList<WordMatch> matches = m_nickMatcher.findAll(evt.getText());
+    for(int i = 0; i < matches.size(); ++i)
+        evt.addLinkInfo(matches[i].start, matches[i].start + matches[i].length - 1);
 }
 
 //-----------------------------------//
 
-void QueryWindow::onDoubleClickLink(Event *pEvent)
+void QueryWindow::onDoubleClickLink(const DoubleClickLinkEvent &evt)
 {
-    DoubleClickLinkEvent *pDblClickLinkEvt = DCAST(DoubleClickLinkEvent, pEvent);
-    m_pSession->sendData(QString().arg(pDblClickLinkEvt->getText()));
+    m_pSession->sendData(QString().arg(evt.getText()));
 }
 
 //-----------------------------------//
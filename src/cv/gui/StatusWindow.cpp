@@ -17,12 +17,22 @@
 
 #define DEBUG_MESSAGES 0
 
+#define NOTIFY_LIST     tr("irc.notify.list")
+#define NOTIFY_INTERVAL tr("irc.notify.interval")
+#define IGNORE_LIST     tr("irc.ignore")
+#define HIGHLIGHT_WORDS tr("irc.highlight.words")
+
+// CTCP requests which aren't replied to are summed up
+// in one line this many milliseconds after the first.
+const int CTCP_SUMMARY_MSEC = 5000;
+
 namespace cv { namespace gui {
 
 StatusWindow::StatusWindow(const QString &title/* = tr("Server Window")*/,
                            const QSize &size/* = QSize(500, 300)*/)
   : InputOutputWindow(title, size),
     m_populatingUserList(false),
+    m_sentListStopMsg(false),
     m_pChanListWin(NULL)
 {
     m_pVLayout->addWidget(m_pOutput);
@@ -39,28 +49,68 @@ StatusWindow::StatusWindow(const QString &title/* = tr("Server Window")*/,
     m_pOutput->installEventFilter(this);
 
     m_pSession = new Session("conviersa");
-    g_pEvtManager->hookEvent("connecting",     m_pSession, MakeDelegate(this, &StatusWindow::onServerConnecting));
-    g_pEvtManager->hookEvent("connectFailed",  m_pSession, MakeDelegate(this, &StatusWindow::onServerConnectFailed));
-    g_pEvtManager->hookEvent("connected",      m_pSession, MakeDelegate(this, &StatusWindow::onServerConnect));
-    g_pEvtManager->hookEvent("disconnected",   m_pSession, MakeDelegate(this, &StatusWindow::onServerDisconnect));
-    g_pEvtManager->hookEvent("errorMessage",   m_pSession, MakeDelegate(this, &StatusWindow::onErrorMessage));
-    g_pEvtManager->hookEvent("inviteMessage",  m_pSession, MakeDelegate(this, &StatusWindow::onInviteMessage));
-    g_pEvtManager->hookEvent("joinMessage",    m_pSession, MakeDelegate(this, &StatusWindow::onJoinMessage));
-    g_pEvtManager->hookEvent("modeMessage",    m_pSession, MakeDelegate(this, &StatusWindow::onModeMessage));
-    g_pEvtManager->hookEvent("nickMessage",    m_pSession, MakeDelegate(this, &StatusWindow::onNickMessage));
-    g_pEvtManager->hookEvent("noticeMessage",  m_pSession, MakeDelegate(this, &InputOutputWindow::onNoticeMessage));
-    g_pEvtManager->hookEvent("pongMessage",    m_pSession, MakeDelegate(this, &StatusWindow::onPongMessage));
-    g_pEvtManager->hookEvent("privmsgMessage", m_pSession, MakeDelegate(this, &StatusWindow::onPrivmsgMessage));
-    g_pEvtManager->hookEvent("quitMessage",    m_pSession, MakeDelegate(this, &StatusWindow::onQuitMessage));
-    g_pEvtManager->hookEvent("wallopsMessage", m_pSession, MakeDelegate(this, &StatusWindow::onWallopsMessage));
-    g_pEvtManager->hookEvent("numericMessage", m_pSession, MakeDelegate(this, &StatusWindow::onNumericMessage));
-    g_pEvtManager->hookEvent("unknownMessage", m_pSession, MakeDelegate(this, &StatusWindow::onUnknownMessage));
+
+    m_ctcpSummaryTimer.setSingleShot(true);
+    m_ctcpSummaryTimer.setInterval(CTCP_SUMMARY_MSEC);
+    QObject::connect(&m_ctcpSummaryTimer, SIGNAL(timeout()), this, SLOT(printCtcpSummary()));
+
+    m_eventHandles.append(g_pEvtManager->hookEvent("connecting",     m_pSession, MakeDelegate(this, &StatusWindow::onServerConnecting)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("connectFailed",  m_pSession, MakeDelegate(this, &StatusWindow::onServerConnectFailed)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("connected",      m_pSession, MakeDelegate(this, &StatusWindow::onServerConnect)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("disconnected",   m_pSession, MakeDelegate(this, &StatusWindow::onServerDisconnect)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("errorMessage",   m_pSession, MakeDelegate(this, &StatusWindow::onErrorMessage)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("inviteMessage",  m_pSession, MakeDelegate(this, &StatusWindow::onInviteMessage)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("joinMessage",    m_pSession, MakeDelegate(this, &StatusWindow::onJoinMessage)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("modeMessage",    m_pSession, MakeDelegate(this, &StatusWindow::onModeMessage)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("nickMessage",    m_pSession, MakeDelegate(this, &StatusWindow::onNickMessage)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("noticeMessage",  m_pSession, MakeDelegate(this, &InputOutputWindow::onNoticeMessage)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("pongMessage",    m_pSession, MakeDelegate(this, &StatusWindow::onPongMessage)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("privmsgMessage", m_pSession, MakeDelegate(this, &StatusWindow::onPrivmsgMessage)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("quitMessage",    m_pSession, MakeDelegate(this, &StatusWindow::onQuitMessage)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("wallopsMessage", m_pSession, MakeDelegate(this, &StatusWindow::onWallopsMessage)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("numericMessage", m_pSession, MakeDelegate(this, &StatusWindow::onNumericMessage)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("netsplit",       m_pSession, MakeDelegate(this, &StatusWindow::onNetsplit)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("netjoin",        m_pSession, MakeDelegate(this, &StatusWindow::onNetjoin)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("unknownMessage", m_pSession, MakeDelegate(this, &StatusWindow::onUnknownMessage)));
+
+    // Replies to LIST arrive in batches rather than as 322 numerics.
+    m_eventHandles.append(g_pEvtManager->hookEvent("channelListBatch", m_pSession, MakeDelegate(this, &StatusWindow::onChannelListBatch)));
+
+    m_eventHandles.append(g_pEvtManager->hookEvent("notifyOnline",  m_pSession, MakeDelegate(this, &StatusWindow::onNotifyOnline)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("notifyOffline", m_pSession, MakeDelegate(this, &StatusWindow::onNotifyOffline)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("configChanged", NOTIFY_LIST, MakeDelegate(this, &StatusWindow::onNotifyConfigChanged)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("configChanged", NOTIFY_INTERVAL, MakeDelegate(this, &StatusWindow::onNotifyConfigChanged)));
+    setupNotifyList();
+
+    m_eventHandles.append(g_pEvtManager->hookEvent("configChanged", IGNORE_LIST, MakeDelegate(this, &StatusWindow::onIgnoreConfigChanged)));
+    setupIgnoreList();
+
+    m_eventHandles.append(g_pEvtManager->hookEvent("configChanged", HIGHLIGHT_WORDS, MakeDelegate(this, &StatusWindow::onHighlightConfigChanged)));
+    setupHighlightWords();
+    m_pSession->setAltNicks(getAltNicks(GET_STRING("server.altNick")));
+
+    // Numerics which are not hooked here are printed by onNumericMessage().
+    m_pSession->hookNumeric(1,   MakeDelegate(this, &StatusWindow::handle001Numeric));
+    m_pSession->hookNumeric(2,   MakeDelegate(this, &StatusWindow::printNumeric));
+    m_pSession->hookNumeric(5,   MakeDelegate(this, &StatusWindow::printNumeric));
+    m_pSession->hookNumeric(301, MakeDelegate(this, &StatusWindow::handle301Numeric));
+    m_pSession->hookNumeric(317, MakeDelegate(this, &StatusWindow::handle317Numeric));
+    m_pSession->hookNumeric(321, MakeDelegate(this, &StatusWindow::handle321Numeric));
+    m_pSession->hookNumeric(323, MakeDelegate(this, &StatusWindow::handle323Numeric));
+    m_pSession->hookNumeric(330, MakeDelegate(this, &StatusWindow::handle330Numeric));
+    m_pSession->hookNumeric(332, MakeDelegate(this, &StatusWindow::handle332Numeric));
+    m_pSession->hookNumeric(333, MakeDelegate(this, &StatusWindow::handle333Numeric));
+    m_pSession->hookNumeric(353, MakeDelegate(this, &StatusWindow::handle353Numeric));
+    m_pSession->hookNumeric(366, MakeDelegate(this, &StatusWindow::handle366Numeric));
+    m_pSession->hookNumeric(401, MakeDelegate(this, &StatusWindow::handle401Numeric));
+    m_pSession->hookNumeric(404, MakeDelegate(this, &StatusWindow::handle401Numeric));
 }
 
 //-----------------------------------//
 
 StatusWindow::~StatusWindow()
 {
+    g_pEvtManager->unhookEvents(m_eventHandles);
     delete m_pSession;
     m_pSharedServerConnPanel.reset();
 }
@@ -71,15 +121,7 @@ StatusWindow::~StatusWindow()
 // a child of this StatusWindow, NULL otherwise.
 OutputWindow *StatusWindow::getChildIrcWindow(const QString &name)
 {
-    for(int i = 0; i < m_chanList.size(); ++i)
-        if(name.compare(m_chanList[i]->getWindowName(), Qt::CaseInsensitive) == 0)
-            return m_chanList[i];
-
-    for(int i = 0; i < m_privList.size(); ++i)
-        if(name.compare(m_privList[i]->getWindowName(), Qt::CaseInsensitive) == 0)
-            return m_privList[i];
-
-    return NULL;
+    return m_childWindows.value(foldCase(name), NULL);
 }
 
 //-----------------------------------//
@@ -108,6 +150,7 @@ void StatusWindow::addChannelWindow(ChannelWindow *pChanWin)
     if(m_pManager)
         m_pManager->addWindow(pChanWin, m_pManager->getItemFromWindow(this));
     m_chanList.append(pChanWin);
+    m_childWindows.insert(foldCase(pChanWin->getWindowName()), pChanWin);
     QObject::connect(pChanWin, SIGNAL(chanWindowClosing(ChannelWindow *)),
                 this, SLOT(removeChannelWindow(ChannelWindow *)));
 }
@@ -118,6 +161,7 @@ void StatusWindow::addChannelWindow(ChannelWindow *pChanWin)
 void StatusWindow::removeChannelWindow(ChannelWindow *pChanWin)
 {
     m_chanList.removeOne(pChanWin);
+    m_childWindows.remove(foldCase(pChanWin->getWindowName()));
 }
 
 //-----------------------------------//
@@ -128,6 +172,7 @@ void StatusWindow::addQueryWindow(QueryWindow *pQueryWin, bool giveFocus)
     if(m_pManager)
         m_pManager->addWindow(pQueryWin, m_pManager->getItemFromWindow(this), giveFocus);
     m_privList.append(pQueryWin);
+    m_childWindows.insert(foldCase(pQueryWin->getWindowName()), pQueryWin);
     QObject::connect(pQueryWin, SIGNAL(privWindowClosing(QueryWindow *)),
                 this, SLOT(removeQueryWindow(QueryWindow *)));
 }
@@ -138,12 +183,24 @@ void StatusWindow::addQueryWindow(QueryWindow *pQueryWin, bool giveFocus)
 void StatusWindow::removeQueryWindow(QueryWindow *pPrivWin)
 {
     m_privList.removeOne(pPrivWin);
+    m_childWindows.remove(foldCase(pPrivWin->getWindowName()));
+}
+
+//-----------------------------------//
+
+// Changes the nick of the person that [pQueryWin] is chatting with.
+void StatusWindow::renameQueryWindow(QueryWindow *pQueryWin, const QString &newNick)
+{
+    m_childWindows.remove(foldCase(pQueryWin->getWindowName()));
+    pQueryWin->setTargetNick(newNick);
+    m_childWindows.insert(foldCase(newNick), pQueryWin);
 }
 
 //-----------------------------------//
 
 void StatusWindow::connectToServer(QString server, int port, QString name, QString nick, QString altNick)
 {
+    m_pSession->setAltNicks(getAltNicks(altNick));
     m_pSession->connectToServer(server, port, name, nick);
 }
 
@@ -185,6 +242,50 @@ bool StatusWindow::eventFilter(QObject *obj, QEvent *event)
 
 //-----------------------------------//
 
+// Prints the numeric without any special handling.
+void StatusWindow::printNumeric(const Message &msg)
+{
+    printOutput(getNumericText(msg), MESSAGE_IRC_NUMERIC);
+}
+
+//-----------------------------------//
+
+void StatusWindow::handle001Numeric(const Message &msg)
+{
+    // Change the name of the window to the name of the network.
+    QString networkName = getNetworkNameFrom001(msg);
+    setTitle(networkName);
+    setWindowName(networkName);
+}
+
+//-----------------------------------//
+
+// RPL_AWAY
+void StatusWindow::handle301Numeric(const Message &msg)
+{
+    // msg.m_params[0]: my nick
+    // msg.m_params[1]: nick
+    // msg.m_params[2]: away message
+    QString textToPrint = GET_STRING("message.301")
+                          .arg(msg.m_params[1])
+                          .arg(msg.m_params[2]);
+    printOutput(textToPrint, MESSAGE_IRC_NUMERIC);
+}
+
+//-----------------------------------//
+
+// RPL_WHOISIDLE
+void StatusWindow::handle317Numeric(const Message &msg)
+{
+    QString textToPrint = GET_STRING("message.317")
+                          .arg(msg.m_params[1])
+                          .arg(getIdleTextFrom317(msg));
+    printOutput(textToPrint, MESSAGE_IRC_NUMERIC);
+}
+
+//-----------------------------------//
+
+// RPL_LISTSTART
 void StatusWindow::handle321Numeric(const Message &)
 {
     if(!m_pChanListWin)
@@ -210,38 +311,74 @@ void StatusWindow::handle321Numeric(const Message &)
 
 //-----------------------------------//
 
-void StatusWindow::handle322Numeric(const Message &msg)
+// RPL_LISTEND
+void StatusWindow::handle323Numeric(const Message &)
+{
+    if(m_pChanListWin)
+        m_pChanListWin->endPopulatingList();
+
+    m_sentListStopMsg = false;
+}
+
+//-----------------------------------//
+
+// RPL_WHOISACCOUNT
+void StatusWindow::handle330Numeric(const Message &msg)
+{
+    // msg.m_params[0]: my nick
+    // msg.m_params[1]: nick
+    // msg.m_params[2]: login/auth
+    // msg.m_params[3]: "is logged in as"
+    QString textToPrint = GET_STRING("message.330")
+                          .arg(msg.m_params[1])
+                          .arg(msg.m_params[3])
+                          .arg(msg.m_params[2]);
+    printOutput(textToPrint, MESSAGE_IRC_NUMERIC);
+}
+
+//-----------------------------------//
+
+// RPL_TOPIC
+void StatusWindow::handle332Numeric(const Message &msg)
 {
     // msg.m_params[0]: my nick
     // msg.m_params[1]: channel
-    // msg.m_params[2]: number of users
-    // msg.m_params[3]: topic
-    if(m_pChanListWin)
-    {
-        m_pChanListWin->addChannel(msg.m_params[1], msg.m_params[2], msg.m_params[3]);
-    }
+    // msg.m_params[2]: topic
+    ChannelWindow *pChanWin = DCAST(ChannelWindow, getChildIrcWindow(msg.m_params[1]));
+    if(pChanWin != NULL)
+        pChanWin->handle332Numeric(msg);
     else
-    {
-        if(!m_sentListStopMsg)
-        {
-            m_sentListStopMsg = true;
-            m_pSession->sendData("LIST STOP");
-        }
-    }
+        printOutput(getNumericText(msg), MESSAGE_IRC_NUMERIC);
 }
 
 //-----------------------------------//
 
-void StatusWindow::handle323Numeric(const Message &)
+// States when topic was last set.
+void StatusWindow::handle333Numeric(const Message &msg)
 {
-    if(m_pChanListWin)
-        m_pChanListWin->endPopulatingList();
-
-    m_sentListStopMsg = false;
+    // msg.m_params[0]: my nick
+    // msg.m_params[1]: channel
+    // msg.m_params[2]: nick
+    // msg.m_params[3]: unix time
+    ChannelWindow *pChanWin = DCAST(ChannelWindow, getChildIrcWindow(msg.m_params[1]));
+    if(pChanWin != NULL)
+    {
+        pChanWin->handle333Numeric(msg);
+    }
+    else
+    {
+        QString textToPrint = GET_STRING("message.333.status")
+                              .arg(msg.m_params[1])
+                              .arg(msg.m_params[2])
+                              .arg(getDate(msg.m_params[3]))
+                              .arg(getTime(msg.m_params[3]));
+        printOutput(textToPrint, MESSAGE_IRC_NUMERIC);
+    }
 }
 
 //-----------------------------------//
 
+// RPL_NAMREPLY
 void StatusWindow::handle353Numeric(const Message &msg)
 {
     // msg.m_params[0]: my nick
@@ -249,30 +386,53 @@ void StatusWindow::handle353Numeric(const Message &msg)
     // msg.m_params[2]: channel
     // msg.m_params[3]: names, separated by spaces
     ChannelWindow *pChanWin = DCAST(ChannelWindow, getChildIrcWindow(msg.m_params[2]));
-
+    if(pChanWin != NULL)
+        pChanWin->handle353Numeric(msg);
     // RPL_NAMREPLY was sent as a result of a NAMES command.
-    if(pChanWin == NULL)
-    {
+    else
         printOutput(getNumericText(msg), MESSAGE_IRC_NUMERIC);
-    }
 }
 
 //-----------------------------------//
 
+// RPL_ENDOFNAMES
 void StatusWindow::handle366Numeric(const Message &msg)
 {
     // msg.m_params[0]: my nick
     // msg.m_params[1]: channel
     // msg.m_params[2]: "End of NAMES list"
-    //
+    ChannelWindow *pChanWin = DCAST(ChannelWindow, getChildIrcWindow(msg.m_params[1]));
+    if(pChanWin != NULL)
+        pChanWin->handle366Numeric(msg);
     // RPL_ENDOFNAMES was sent as a result of a NAMES command.
-    if(!childIrcWindowExists(msg.m_params[1]))
+    else
         printOutput(getNumericText(msg), MESSAGE_IRC_NUMERIC);
 }
 
 //-----------------------------------//
 
-void StatusWindow::onServerConnecting(Event *)
+// ERR_NOSUCHNICK and ERR_CANNOTSENDTOCHAN
+void StatusWindow::handle401Numeric(const Message &msg)
+{
+    // msg.m_params[0]: my nick
+    // msg.m_params[1]: nick/channel
+    // msg.m_params[2]: "No such nick/channel"
+    OutputWindow *pChildWin = getChildIrcWindow(msg.m_params[1]);
+    if(pChildWin == NULL)
+    {
+        printOutput(getNumericText(msg), MESSAGE_IRC_NUMERIC);
+    }
+    else
+    {
+        QueryWindow *pQueryWin = DCAST(QueryWindow, pChildWin);
+        if(pQueryWin != NULL)
+            pQueryWin->handle401Numeric(msg);
+    }
+}
+
+//-----------------------------------//
+
+void StatusWindow::onServerConnecting(const ConnectionEvent &)
 {
     QString textToPrint = GET_STRING("message.connecting")
                             .arg(m_pSession->getHost())
@@ -282,10 +442,9 @@ void StatusWindow::onServerConnecting(Event *)
 
 //-----------------------------------//
 
-void StatusWindow::onServerConnectFailed(Event *pEvt)
+void StatusWindow::onServerConnectFailed(const ConnectionEvent &evt)
 {
-    ConnectionEvent *pConnectionEvt = DCAST(ConnectionEvent, pEvt);
-    QAbstractSocket::SocketError error = pConnectionEvt->error();
+    QAbstractSocket::SocketError error = evt.error();
     QString reason;
     switch(error)
     {
@@ -318,13 +477,12 @@ void StatusWindow::onServerConnectFailed(Event *pEvt)
 
 //-----------------------------------//
 
-void StatusWindow::onServerConnect(Event *pEvent)
+void StatusWindow::onServerConnect(const ConnectionEvent &evt)
 {
     m_pSharedServerConnPanel->close();
     m_pInput->setFocus();
 
-    ConnectionEvent *pConnEvent = DCAST(ConnectionEvent, pEvent);
-    QString host = pConnEvent->getHost();
+    QString host = evt.getHost();
 
     // Get the recent servers list.
     QVariantList serverList = g_pCfgManager->getOptionValue("recent.servers").toList();
@@ -349,7 +507,7 @@ void StatusWindow::onServerConnect(Event *pEvent)
 
 //-----------------------------------//
 
-void StatusWindow::onServerDisconnect(Event *)
+void StatusWindow::onServerDisconnect(const ConnectionEvent &)
 {
     printOutput(GET_STRING("message.disconnected"), MESSAGE_INFO);
     setTitle("Server Window");
@@ -359,165 +517,48 @@ void StatusWindow::onServerDisconnect(Event *)
 
 //-----------------------------------//
 
-void StatusWindow::onNumericMessage(Event *pEvent)
+// Adds a batch of channels received from LIST to the channel list
+// window, or stops the list if the window has been closed.
+void StatusWindow::onChannelListBatch(const ChannelListEvent &evt)
 {
-    Message msg = DCAST(MessageEvent, pEvent)->getMessage();
-    switch(msg.m_command)
+    if(m_pChanListWin)
     {
-        case 1:
-        {
-            // Change the name of the window to the name of the network.
-            QString networkName = getNetworkNameFrom001(msg);
-            setTitle(networkName);
-            setWindowName(networkName);
-
-            break;
-        }
-        // RPL_AWAY
-        case 301:
-        {
-            // msg.m_params[0]: my nick
-            // msg.m_params[1]: nick
-            // msg.m_params[2]: away message
-            QString textToPrint = GET_STRING("message.301")
-                                  .arg(msg.m_params[1])
-                                  .arg(msg.m_params[2]);
-            printOutput(textToPrint, MESSAGE_IRC_NUMERIC);
-
-            break;
-        }
-        /*// RPL_USERHOST
-        case 302:
+        m_pChanListWin->addChannels(evt.getCount());
+    }
+    else
+    {
+        if(!m_sentListStopMsg)
         {
-
-            break;
+            m_sentListStopMsg = true;
+            m_pSession->sendData("LIST STOP");
         }
-        // RPL_ISON
-        case 303:
-        {
+    }
+}
 
-            break;
-        }*/
-        // RPL_WHOISIDLE
-        case 317:
-        {
-            QString textToPrint = GET_STRING("message.317")
-                                  .arg(msg.m_params[1])
-                                  .arg(getIdleTextFrom317(msg));
-            printOutput(textToPrint, MESSAGE_IRC_NUMERIC);
-            break;
-        }
-        // RPL_LISTSTART
-        case 321:
-        {
-            handle321Numeric(msg);
-            break;
-        }
-        // RPL_LIST
-        case 322:
-        {
-            handle322Numeric(msg);
-            break;
-        }
-        // RPL_LISTEND
-        case 323:
-        {
-            handle323Numeric(msg);
-            break;
-        }
-        // RPL_WHOISACCOUNT
-        case 330:
-        {
-            // msg.m_params[0]: my nick
-            // msg.m_params[1]: nick
-            // msg.m_params[2]: login/auth
-            // msg.m_params[3]: "is logged in as"
-            QString textToPrint = GET_STRING("message.330")
-                                  .arg(msg.m_params[1])
-                                  .arg(msg.m_params[3])
-                                  .arg(msg.m_params[2]);
-            printOutput(textToPrint, MESSAGE_IRC_NUMERIC);
-            break;
-        }
-        // RPL_TOPIC
-        case 332:
-        {
-            // msg.m_params[0]: my nick
-            // msg.m_params[1]: channel
-            // msg.m_params[2]: topic
-            if(!childIrcWindowExists(msg.m_params[1]))
-                printOutput(getNumericText(msg), MESSAGE_IRC_NUMERIC);
-            break;
-        }
-        // States when topic was last set.
-        case 333:
-        {
-            // msg.m_params[0]: my nick
-            // msg.m_params[1]: channel
-            // msg.m_params[2]: nick
-            // msg.m_params[3]: unix time
-            if(!childIrcWindowExists(msg.m_params[1]))
-            {
-                QString textToPrint = GET_STRING("message.333.status")
-                                      .arg(msg.m_params[1])
-                                      .arg(msg.m_params[2])
-                                      .arg(getDate(msg.m_params[3]))
-                                      .arg(getTime(msg.m_params[3]));
-                printOutput(textToPrint, MESSAGE_IRC_NUMERIC);
-            }
+//-----------------------------------//
 
-            break;
-        }
-        // RPL_NAMREPLY
-        case 353:
-        {
-            handle353Numeric(msg);
-            break;
-        }
-        // RPL_ENDOFNAMES
-        case 366:
-        {
-            handle366Numeric(msg);
-            break;
-        }
-        case 401:   // ERR_NOSUCKNICK
-        case 404:   // ERR_CANNOTSENDTOCHAN
-        {
-            // msg.m_params[0]: my nick
-            // msg.m_params[1]: nick/channel
-            // msg.m_params[2]: "No such nick/channel"
-            if(!childIrcWindowExists(msg.m_params[1]))
-            {
-                printOutput(getNumericText(msg), MESSAGE_IRC_NUMERIC);
-            }
-            break;
-        }
-        default:
-        {
-            // The following are not meant to be handled,
-            // but only printed:
-            // 	003
-            // 	004
-            // 	305
-            // 	306
-            printOutput(getNumericText(msg), MESSAGE_IRC_NUMERIC);
-        }
-    }
+// Fired for every numeric which isn't hooked through the
+// Session's NumericRegistry; these are only printed.
+//
+// Examples: 003, 004, 305, 306
+void StatusWindow::onNumericMessage(const MessageEvent &evt)
+{
+    printNumeric(evt.getMessage());
 }
 
 //-----------------------------------//
 
-void StatusWindow::onErrorMessage(Event *pEvent)
+void StatusWindow::onErrorMessage(const MessageEvent &evt)
 {
-    Message msg = DCAST(MessageEvent, pEvent)->getMessage();
+    const Message &msg = evt.getMessage();
     printOutput(msg.m_params[0], MESSAGE_IRC_ERROR);
 }
 
 //-----------------------------------//
 
-void StatusWindow::onInviteMessage(Event *pEvent)
+void StatusWindow::onInviteMessage(const MessageEvent &evt)
 {
-    Message msg = DCAST(MessageEvent, pEvent)->getMessage();
+    const Message &msg = evt.getMessage();
     QString textToPrint = GET_STRING("message.invite")
                           .arg(parseMsgPrefix(msg.m_prefix, MsgPrefixName))
                           .arg(msg.m_params[1]);
@@ -526,9 +567,9 @@ void StatusWindow::onInviteMessage(Event *pEvent)
 
 //-----------------------------------//
 
-void StatusWindow::onJoinMessage(Event *pEvent)
+void StatusWindow::onJoinMessage(const MessageEvent &evt)
 {
-    Message msg = DCAST(MessageEvent, pEvent)->getMessage();
+    const Message &msg = evt.getMessage();
 
     QString nickJoined = parseMsgPrefix(msg.m_prefix, MsgPrefixName);
     if(m_pSession->isMyNick(nickJoined) && !childIrcWindowExists(msg.m_params[0]))
@@ -543,9 +584,9 @@ void StatusWindow::onJoinMessage(Event *pEvent)
 
 //-----------------------------------//
 
-void StatusWindow::onModeMessage(Event *pEvent)
+void StatusWindow::onModeMessage(const MessageEvent &evt)
 {
-    Message msg = DCAST(MessageEvent, pEvent)->getMessage();
+    const Message &msg = evt.getMessage();
     if(!childIrcWindowExists(msg.m_params[0]))  // user mode
     {
         // Ignore the first parameter.
@@ -563,9 +604,9 @@ void StatusWindow::onModeMessage(Event *pEvent)
 
 //-----------------------------------//
 
-void StatusWindow::onNickMessage(Event *pEvent)
+void StatusWindow::onNickMessage(const MessageEvent &evt)
 {
-    Message msg = DCAST(MessageEvent, pEvent)->getMessage();
+    const Message &msg = evt.getMessage();
 
     QString oldNick = parseMsgPrefix(msg.m_prefix, MsgPrefixName);
     if(m_pSession->isMyNick(oldNick))
@@ -575,13 +616,27 @@ void StatusWindow::onNickMessage(Event *pEvent)
                               .arg(msg.m_params[0]);
         printOutput(textToPrint, MESSAGE_IRC_NICK);
     }
+
+    // Pass the message on to only the channels the user is in; the
+    // Session has already renamed the user, so look up the new nick.
+    IrcUser *pUser = m_pSession->getNetworkState()->findUser(msg.m_params[0]);
+    if(pUser == NULL)
+        return;
+
+    QList<IrcChannel *> channels = pUser->getChannels();
+    for(int i = 0; i < channels.size(); ++i)
+    {
+        ChannelWindow *pChannelWin = DCAST(ChannelWindow, getChildIrcWindow(channels[i]->getName()));
+        if(pChannelWin != NULL)
+            pChannelWin->onNickMessage(evt);
+    }
 }
 
 //-----------------------------------//
 
-void StatusWindow::onPongMessage(Event *pEvent)
+void StatusWindow::onPongMessage(const MessageEvent &evt)
 {
-    Message msg = DCAST(MessageEvent, pEvent)->getMessage();
+    const Message &msg = evt.getMessage();
 
     // The prefix is used to determine the server that
     // sends the PONG (instead of using the first parameter),
@@ -598,9 +653,9 @@ void StatusWindow::onPongMessage(Event *pEvent)
 
 //-----------------------------------//
 
-void StatusWindow::onPrivmsgMessage(Event *pEvent)
+void StatusWindow::onPrivmsgMessage(const MessageEvent &evt)
 {
-    Message msg = DCAST(MessageEvent, pEvent)->getMessage();
+    const Message &msg = evt.getMessage();
 
     QString fromNick = parseMsgPrefix(msg.m_prefix, MsgPrefixName);
     CtcpRequestType requestType = getCtcpRequestType(msg);
@@ -636,6 +691,20 @@ void StatusWindow::onPrivmsgMessage(Event *pEvent)
             }
         }
 
+        // Requests over the limit get neither a reply nor a line of
+        // their own; they're summed up every so often instead. Those
+        // which aren't replied to are limited separately, so that
+        // they don't take tokens from the replies.
+        CtcpLimiter *pLimiter = m_pSession->getCtcpLimiter();
+        bool isAllowed = replyStr.isEmpty() ? pLimiter->allowDisplay(msg.m_prefix, requestTypeStr)
+                                            : pLimiter->allowReply(msg.m_prefix, requestTypeStr);
+        if(!isAllowed)
+        {
+            if(!m_ctcpSummaryTimer.isActive())
+                m_ctcpSummaryTimer.start();
+            return;
+        }
+
         if(!replyStr.isEmpty())
         {
             QString textToSend = QString("NOTICE %1 :\1%2 %3\1")
@@ -659,24 +728,54 @@ void StatusWindow::onPrivmsgMessage(Event *pEvent)
         addQueryWindow(pQueryWin, false);
 
         // Delegate to the newly created QueryWindow.
-        pQueryWin->onPrivmsgMessage(pEvent);
+        pQueryWin->onPrivmsgMessage(evt);
     }
 }
 
 //-----------------------------------//
 
-void StatusWindow::onQuitMessage(Event *pEvent)
+// Prints a single line for all the CTCP requests which
+// weren't replied to since the last time.
+void StatusWindow::printCtcpSummary()
 {
-    Message msg = DCAST(MessageEvent, pEvent)->getMessage();
+    int numSources;
+    QStringList types;
+    int numDropped = m_pSession->getCtcpLimiter()->takeDropped(numSources, types);
+    if(numDropped == 0)
+        return;
+
+    QString textToPrint = GET_STRING("message.ctcp.dropped")
+                            .arg(numDropped)
+                            .arg(types.join(", "))
+                            .arg(numSources);
+    printOutput(textToPrint, MESSAGE_IRC_CTCP);
+}
+
+//-----------------------------------//
+
+void StatusWindow::onQuitMessage(const MessageEvent &evt)
+{
+    const Message &msg = evt.getMessage();
     QString nick = parseMsgPrefix(msg.m_prefix, MsgPrefixName);
     QString userAndHost = parseMsgPrefix(msg.m_prefix, MsgPrefixUserAndHost);
     bool hasReason = (msg.m_paramsNum > 0 && !msg.m_params[0].isEmpty());
 
-    for(int i = 0; i < m_chanList.size(); ++i)
+    // Only visit the channels the user is in; the Session
+    // removes the user once the event has been fired.
+    QList<IrcChannel *> channels;
+    IrcUser *pUser = m_pSession->getNetworkState()->findUser(nick);
+    if(pUser != NULL)
+        channels = pUser->getChannels();
+
+    for(int i = 0; i < channels.size(); ++i)
     {
-        ChannelWindow *pChannelWin = m_chanList[i];
-        if(pChannelWin->hasUser(nick))
+        ChannelWindow *pChannelWin = DCAST(ChannelWindow, getChildIrcWindow(channels[i]->getName()));
+        if(pChannelWin != NULL && pChannelWin->hasUser(nick))
         {
+            pChannelWin->removeUser(nick);
+            if(pChannelWin->isFilteredUser(msg.m_prefix))
+                continue;
+
             QString nickToDisplay = nick;
             if(GET_BOOL("irc.channel.properNickInChat"))
                 nickToDisplay = pChannelWin->fetchProperNickname(nick);
@@ -690,37 +789,89 @@ void StatusWindow::onQuitMessage(Event *pEvent)
                                 .arg(msg.m_params[0])
                                 .arg(QString::fromUtf8("\xF"));
 
-            pChannelWin->removeUser(nick);
             pChannelWin->printOutput(textToPrint, MESSAGE_IRC_QUIT);
         }
     }
 
     // Will print a quit message to the PM window if we get a QUIT message,
     // which will only be if we're in a channel with the person.
-    for(int i = 0; i < m_privList.size(); ++i)
+    QueryWindow *pQueryWin = DCAST(QueryWindow, getChildIrcWindow(nick));
+    if(pQueryWin != NULL)
     {
-        if(nick.compare(m_privList[i]->getTargetNick(), Qt::CaseInsensitive) == 0)
-        {
-            // Construct the message to display in the QueryWindow.
-            QString textToPrint = GET_STRING("message.quit")
-                                    .arg(nick)
-                                    .arg(userAndHost);
-            if(hasReason)
-                textToPrint += GET_STRING("message.reason")
-                                .arg(msg.m_params[0])
-                                .arg(QString::fromUtf8("\xF"));
+        // Construct the message to display in the QueryWindow.
+        QString textToPrint = GET_STRING("message.quit")
+                                .arg(nick)
+                                .arg(userAndHost);
+        if(hasReason)
+            textToPrint += GET_STRING("message.reason")
+                            .arg(msg.m_params[0])
+                            .arg(QString::fromUtf8("\xF"));
+
+        pQueryWin->printOutput(textToPrint, MESSAGE_IRC_QUIT);
+    }
+}
 
-            m_privList[i]->printOutput(textToPrint, MESSAGE_IRC_QUIT);
-            break;
-        }
+//-----------------------------------//
+
+// Passes the netsplit on to the channels it affects, each of which
+// prints a single line for it, and prints a quit message to the
+// query windows of the users who quit.
+void StatusWindow::onNetsplit(const NetsplitEvent &evt)
+{
+    QString textToPrint = GET_STRING("message.netsplit")
+                            .arg(evt.getServer1())
+                            .arg(evt.getServer2())
+                            .arg(evt.getNicks().size());
+    printOutput(textToPrint, MESSAGE_IRC_QUIT);
+
+    const QHash<QString, QStringList> &channels = evt.getChannels();
+    QHash<QString, QStringList>::const_iterator it = channels.constBegin();
+    for(; it != channels.constEnd(); ++it)
+    {
+        ChannelWindow *pChannelWin = DCAST(ChannelWindow, getChildIrcWindow(it.key()));
+        if(pChannelWin != NULL)
+            pChannelWin->onNetsplit(evt);
+    }
+
+    // The Session removes the users once the event has been fired.
+    const QStringList &nicks = evt.getNicks();
+    for(int i = 0; i < nicks.size(); ++i)
+    {
+        QueryWindow *pQueryWin = DCAST(QueryWindow, getChildIrcWindow(nicks[i]));
+        IrcUser *pUser = m_pSession->getNetworkState()->findUser(nicks[i]);
+        if(pQueryWin == NULL || pUser == NULL)
+            continue;
+
+        textToPrint = GET_STRING("message.quit")
+                        .arg(nicks[i])
+                        .arg(pUser->getUser() + '@' + pUser->getHost())
+                    + GET_STRING("message.reason")
+                        .arg(evt.getServer1() + ' ' + evt.getServer2())
+                        .arg(QString::fromUtf8("\xF"));
+        pQueryWin->printOutput(textToPrint, MESSAGE_IRC_QUIT);
+    }
+}
+
+//-----------------------------------//
+
+// Passes the netjoin on to the channels it affects.
+void StatusWindow::onNetjoin(const NetsplitEvent &evt)
+{
+    const QHash<QString, QStringList> &channels = evt.getChannels();
+    QHash<QString, QStringList>::const_iterator it = channels.constBegin();
+    for(; it != channels.constEnd(); ++it)
+    {
+        ChannelWindow *pChannelWin = DCAST(ChannelWindow, getChildIrcWindow(it.key()));
+        if(pChannelWin != NULL)
+            pChannelWin->onNetjoin(evt);
     }
 }
 
 //-----------------------------------//
 
-void StatusWindow::onWallopsMessage(Event *pEvent)
+void StatusWindow::onWallopsMessage(const MessageEvent &evt)
 {
-    Message msg = DCAST(MessageEvent, pEvent)->getMessage();
+    const Message &msg = evt.getMessage();
     QString textToPrint = GET_STRING("message.wallops")
                             .arg(parseMsgPrefix(msg.m_prefix, MsgPrefixName))
                             .arg(msg.m_params[0]);
@@ -729,9 +880,8 @@ void StatusWindow::onWallopsMessage(Event *pEvent)
 
 //-----------------------------------//
 
-void StatusWindow::onUnknownMessage(Event *pEvent)
+void StatusWindow::onUnknownMessage(const MessageEvent &)
 {
-    Message msg = DCAST(MessageEvent, pEvent)->getMessage();
     // Print the whole raw line.
     //printOutput(data);
     // TODO (seand): Decide what to do here.
@@ -739,8 +889,108 @@ void StatusWindow::onUnknownMessage(Event *pEvent)
 
 //-----------------------------------//
 
-void StatusWindow::onOutput(Event *) { }
-void StatusWindow::onDoubleClickLink(Event *) { }
+void StatusWindow::onNotifyOnline(const NotifyEvent &evt)
+{
+    printOutput(GET_STRING("message.notify.online").arg(evt.getNick()), MESSAGE_INFO);
+}
+
+//-----------------------------------//
+
+void StatusWindow::onNotifyOffline(const NotifyEvent &evt)
+{
+    printOutput(GET_STRING("message.notify.offline").arg(evt.getNick()), MESSAGE_INFO);
+}
+
+//-----------------------------------//
+
+void StatusWindow::onNotifyConfigChanged(const ConfigEvent &)
+{
+    setupNotifyList();
+}
+
+//-----------------------------------//
+
+// Hands the notify list options on to the Session's NotifyList.
+void StatusWindow::setupNotifyList()
+{
+    QStringList nicks;
+    QVariantList nickList = GET_LIST(NOTIFY_LIST);
+    for(int i = 0; i < nickList.size(); ++i)
+        nicks.append(nickList[i].toString());
+
+    NotifyList *pNotifyList = m_pSession->getNotifyList();
+    pNotifyList->setPollInterval(qMax(GET_INT(NOTIFY_INTERVAL), 1) * 1000);
+    pNotifyList->setNicks(nicks);
+}
+
+//-----------------------------------//
+
+void StatusWindow::onIgnoreConfigChanged(const ConfigEvent &)
+{
+    setupIgnoreList();
+}
+
+//-----------------------------------//
+
+// Hands the ignore list option on to the Session's IgnoreList. Each
+// entry is a hostmask, optionally followed by the types to ignore.
+void StatusWindow::setupIgnoreList()
+{
+    QList<IgnoreRule> rules;
+    QVariantList ignoreList = GET_LIST(IGNORE_LIST);
+    for(int i = 0; i < ignoreList.size(); ++i)
+    {
+        QString entry = ignoreList[i].toString();
+        IgnoreRule rule;
+        rule.mask = entry.section(' ', 0, 0, QString::SectionSkipEmpty);
+        rule.types = IgnoreList::parseTypes(entry.section(' ', 1, 1, QString::SectionSkipEmpty));
+        if(!rule.mask.isEmpty())
+            rules.append(rule);
+    }
+
+    m_pSession->getIgnoreList()->setRules(rules);
+}
+
+//-----------------------------------//
+
+void StatusWindow::onHighlightConfigChanged(const ConfigEvent &)
+{
+    setupHighlightWords();
+}
+
+//-----------------------------------//
+
+// Hands the highlight words option on to the Session.
+void StatusWindow::setupHighlightWords()
+{
+    QStringList words;
+    QVariantList wordList = GET_LIST(HIGHLIGHT_WORDS);
+    for(int i = 0; i < wordList.size(); ++i)
+    {
+        QString word = wordList[i].toString().trimmed();
+        if(!word.isEmpty())
+            words.append(word);
+    }
+
+    m_pSession->setHighlightWords(words);
+}
+
+//-----------------------------------//
+
+// Returns the alternate nick given to the ServerConnectionPanel as a
+// list for the Session, which is empty if there isn't one.
+QStringList StatusWindow::getAltNicks(const QString &altNick)
+{
+    QStringList altNicks;
+    if(!altNick.trimmed().isEmpty())
+        altNicks.append(altNick.trimmed());
+    return altNicks;
+}
+
+//-----------------------------------//
+
+void StatusWindow::onOutput(const OutputEvent &) { }
+void StatusWindow::onDoubleClickLink(const DoubleClickLinkEvent &) { }
 
 //-----------------------------------//
 
@@ -755,6 +1005,26 @@ void StatusWindow::setupServerConfig(QMap<QString, ConfigOption> &defOptions)
 void StatusWindow::setupIRCConfig(QMap<QString, ConfigOption> &defOptions)
 {
     defOptions.insert("irc.channel.properNickInChat", ConfigOption(false, CONFIG_TYPE_BOOLEAN));
+
+    // Hides the joins, parts and quits of users who haven't spoken
+    // in a channel within this many minutes.
+    defOptions.insert("irc.channel.smartFilter", ConfigOption(false, CONFIG_TYPE_BOOLEAN));
+    defOptions.insert("irc.channel.smartFilter.minutes", ConfigOption(10, CONFIG_TYPE_INTEGER));
+
+    // Nicknames to be told about when they come online or go offline,
+    // and how many seconds apart to poll them if MONITOR isn't supported.
+    QVariantList notifyList;
+    defOptions.insert(NOTIFY_LIST, ConfigOption(notifyList, CONFIG_TYPE_LIST));
+    defOptions.insert(NOTIFY_INTERVAL, ConfigOption(10, CONFIG_TYPE_INTEGER));
+
+    // Hostmasks to ignore, each optionally followed by the types of
+    // messages to ignore from it (see IgnoreList::parseTypes()).
+    QVariantList ignoreList;
+    defOptions.insert(IGNORE_LIST, ConfigOption(ignoreList, CONFIG_TYPE_LIST));
+
+    // Words which highlight a message like the user's nick does.
+    QVariantList highlightWords;
+    defOptions.insert(HIGHLIGHT_WORDS, ConfigOption(highlightWords, CONFIG_TYPE_LIST));
 }
 
 } } // End namespaces
@@ -46,8 +46,8 @@ WindowManager::WindowManager(QWidget *pParent, WindowContainer *pMainContainer)
 
     setupContextMenu();
     setupColors();
-    g_pEvtManager->hookEvent("configChanged", COLOR_BACKGROUND, MakeDelegate(this, &WindowManager::onBackgroundColorChanged));
-    g_pEvtManager->hookEvent("configChanged", COLOR_FOREGROUND, MakeDelegate(this, &WindowManager::onForegroundColorChanged));
+    m_eventHandles.append(g_pEvtManager->hookEvent("configChanged", COLOR_BACKGROUND, MakeDelegate(this, &WindowManager::onBackgroundColorChanged)));
+    m_eventHandles.append(g_pEvtManager->hookEvent("configChanged", COLOR_FOREGROUND, MakeDelegate(this, &WindowManager::onForegroundColorChanged)));
 
     QObject::connect(m_pMainContainer, SIGNAL(subWindowActivated(QMdiSubWindow *)), this, SLOT(onSubWindowActivated(QMdiSubWindow *)));
     QObject::connect(this, SIGNAL(currentItemChanged(QTreeWidgetItem*,QTreeWidgetItem*)), this, SLOT(onItemChanged(QTreeWidgetItem*,QTreeWidgetItem*)));
@@ -81,8 +81,7 @@ WindowManager::~WindowManager()
         m_altContainers.front()->close();
 
     // Unhook the event callbacks.
-    g_pEvtManager->unhookEvent("configChanged", COLOR_BACKGROUND, MakeDelegate(this, &WindowManager::onBackgroundColorChanged));
-    g_pEvtManager->unhookEvent("configChanged", COLOR_FOREGROUND, MakeDelegate(this, &WindowManager::onForegroundColorChanged));
+    g_pEvtManager->unhookEvents(m_eventHandles);
 }
 
 //-----------------------------------//
@@ -103,18 +102,16 @@ void WindowManager::setupColors()
 
 //-----------------------------------//
 
-void WindowManager::onBackgroundColorChanged(Event *pEvent)
+void WindowManager::onBackgroundColorChanged(const ConfigEvent &evt)
 {
-    ConfigEvent *pCfgEvent = DCAST(ConfigEvent, pEvent);
-    setStyleSheet(QString("background-color: %1").arg(pCfgEvent->getString()));
+    setStyleSheet(QString("background-color: %1").arg(evt.getString()));
 }
 
 //-----------------------------------//
 
-void WindowManager::onForegroundColorChanged(Event *pEvent)
+void WindowManager::onForegroundColorChanged(const ConfigEvent &evt)
 {
-    ConfigEvent *pCfgEvent = DCAST(ConfigEvent, pEvent);
-    QBrush newBrush(pCfgEvent->getColor());
+    QBrush newBrush(evt.getColor());
     for(int i = 0; i < m_winList.size(); ++i)
         if(!m_winList[i].m_pTreeItem->isSelected())
             m_winList[i].m_pTreeItem->setForeground(0, newBrush);